@@ -0,0 +1,142 @@
+/*
+ * Interface table benchmark
+ * Loads the table from a fake CLI socket, looks every interface up by
+ * name and by sw_if_index, and renders it as "show interfaces" does, at
+ * growing interface counts. Time per interface should stay flat as the
+ * count grows, and the heap in use should grow in proportion to it.
+ *
+ * Usage: bench_iftable [count...]
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <malloc.h>
+
+#include "vpp_cli.h"
+#include "vpp_iftable.h"
+#include "fake_cli.h"
+
+#define BENCH_RUNS 5                /* Best of, per count */
+
+static const unsigned int default_counts[] = { 2500, 5000, 10000, 20000 };
+
+typedef struct {
+    double load;
+    double lookup;
+    double render;
+} bench_times_t;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Same output as vpp_show_interfaces() */
+static void render(FILE *out, const vpp_ift_t *t) {
+    fprintf(out, "%-32s %-20s %5s %-6s %-8s\n",
+        "Interface", "IP-Address", "MTU", "Status", "Protocol");
+    for (size_t i = 0; i < t->count; i++) {
+        const vpp_ift_iface_t *row = &t->ifaces[i];
+        const vpp_ift_addr_t *addrs = &t->addrs[row->addr_first];
+
+        fprintf(out, "%-32s %-20s %5u %-6s %-8s\n",
+            row->name,
+            row->addr_count ? addrs[0].prefix : "unassigned",
+            row->mtu,
+            row->admin_up ? "up" : "down",
+            row->link_up ? "up" : "down");
+        for (size_t j = 1; j < row->addr_count; j++)
+            fprintf(out, "%-32s %-20s\n", "", addrs[j].prefix);
+    }
+}
+
+/* One load, lookup and render pass; 0, or -1 if the table is wrong */
+static int run_once(unsigned int count, FILE *sink, bench_times_t *bt, size_t *addrs) {
+    const vpp_ift_t *t;
+    size_t found = 0;
+    double start;
+
+    vpp_ift_invalidate();
+    start = now_ms();
+    t = vpp_ift_get(VPP_IFT_FULL);
+    bt->load = now_ms() - start;
+    if (!t || t->count != count)
+        return -1;
+
+    start = now_ms();
+    for (size_t i = 0; i < t->count; i++) {
+        found += vpp_ift_find(t, t->ifaces[i].name) == &t->ifaces[i];
+        found += vpp_ift_find_index(t, t->ifaces[i].sw_if_index) == &t->ifaces[i];
+    }
+    bt->lookup = now_ms() - start;
+    if (found != 2 * (size_t)count)
+        return -1;
+
+    start = now_ms();
+    render(sink, t);
+    fflush(sink);
+    bt->render = now_ms() - start;
+    *addrs = t->addr_count;
+    return 0;
+}
+
+static int bench(unsigned int count, FILE *sink) {
+    bench_times_t best = { 0, 0, 0 }, bt;
+    size_t addrs = 0;
+    pid_t pid;
+    int rv = 0;
+
+    pid = fake_cli_start(VPP_CLI_SOCKET, count);
+    if (pid < 0) {
+        fprintf(stderr, "Error: Cannot listen on %s\n", VPP_CLI_SOCKET);
+        return -1;
+    }
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        if (run_once(count, sink, &bt, &addrs) < 0) {
+            fprintf(stderr, "Error: Wrong interface table at %u interfaces\n", count);
+            rv = -1;
+            break;
+        }
+        if (run == 0 || bt.load < best.load)
+            best.load = bt.load;
+        if (run == 0 || bt.lookup < best.lookup)
+            best.lookup = bt.lookup;
+        if (run == 0 || bt.render < best.render)
+            best.render = bt.render;
+    }
+    if (rv == 0) {
+        struct mallinfo2 mi = mallinfo2();
+        double total = best.load + best.lookup + best.render;
+        printf("%10u %10zu %10.2f %10.2f %10.2f %10.0f %10zu\n",
+               count, addrs, best.load, best.lookup, best.render,
+               total * 1e6 / count, mi.uordblks / 1024);
+    }
+    fake_cli_stop(pid, VPP_CLI_SOCKET);
+    return rv;
+}
+
+int main(int argc, char **argv) {
+    FILE *sink = fopen("/dev/null", "w");
+    int rv = 0;
+
+    if (!sink) {
+        perror("/dev/null");
+        return 1;
+    }
+    printf("%10s %10s %10s %10s %10s %10s %10s\n", "interfaces", "addresses",
+           "load ms", "lookup ms", "render ms", "ns/iface", "heap KB");
+    if (argc > 1) {
+        for (int i = 1; i < argc && rv == 0; i++)
+            rv = bench((unsigned int)strtoul(argv[i], NULL, 10), sink);
+    } else {
+        for (size_t i = 0; i < sizeof(default_counts) / sizeof(default_counts[0]) && rv == 0; i++)
+            rv = bench(default_counts[i], sink);
+    }
+    vpp_ift_free();
+    fclose(sink);
+    return rv == 0 ? 0 : 1;
+}
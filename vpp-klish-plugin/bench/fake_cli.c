@@ -0,0 +1,173 @@
+/*
+ * Fake VPP CLI socket for the benchmarks
+ * Answers the commands the interface table loads from, for a bond with
+ * two members and VLAN subinterfaces on it up to the requested count.
+ * Every subinterface has an IPv4 and an IPv6 address. Other commands
+ * get empty output. No telnet options are offered, so the client never
+ * sends any; the prompt follows the banner as VPP's does.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "fake_cli.h"
+
+#define FAKE_PROMPT "vpp# "
+#define FAKE_FIXED 4                /* Interfaces besides the subinterfaces */
+#define FAKE_LINE_MAX 256
+#define FAKE_OUT_BUF (256 * 1024)
+
+static const char *fixed_names[FAKE_FIXED] = {
+    "local0", "TenGigabitEthernet1/0/0", "TenGigabitEthernet1/0/1", "BondEthernet0",
+};
+
+/* Name of the interface with sw_if_index @i */
+static void iface_name(unsigned int i, char *buf, size_t size) {
+    if (i < FAKE_FIXED)
+        snprintf(buf, size, "%s", fixed_names[i]);
+    else
+        snprintf(buf, size, "BondEthernet0.%u", i - FAKE_FIXED + 1);
+}
+
+static void show_interface(FILE *out, unsigned int count) {
+    char name[64];
+
+    fprintf(out, "              Name               Idx    State  MTU (L3/IP4/IP6/MPLS)"
+                 "     Counter          Count     \r\n");
+    for (unsigned int i = 0; i < count; i++) {
+        iface_name(i, name, sizeof(name));
+        fprintf(out, "%-32s%5u%9s%14s\r\n", name, i, i ? "up" : "down",
+                i < FAKE_FIXED ? "9000/0/0/0" : "1500/0/0/0");
+        if (i == FAKE_FIXED - 1) {
+            fprintf(out, "%-68s%-24s%8u\r\n", "", "rx packets", i * 1000);
+            fprintf(out, "%-68s%-24s%8u\r\n", "", "tx packets", i * 2000);
+        }
+    }
+}
+
+static void show_interface_addr(FILE *out, unsigned int count) {
+    char name[64];
+
+    for (unsigned int i = 0; i < count; i++) {
+        iface_name(i, name, sizeof(name));
+        fprintf(out, "%s (%s):\r\n", name, i ? "up" : "dn");
+        if (i == FAKE_FIXED - 1) {
+            fprintf(out, "  L3 192.0.2.1/24\r\n");
+        } else if (i >= FAKE_FIXED) {
+            unsigned int vlan = i - FAKE_FIXED + 1;
+            fprintf(out, "  L3 10.%u.%u.1/24\r\n", vlan >> 8, vlan & 0xff);
+            fprintf(out, "  L3 2001:db8:%x::1/64\r\n", vlan);
+        }
+    }
+}
+
+static void show_bond_details(FILE *out) {
+    fprintf(out, "BondEthernet0\r\n"
+                 "  mode: lacp\r\n"
+                 "  load balance: l34\r\n"
+                 "  number of active members: 2\r\n"
+                 "    TenGigabitEthernet1/0/0\r\n"
+                 "    TenGigabitEthernet1/0/1\r\n"
+                 "  number of members: 2\r\n"
+                 "    TenGigabitEthernet1/0/0\r\n"
+                 "    TenGigabitEthernet1/0/1\r\n"
+                 "  device instance: 0\r\n"
+                 "  interface id: 0\r\n"
+                 "  sw_if_index: 3\r\n"
+                 "  hw_if_index: 3\r\n");
+}
+
+static void answer(FILE *out, const char *cmd, unsigned int count) {
+    /* VPP echoes the command line first */
+    fprintf(out, "%s\r\n", cmd);
+    if (strcmp(cmd, "show interface") == 0)
+        show_interface(out, count);
+    else if (strcmp(cmd, "show interface addr") == 0)
+        show_interface_addr(out, count);
+    else if (strcmp(cmd, "show bond details") == 0)
+        show_bond_details(out);
+    else if (strcmp(cmd, "show lcp") == 0)
+        fprintf(out, "itf-pair: [0] BondEthernet0 tap4096 bond0 2 type tap netns dataplane\r\n");
+    fputs(FAKE_PROMPT, out);
+    fflush(out);
+}
+
+static void serve(int fd, unsigned int count) {
+    FILE *out = fdopen(dup(fd), "w");
+    char line[FAKE_LINE_MAX];
+    char buf[4096];
+    size_t len = 0;
+    ssize_t n;
+
+    if (!out) {
+        close(fd);
+        return;
+    }
+    setvbuf(out, NULL, _IOFBF, FAKE_OUT_BUF);
+    fputs("    _______    _        _   _____  ___ \r\n"
+          " __/ __/ _ \\  (_)__    | | / / _ \\/ _ \\\r\n"
+          " _/ _// // / / / _ \\   | |/ / ___/ ___/\r\n"
+          " /_/ /____(_)_/\\___/   |___/_/  /_/    \r\n\r\n" FAKE_PROMPT, out);
+    fflush(out);
+
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] == '\n') {
+                line[len] = 0;
+                answer(out, line, count);
+                len = 0;
+            } else if (buf[i] != '\r' && len < sizeof(line) - 1) {
+                line[len++] = buf[i];
+            }
+        }
+    }
+    fclose(out);
+    close(fd);
+}
+
+pid_t fake_cli_start(const char *path, unsigned int count) {
+    struct sockaddr_un addr;
+    pid_t pid;
+    int fd;
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    /* Listening before the fork, so the caller can connect right away */
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    pid = fork();
+    if (pid != 0) {
+        close(fd);
+        return pid;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    for (;;) {
+        int conn = accept(fd, NULL, NULL);
+        if (conn >= 0)
+            serve(conn, count);
+    }
+}
+
+void fake_cli_stop(pid_t pid, const char *path) {
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+    unlink(path);
+}
@@ -0,0 +1,15 @@
+/*
+ * Fake VPP CLI socket for the benchmarks
+ */
+
+#ifndef FAKE_CLI_H
+#define FAKE_CLI_H
+
+#include <sys/types.h>
+
+/* Serve a synthetic system of @count interfaces on @path from a child
+ * process; its PID, or -1 on error */
+pid_t fake_cli_start(const char *path, unsigned int count);
+void fake_cli_stop(pid_t pid, const char *path);
+
+#endif /* FAKE_CLI_H */
@@ -0,0 +1,984 @@
+/*
+ * VPP binary API client for the Klish plugin
+ * Speaks the socket transport of VPP's API socket directly, so that
+ * configuration handlers no longer fork vppctl for every command.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "vpp_api.h"
+
+#define API_HDR_SIZE 16             /* Socket transport frame header */
+#define API_MSG_MAX 512
+#define API_TIMEOUT_MS 5000
+#define API_ROUTE_WINDOW 256        /* Route requests in flight */
+#define API_CLIENT_NAME "klish-vpp"
+
+/* sockclnt_create has fixed IDs, everything else comes from its reply */
+#define API_SOCKCLNT_CREATE 15
+#define API_SOCKCLNT_CREATE_REPLY 16
+
+#define IF_STATUS_API_FLAG_ADMIN_UP 1
+#define IF_STATUS_API_FLAG_LINK_UP 2
+
+/* Messages resolved from the table VPP returns on connect */
+enum {
+    M_CONTROL_PING,
+    M_SW_INTERFACE_DUMP,
+    M_SW_INTERFACE_DETAILS,
+    M_IP_ADDRESS_DUMP,
+    M_IP_ADDRESS_DETAILS,
+    M_SW_INTERFACE_SET_FLAGS,
+    M_SW_INTERFACE_SET_MTU,
+    M_SW_INTERFACE_ADD_DEL_ADDRESS,
+    M_CREATE_LOOPBACK_INSTANCE,
+    M_DELETE_LOOPBACK,
+    M_CREATE_VLAN_SUBIF,
+    M_DELETE_SUBIF,
+    M_BOND_CREATE2,
+    M_BOND_DELETE,
+    M_BOND_ADD_MEMBER,
+    M_BOND_DETACH_MEMBER,
+    M_IP_ROUTE_ADD_DEL,
+    M_LCP_ITF_PAIR_ADD_DEL,
+    M_WANT_INTERFACE_EVENTS,
+    M_SW_INTERFACE_EVENT,
+    M_COUNT
+};
+
+/* Name and CRC of each message as encoded or decoded below. VPP names
+ * a message after the CRC of its layout, so one that changed shape does
+ * not match and its requests go through the CLI instead. */
+static const char *msg_names[M_COUNT] = {
+    [M_CONTROL_PING] = "control_ping_51077d14",
+    [M_SW_INTERFACE_DUMP] = "sw_interface_dump_aa610c27",
+    [M_SW_INTERFACE_DETAILS] = "sw_interface_details_6c221fc7",
+    [M_IP_ADDRESS_DUMP] = "ip_address_dump_2d033de4",
+    [M_IP_ADDRESS_DETAILS] = "ip_address_details_ee29b797",
+    [M_SW_INTERFACE_SET_FLAGS] = "sw_interface_set_flags_f5aec1b8",
+    [M_SW_INTERFACE_SET_MTU] = "sw_interface_set_mtu_5cbe85e5",
+    [M_SW_INTERFACE_ADD_DEL_ADDRESS] = "sw_interface_add_del_address_5463d73b",
+    [M_CREATE_LOOPBACK_INSTANCE] = "create_loopback_instance_d36a3ee2",
+    [M_DELETE_LOOPBACK] = "delete_loopback_f9e6675e",
+    [M_CREATE_VLAN_SUBIF] = "create_vlan_subif_af34ac8b",
+    [M_DELETE_SUBIF] = "delete_subif_f9e6675e",
+    [M_BOND_CREATE2] = "bond_create2_912fda76",
+    [M_BOND_DELETE] = "bond_delete_f9e6675e",
+    [M_BOND_ADD_MEMBER] = "bond_add_member_e7d14948",
+    [M_BOND_DETACH_MEMBER] = "bond_detach_member_f9e6675e",
+    [M_IP_ROUTE_ADD_DEL] = "ip_route_add_del_b8ecfe0d",
+    [M_LCP_ITF_PAIR_ADD_DEL] = "lcp_itf_pair_add_del_40482b80",
+    [M_WANT_INTERFACE_EVENTS] = "want_interface_events_476f5a08",
+    [M_SW_INTERFACE_EVENT] = "sw_interface_event_2d3d95a7",
+};
+
+/* Per-session connection state. The owner PID detects a descriptor
+ * inherited across fork, which must not be shared with the parent. */
+static struct {
+    int fd;
+    pid_t owner;
+    uint32_t client_index;
+    uint32_t context;
+    int ids[M_COUNT];       /* -1 when this VPP lacks the message or its layout differs */
+    uint8_t *rx;
+    size_t rx_size;
+    vpp_api_event_fn event_fn;  /* Interface event subscriber */
+    void *event_arg;
+    int subscribed;             /* VPP sends events on this connection */
+} api = { .fd = -1 };
+
+/* Outgoing message under construction */
+typedef struct {
+    uint8_t buf[API_HDR_SIZE + API_MSG_MAX];
+    size_t len;
+    int msg;                /* M_*, to renumber it for another connection */
+} api_msg_t;
+
+typedef void (*api_details_fn)(const uint8_t *msg, size_t len, void *arg);
+
+/* Message encoding (all fields are big-endian on the wire) */
+
+static void msg_bytes(api_msg_t *m, const void *data, size_t n) {
+    if (n == 0)
+        return;
+    if (m->len + n > sizeof(m->buf))
+        n = sizeof(m->buf) - m->len;
+    memcpy(m->buf + m->len, data, n);
+    m->len += n;
+}
+
+static void msg_zero(api_msg_t *m, size_t n) {
+    if (m->len + n > sizeof(m->buf))
+        n = sizeof(m->buf) - m->len;
+    memset(m->buf + m->len, 0, n);
+    m->len += n;
+}
+
+static void msg_u8(api_msg_t *m, uint8_t v) {
+    msg_bytes(m, &v, 1);
+}
+
+static void msg_u16(api_msg_t *m, uint16_t v) {
+    v = htons(v);
+    msg_bytes(m, &v, 2);
+}
+
+static void msg_u32(api_msg_t *m, uint32_t v) {
+    v = htonl(v);
+    msg_bytes(m, &v, 4);
+}
+
+/* Fixed-size "string name[n]" field */
+static void msg_str(api_msg_t *m, const char *s, size_t n) {
+    size_t len = s ? strnlen(s, n - 1) : 0;
+    msg_bytes(m, s, len);
+    msg_zero(m, n - len);
+}
+
+static uint32_t rd_u32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return ntohl(v);
+}
+
+static uint16_t rd_u16(const uint8_t *p) {
+    uint16_t v;
+    memcpy(&v, p, 2);
+    return ntohs(v);
+}
+
+/* Start a request: message ID, client index and a fresh context */
+static uint32_t msg_begin(api_msg_t *m, int msg) {
+    m->len = API_HDR_SIZE;
+    m->msg = msg;
+    msg_u16(m, (uint16_t)api.ids[msg]);
+    msg_u32(m, api.client_index);
+    msg_u32(m, ++api.context);
+    return api.context;
+}
+
+/* Give a message built for a previous connection the message ID and
+ * client index of the current one; its context is kept */
+static void msg_restamp(api_msg_t *m) {
+    uint16_t id = htons((uint16_t)api.ids[m->msg]);
+    uint32_t client_index = htonl(api.client_index);
+
+    memcpy(m->buf + API_HDR_SIZE, &id, 2);
+    memcpy(m->buf + API_HDR_SIZE + 2, &client_index, 4);
+}
+
+/* Socket I/O */
+
+static int api_write_all(const uint8_t *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(api.fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int api_read_all(uint8_t *data, size_t len) {
+    while (len > 0) {
+        struct pollfd pfd = { .fd = api.fd, .events = POLLIN };
+        int rc = poll(&pfd, 1, API_TIMEOUT_MS);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc <= 0)
+            return -1;
+        ssize_t n = read(api.fd, data, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Frame and send a message built with msg_begin() */
+static int api_send(api_msg_t *m) {
+    uint32_t data_len = htonl((uint32_t)(m->len - API_HDR_SIZE));
+    memset(m->buf, 0, API_HDR_SIZE);
+    memcpy(m->buf + 8, &data_len, 4);
+    return api_write_all(m->buf, m->len);
+}
+
+/* Receive one message into api.rx */
+static int api_recv(size_t *len) {
+    uint8_t hdr[API_HDR_SIZE];
+    uint32_t data_len;
+
+    if (api_read_all(hdr, sizeof(hdr)) < 0)
+        return -1;
+    data_len = rd_u32(hdr + 8);
+    if (data_len > api.rx_size) {
+        uint8_t *rx = realloc(api.rx, data_len);
+        if (!rx)
+            return -1;
+        api.rx = rx;
+        api.rx_size = data_len;
+    }
+    if (api_read_all(api.rx, data_len) < 0)
+        return -1;
+    *len = data_len;
+    return 0;
+}
+
+/* Connection management */
+
+static void api_close(void) {
+    if (api.fd >= 0)
+        close(api.fd);
+    api.fd = -1;
+    api.subscribed = 0;
+}
+
+static void api_resolve_ids(const uint8_t *table, uint16_t count, size_t len) {
+    for (int i = 0; i < M_COUNT; i++)
+        api.ids[i] = -1;
+
+    /* Entries are { u16 index; string name[64]; } */
+    for (uint16_t e = 0; e < count && (size_t)(e + 1) * 66 <= len; e++) {
+        const uint8_t *entry = table + e * 66;
+        const char *name = (const char *)entry + 2;
+
+        for (int i = 0; i < M_COUNT; i++) {
+            if (strncmp(name, msg_names[i], 64) == 0) {
+                api.ids[i] = rd_u16(entry);
+                break;
+            }
+        }
+    }
+}
+
+/* Deliver a received message if it is an interface event */
+static int api_event(size_t len) {
+    vpp_api_iface_event_t ev;
+
+    if (len < 19 || api.ids[M_SW_INTERFACE_EVENT] < 0 ||
+        rd_u16(api.rx) != api.ids[M_SW_INTERFACE_EVENT])
+        return 0;
+    if (api.event_fn) {
+        /* u16 id, u32 client_index, u32 pid, u32 sw_if_index,
+         * u32 flags, bool deleted */
+        uint32_t flags = rd_u32(api.rx + 14);
+        ev.sw_if_index = rd_u32(api.rx + 10);
+        ev.admin_up = (flags & IF_STATUS_API_FLAG_ADMIN_UP) != 0;
+        ev.link_up = (flags & IF_STATUS_API_FLAG_LINK_UP) != 0;
+        ev.deleted = api.rx[18] != 0;
+        api.event_fn(&ev, api.event_arg);
+    }
+    return 1;
+}
+
+/* Wait for the reply carrying @ctx and return its retval */
+static int api_wait(uint32_t ctx, size_t *len) {
+    for (;;) {
+        if (api_recv(len) < 0) {
+            api_close();
+            return VPP_API_ERR_IO;
+        }
+        /* Events may arrive ahead of the reply; skip anything else */
+        if (api_event(*len))
+            continue;
+        if (*len >= 10 && rd_u32(api.rx + 2) == ctx)
+            return (int32_t)rd_u32(api.rx + 6);
+    }
+}
+
+/* Ask for interface events on the current connection. Events sent
+ * before, e.g. to a connection that was lost, are gone: the subscriber
+ * gets a resync event first. */
+static int api_subscribe(void) {
+    api_msg_t m;
+    size_t len;
+    uint32_t ctx = msg_begin(&m, M_WANT_INTERFACE_EVENTS);
+    int rv;
+
+    msg_u32(&m, 1);
+    msg_u32(&m, (uint32_t)getpid());
+    if (api_send(&m) < 0) {
+        api_close();
+        return VPP_API_ERR_IO;
+    }
+    rv = api_wait(ctx, &len);
+    if (rv == 0) {
+        vpp_api_iface_event_t ev = { .sw_if_index = VPP_API_RESYNC };
+        api.subscribed = 1;
+        api.event_fn(&ev, api.event_arg);
+    }
+    return rv;
+}
+
+static int api_open(void) {
+    struct sockaddr_un addr;
+    api_msg_t m;
+    size_t len;
+
+    api.fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (api.fd < 0)
+        return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, VPP_API_SOCKET, sizeof(addr.sun_path) - 1);
+    if (connect(api.fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        api_close();
+        return -1;
+    }
+    api.owner = getpid();
+
+    /* sockclnt_create carries no client_index */
+    m.len = API_HDR_SIZE;
+    msg_u16(&m, API_SOCKCLNT_CREATE);
+    msg_u32(&m, ++api.context);
+    msg_str(&m, API_CLIENT_NAME, 64);
+    if (api_send(&m) < 0 || api_recv(&len) < 0) {
+        api_close();
+        return -1;
+    }
+
+    /* Reply: u16 id, u32 client_index, u32 context, i32 response,
+     * u32 index, u16 count, message table */
+    if (len < 20 || rd_u16(api.rx) != API_SOCKCLNT_CREATE_REPLY ||
+        (int32_t)rd_u32(api.rx + 10) < 0) {
+        api_close();
+        return -1;
+    }
+    api.client_index = rd_u32(api.rx + 14);
+    api_resolve_ids(api.rx + 20, rd_u16(api.rx + 18), len - 20);
+
+    /* A reconnect must not silently end an event subscription */
+    if (api.event_fn && api.ids[M_WANT_INTERFACE_EVENTS] >= 0 &&
+        api.ids[M_SW_INTERFACE_EVENT] >= 0 && api_subscribe() == VPP_API_ERR_IO)
+        return -1;
+    return 0;
+}
+
+/* Make sure this process owns a live connection */
+static int api_ready(void) {
+    if (api.fd >= 0 && api.owner != getpid()) {
+        /* Inherited from the session process; leave its socket alone */
+        close(api.fd);
+        api.fd = -1;
+    }
+    if (api.fd < 0 && api_open() < 0)
+        return -1;
+    return 0;
+}
+
+static int api_has(int msg) {
+    return api_ready() == 0 && api.ids[msg] >= 0 && api.ids[M_CONTROL_PING] >= 0;
+}
+
+/* Send a request and wait for the reply carrying the same context.
+ * A failed send is retried once on a fresh connection, since VPP cannot
+ * have seen it; a failed receive leaves the outcome unknown. The new
+ * connection is most likely to a restarted VPP, which may number its
+ * messages differently, so the request is renumbered first. */
+static int api_call(api_msg_t *m, uint32_t ctx, size_t *len) {
+    if (api_send(m) < 0) {
+        api_close();
+        if (api_open() < 0)
+            return VPP_API_ERR_IO;
+        if (api.ids[m->msg] < 0 || api.ids[M_CONTROL_PING] < 0)
+            return VPP_API_FALLBACK;
+        msg_restamp(m);
+        if (api_send(m) < 0) {
+            api_close();
+            return VPP_API_ERR_IO;
+        }
+    }
+    return api_wait(ctx, len);
+}
+
+/* Terminate a dump with control_ping and deliver every details message
+ * until its reply arrives. Several dumps may be pipelined before this. */
+static int api_dump_collect(int details, api_details_fn fn, void *arg) {
+    api_msg_t m;
+    size_t len;
+    uint32_t ctx = msg_begin(&m, M_CONTROL_PING);
+
+    if (api_send(&m) < 0) {
+        api_close();
+        return VPP_API_ERR_IO;
+    }
+    for (;;) {
+        if (api_recv(&len) < 0) {
+            api_close();
+            return VPP_API_ERR_IO;
+        }
+        if (len < 6 || api_event(len))
+            continue;
+        if (rd_u32(api.rx + 2) == ctx)
+            return 0;
+        if (rd_u16(api.rx) == api.ids[details])
+            fn(api.rx, len, arg);
+    }
+}
+
+/* Send a request whose reply has only a retval */
+static int api_simple(api_msg_t *m, uint32_t ctx) {
+    size_t len;
+    return api_call(m, ctx, &len);
+}
+
+/* Send a request whose reply is { retval, sw_if_index } */
+static int api_create(api_msg_t *m, uint32_t ctx, uint32_t *sw_if_index) {
+    size_t len;
+    int rv = api_call(m, ctx, &len);
+    if (rv == 0 && sw_if_index)
+        *sw_if_index = len >= 14 ? rd_u32(api.rx + 10) : ~0u;
+    return rv;
+}
+
+int vpp_api_connected(void) {
+    return api_ready() == 0;
+}
+
+void vpp_api_disconnect(void) {
+    if (api.owner == getpid())
+        api_close();
+    api.fd = -1;
+    free(api.rx);
+    api.rx = NULL;
+    api.rx_size = 0;
+}
+
+/* Subscribe @fn to interface add/delete and admin/link changes. Events
+ * are delivered from within later API calls and vpp_api_poll_events(). */
+int vpp_api_want_interface_events(vpp_api_event_fn fn, void *arg) {
+    api.event_fn = fn;
+    api.event_arg = arg;
+    if (!api_has(M_WANT_INTERFACE_EVENTS) || api.ids[M_SW_INTERFACE_EVENT] < 0)
+        return VPP_API_FALLBACK;
+    if (api.subscribed)
+        return 0;
+    return api_subscribe();
+}
+
+/* Deliver the events already queued on the connection without waiting.
+ * Returns -1 if there is no live subscription. */
+int vpp_api_poll_events(void) {
+    size_t len;
+
+    if (api.fd < 0 || api.owner != getpid() || !api.subscribed)
+        return -1;
+    for (;;) {
+        struct pollfd pfd = { .fd = api.fd, .events = POLLIN };
+        int rc = poll(&pfd, 1, 0);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc <= 0)
+            return 0;
+        if (api_recv(&len) < 0) {
+            api_close();
+            return -1;
+        }
+        api_event(len);
+    }
+}
+
+const char *vpp_api_strerror(int rv) {
+    static char buf[48];
+
+    switch (rv) {
+    case VPP_API_ERR_IO: return "Connection to VPP lost";
+    case VPP_API_ERR_INVAL: return "Invalid argument";
+    case VPP_API_ERR_NOENT: return "No such interface";
+    case -1: return "Unspecified VPP error";
+    case -2: return "Invalid interface";
+    case -3: return "No such FIB table";
+    case -6: return "No such entry";
+    case -7: return "Invalid value";
+    case -9: return "Not implemented";
+    }
+    snprintf(buf, sizeof(buf), "VPP API error %d", rv);
+    return buf;
+}
+
+/* Address encoding (vl_api_prefix_t: u8 af, u8 addr[16], u8 len) */
+
+static int parse_addr(const char *str, uint8_t *af, uint8_t addr[16]) {
+    memset(addr, 0, 16);
+    if (inet_pton(AF_INET, str, addr) == 1) {
+        *af = 0;
+        return 0;
+    }
+    if (inet_pton(AF_INET6, str, addr) == 1) {
+        *af = 1;
+        return 0;
+    }
+    return -1;
+}
+
+static int parse_prefix(const char *str, uint8_t *af, uint8_t addr[16], uint8_t *plen) {
+    char buf[64];
+    char *slash, *end;
+    long len;
+
+    if (!str || strlen(str) >= sizeof(buf))
+        return -1;
+    strcpy(buf, str);
+    slash = strchr(buf, '/');
+    if (!slash)
+        return -1;
+    *slash = 0;
+    if (parse_addr(buf, af, addr) < 0)
+        return -1;
+    len = strtol(slash + 1, &end, 10);
+    if (*end || end == slash + 1 || len < 0 || len > (*af ? 128 : 32))
+        return -1;
+    *plen = (uint8_t)len;
+    return 0;
+}
+
+static void msg_prefix(api_msg_t *m, uint8_t af, const uint8_t addr[16], uint8_t plen) {
+    msg_u8(m, af);
+    msg_bytes(m, addr, 16);
+    msg_u8(m, plen);
+}
+
+/* Interfaces */
+
+struct iface_dump_ctx {
+    vpp_api_iface_fn fn;
+    void *arg;
+};
+
+/* sw_interface_details: u16 id, u32 context, u32 sw_if_index,
+ * u32 sup_sw_if_index, mac[6], u32 flags, u32 type, u32 duplex,
+ * u32 speed, u16 link_mtu, u32 mtu[4], u32 sub_id, ... name[64] @105 */
+static void iface_details(const uint8_t *msg, size_t len, void *arg) {
+    struct iface_dump_ctx *ctx = arg;
+    vpp_api_iface_t iface;
+    uint32_t flags;
+
+    if (len < 105 + 64)
+        return;
+    memset(&iface, 0, sizeof(iface));
+    iface.sw_if_index = rd_u32(msg + 6);
+    iface.sup_sw_if_index = rd_u32(msg + 10);
+    flags = rd_u32(msg + 20);
+    iface.admin_up = (flags & IF_STATUS_API_FLAG_ADMIN_UP) != 0;
+    iface.link_up = (flags & IF_STATUS_API_FLAG_LINK_UP) != 0;
+    iface.mtu = rd_u32(msg + 38);
+    iface.sub_id = rd_u32(msg + 54);
+    memcpy(iface.name, msg + 105, sizeof(iface.name) - 1);
+    ctx->fn(&iface, ctx->arg);
+}
+
+static int iface_dump(const char *filter, vpp_api_iface_fn fn, void *arg) {
+    struct iface_dump_ctx ctx = { fn, arg };
+    api_msg_t m;
+    size_t flen = filter ? strlen(filter) : 0;
+
+    if (!api_has(M_SW_INTERFACE_DUMP) || api.ids[M_SW_INTERFACE_DETAILS] < 0)
+        return VPP_API_FALLBACK;
+
+    msg_begin(&m, M_SW_INTERFACE_DUMP);
+    msg_u32(&m, ~0u);                   /* all interfaces */
+    msg_u8(&m, filter ? 1 : 0);         /* name_filter_valid */
+    msg_u32(&m, (uint32_t)flen);
+    msg_bytes(&m, filter, flen);
+    if (api_send(&m) < 0) {
+        api_close();
+        return VPP_API_ERR_IO;
+    }
+    return api_dump_collect(M_SW_INTERFACE_DETAILS, iface_details, &ctx);
+}
+
+int vpp_api_iface_dump(vpp_api_iface_fn fn, void *arg) {
+    return iface_dump(NULL, fn, arg);
+}
+
+struct iface_lookup_ctx {
+    const char *name;
+    uint32_t sw_if_index;
+    int found;
+};
+
+static void iface_lookup_match(const vpp_api_iface_t *iface, void *arg) {
+    struct iface_lookup_ctx *ctx = arg;
+    /* The dump filter is a substring match */
+    if (strcmp(iface->name, ctx->name) == 0) {
+        ctx->sw_if_index = iface->sw_if_index;
+        ctx->found = 1;
+    }
+}
+
+int vpp_api_iface_lookup(const char *name, uint32_t *sw_if_index) {
+    struct iface_lookup_ctx ctx = { name, ~0u, 0 };
+    int rv;
+
+    if (!name || !name[0])
+        return VPP_API_ERR_INVAL;
+    rv = iface_dump(name, iface_lookup_match, &ctx);
+    if (rv != 0)
+        return rv;
+    if (!ctx.found)
+        return VPP_API_ERR_NOENT;
+    *sw_if_index = ctx.sw_if_index;
+    return 0;
+}
+
+struct addr_dump_ctx {
+    vpp_api_addr_fn fn;
+    void *arg;
+};
+
+/* ip_address_details: u16 id, u32 context, u32 sw_if_index, prefix */
+static void addr_details(const uint8_t *msg, size_t len, void *arg) {
+    struct addr_dump_ctx *ctx = arg;
+    vpp_api_addr_t addr;
+    char ip[INET6_ADDRSTRLEN];
+
+    if (len < 28)
+        return;
+    memset(&addr, 0, sizeof(addr));
+    addr.sw_if_index = rd_u32(msg + 6);
+    addr.is_ipv6 = msg[10] != 0;
+    if (!inet_ntop(addr.is_ipv6 ? AF_INET6 : AF_INET, msg + 11, ip, sizeof(ip)))
+        return;
+    snprintf(addr.prefix, sizeof(addr.prefix), "%s/%u", ip, msg[27]);
+    ctx->fn(&addr, ctx->arg);
+}
+
+/* Dumps IPv4 and IPv6 addresses of all given interfaces in one pipeline */
+int vpp_api_addr_dump(const uint32_t *sw_if_index, size_t count, vpp_api_addr_fn fn, void *arg) {
+    struct addr_dump_ctx ctx = { fn, arg };
+    api_msg_t m;
+
+    if (!api_has(M_IP_ADDRESS_DUMP) || api.ids[M_IP_ADDRESS_DETAILS] < 0)
+        return VPP_API_FALLBACK;
+
+    for (size_t i = 0; i < count; i++) {
+        for (int is_ipv6 = 0; is_ipv6 <= 1; is_ipv6++) {
+            msg_begin(&m, M_IP_ADDRESS_DUMP);
+            msg_u32(&m, sw_if_index[i]);
+            msg_u8(&m, (uint8_t)is_ipv6);
+            if (api_send(&m) < 0) {
+                api_close();
+                return VPP_API_ERR_IO;
+            }
+        }
+    }
+    return api_dump_collect(M_IP_ADDRESS_DETAILS, addr_details, &ctx);
+}
+
+int vpp_api_set_admin_state(uint32_t sw_if_index, int up) {
+    api_msg_t m;
+    uint32_t ctx;
+
+    if (!api_has(M_SW_INTERFACE_SET_FLAGS))
+        return VPP_API_FALLBACK;
+    ctx = msg_begin(&m, M_SW_INTERFACE_SET_FLAGS);
+    msg_u32(&m, sw_if_index);
+    msg_u32(&m, up ? IF_STATUS_API_FLAG_ADMIN_UP : 0);
+    return api_simple(&m, ctx);
+}
+
+int vpp_api_set_mtu(uint32_t sw_if_index, uint32_t mtu) {
+    api_msg_t m;
+    uint32_t ctx;
+
+    if (!api_has(M_SW_INTERFACE_SET_MTU))
+        return VPP_API_FALLBACK;
+    ctx = msg_begin(&m, M_SW_INTERFACE_SET_MTU);
+    msg_u32(&m, sw_if_index);
+    /* L3 packet MTU; zero leaves the per-protocol MTUs following it */
+    msg_u32(&m, mtu);
+    msg_u32(&m, 0);
+    msg_u32(&m, 0);
+    msg_u32(&m, 0);
+    return api_simple(&m, ctx);
+}
+
+int vpp_api_add_del_address(uint32_t sw_if_index, const char *prefix, int is_add) {
+    api_msg_t m;
+    uint32_t ctx;
+    uint8_t af, addr[16], plen;
+
+    if (parse_prefix(prefix, &af, addr, &plen) < 0)
+        return VPP_API_ERR_INVAL;
+    if (!api_has(M_SW_INTERFACE_ADD_DEL_ADDRESS))
+        return VPP_API_FALLBACK;
+    ctx = msg_begin(&m, M_SW_INTERFACE_ADD_DEL_ADDRESS);
+    msg_u32(&m, sw_if_index);
+    msg_u8(&m, is_add ? 1 : 0);
+    msg_u8(&m, 0);                      /* del_all */
+    msg_prefix(&m, af, addr, plen);
+    return api_simple(&m, ctx);
+}
+
+int vpp_api_create_loopback(int instance, uint32_t *sw_if_index) {
+    api_msg_t m;
+    uint32_t ctx;
+
+    if (!api_has(M_CREATE_LOOPBACK_INSTANCE))
+        return VPP_API_FALLBACK;
+    ctx = msg_begin(&m, M_CREATE_LOOPBACK_INSTANCE);
+    msg_zero(&m, 6);                    /* mac_address: let VPP pick */
+    msg_u8(&m, instance >= 0 ? 1 : 0);  /* is_specified */
+    msg_u32(&m, instance >= 0 ? (uint32_t)instance : 0);
+    return api_create(&m, ctx, sw_if_index);
+}
+
+int vpp_api_delete_loopback(uint32_t sw_if_index) {
+    api_msg_t m;
+    uint32_t ctx;
+
+    if (!api_has(M_DELETE_LOOPBACK))
+        return VPP_API_FALLBACK;
+    ctx = msg_begin(&m, M_DELETE_LOOPBACK);
+    msg_u32(&m, sw_if_index);
+    return api_simple(&m, ctx);
+}
+
+/* Same semantics as "create sub <parent> <vlan>": dot1q exact match */
+int vpp_api_create_vlan_subif(uint32_t parent, uint32_t vlan_id, uint32_t *sw_if_index) {
+    api_msg_t m;
+    uint32_t ctx;
+
+    if (!api_has(M_CREATE_VLAN_SUBIF))
+        return VPP_API_FALLBACK;
+    ctx = msg_begin(&m, M_CREATE_VLAN_SUBIF);
+    msg_u32(&m, parent);
+    msg_u32(&m, vlan_id);
+    return api_create(&m, ctx, sw_if_index);
+}
+
+int vpp_api_delete_subif(uint32_t sw_if_index) {
+    api_msg_t m;
+    uint32_t ctx;
+
+    if (!api_has(M_DELETE_SUBIF))
+        return VPP_API_FALLBACK;
+    ctx = msg_begin(&m, M_DELETE_SUBIF);
+    msg_u32(&m, sw_if_index);
+    return api_simple(&m, ctx);
+}
+
+/* Bonds */
+
+static int bond_mode_value(const char *mode) {
+    if (!mode || strcmp(mode, "lacp") == 0) return 5;
+    if (strcmp(mode, "round-robin") == 0) return 1;
+    if (strcmp(mode, "active-backup") == 0) return 2;
+    if (strcmp(mode, "xor") == 0) return 3;
+    if (strcmp(mode, "broadcast") == 0) return 4;
+    return -1;
+}
+
+static int bond_lb_value(const char *lb) {
+    if (!lb || strcmp(lb, "l34") == 0) return 1;
+    if (strcmp(lb, "l2") == 0) return 0;
+    if (strcmp(lb, "l23") == 0) return 2;
+    return -1;
+}
+
+/* @id selects the BondEthernet<id> instance, -1 lets VPP choose */
+int vpp_api_bond_create(int id, const char *mode, const char *lb, uint32_t *sw_if_index) {
+    api_msg_t m;
+    uint32_t ctx;
+    int mode_val = bond_mode_value(mode);
+    int lb_val = bond_lb_value(lb);
+
+    if (mode_val < 0 || lb_val < 0)
+        return VPP_API_ERR_INVAL;
+    if (!api_has(M_BOND_CREATE2))
+        return VPP_API_FALLBACK;
+    ctx = msg_begin(&m, M_BOND_CREATE2);
+    msg_u32(&m, (uint32_t)mode_val);
+    msg_u32(&m, (uint32_t)lb_val);
+    msg_u8(&m, 0);                      /* numa_only */
+    msg_u8(&m, 0);                      /* enable_gso */
+    msg_u8(&m, 0);                      /* use_custom_mac */
+    msg_zero(&m, 6);
+    msg_u32(&m, id >= 0 ? (uint32_t)id : ~0u);
+    return api_create(&m, ctx, sw_if_index);
+}
+
+int vpp_api_bond_delete(uint32_t sw_if_index) {
+    api_msg_t m;
+    uint32_t ctx;
+
+    if (!api_has(M_BOND_DELETE))
+        return VPP_API_FALLBACK;
+    ctx = msg_begin(&m, M_BOND_DELETE);
+    msg_u32(&m, sw_if_index);
+    return api_simple(&m, ctx);
+}
+
+int vpp_api_bond_add_member(uint32_t bond, uint32_t member) {
+    api_msg_t m;
+    uint32_t ctx;
+
+    if (!api_has(M_BOND_ADD_MEMBER))
+        return VPP_API_FALLBACK;
+    ctx = msg_begin(&m, M_BOND_ADD_MEMBER);
+    msg_u32(&m, member);
+    msg_u32(&m, bond);
+    msg_u8(&m, 0);                      /* is_passive */
+    msg_u8(&m, 0);                      /* is_long_timeout */
+    return api_simple(&m, ctx);
+}
+
+int vpp_api_bond_detach_member(uint32_t member) {
+    api_msg_t m;
+    uint32_t ctx;
+
+    if (!api_has(M_BOND_DETACH_MEMBER))
+        return VPP_API_FALLBACK;
+    ctx = msg_begin(&m, M_BOND_DETACH_MEMBER);
+    msg_u32(&m, member);
+    return api_simple(&m, ctx);
+}
+
+/* Routes and Linux Control Plane */
+
+/* One next-hop path of a route in @table, through @sw_if_index unless ~0 */
+static void msg_route(api_msg_t *m, int is_add, uint32_t table, uint8_t af,
+                      const uint8_t addr[16], uint8_t plen, const uint8_t nh[16],
+                      uint32_t sw_if_index, uint8_t weight) {
+    msg_u8(m, is_add ? 1 : 0);
+    msg_u8(m, 1);                       /* is_multipath: add/remove this path only */
+    msg_u32(m, table);                  /* route.table_id */
+    msg_u32(m, 0);                      /* route.stats_index */
+    msg_prefix(m, af, addr, plen);
+    msg_u8(m, 1);                       /* route.n_paths */
+    msg_u32(m, sw_if_index);            /* path.sw_if_index */
+    msg_u32(m, table);                  /* path.table_id: next hop resolves here */
+    msg_u32(m, 0);                      /* path.rpf_id */
+    msg_u8(m, weight);                  /* path.weight */
+    msg_u8(m, 0);                       /* path.preference */
+    msg_u32(m, 0);                      /* path.type: FIB_API_PATH_TYPE_NORMAL */
+    msg_u32(m, 0);                      /* path.flags */
+    msg_u32(m, af);                     /* path.proto: IP4 = 0, IP6 = 1 */
+    msg_bytes(m, nh, 16);               /* path.nh.address */
+    msg_u32(m, 0);                      /* path.nh.via_label */
+    msg_u32(m, 0);                      /* path.nh.obj_id */
+    msg_u32(m, 0);                      /* path.nh.classify_table_index */
+    msg_u8(m, 0);                       /* path.n_labels */
+    msg_zero(m, 16 * 7);                /* path.label_stack */
+}
+
+/* Adds or removes one next-hop path in the default table, the same as
+ * "ip route add|del <prefix> via <next-hop> [<interface>]" */
+int vpp_api_route_add_del(const char *prefix, const char *next_hop, uint32_t sw_if_index, int is_add) {
+    api_msg_t m;
+    uint32_t ctx;
+    uint8_t af, addr[16], plen;
+    uint8_t nh_af, nh[16];
+
+    if (parse_prefix(prefix, &af, addr, &plen) < 0 ||
+        parse_addr(next_hop, &nh_af, nh) < 0 || nh_af != af)
+        return VPP_API_ERR_INVAL;
+    if (!api_has(M_IP_ROUTE_ADD_DEL))
+        return VPP_API_FALLBACK;
+
+    ctx = msg_begin(&m, M_IP_ROUTE_ADD_DEL);
+    msg_route(&m, is_add, 0, af, addr, plen, nh, sw_if_index, 1);
+    return api_simple(&m, ctx);
+}
+
+/*
+ * Add or remove many routes with up to API_ROUTE_WINDOW requests in
+ * flight; each route's rv receives VPP's retval. VPP answers a client's
+ * requests in order, so replies are matched to routes by context.
+ * Returns VPP_API_ERR_IO if the connection was lost, leaving routes
+ * without an answer at VPP_API_ERR_IO.
+ */
+int vpp_api_route_batch(vpp_api_route_t *routes, size_t count, int is_add) {
+    uint32_t *ctxs;
+    size_t sent = 0, done = 0, len;
+    int rv = 0;
+
+    if (!api_has(M_IP_ROUTE_ADD_DEL))
+        return VPP_API_FALLBACK;
+    ctxs = malloc((count ? count : 1) * sizeof(*ctxs));
+    if (!ctxs)
+        return VPP_API_ERR_IO;
+    for (size_t i = 0; i < count; i++)
+        routes[i].rv = VPP_API_ERR_IO;
+
+    while (done < count) {
+        while (sent < count && sent - done < API_ROUTE_WINDOW) {
+            vpp_api_route_t *r = &routes[sent];
+            uint8_t af, addr[16], plen, nh_af, nh[16];
+            api_msg_t m;
+
+            if (parse_prefix(r->prefix, &af, addr, &plen) < 0 ||
+                parse_addr(r->next_hop, &nh_af, nh) < 0 || nh_af != af || r->weight == 0) {
+                r->rv = VPP_API_ERR_INVAL;
+                sent++;
+                continue;
+            }
+            ctxs[sent] = msg_begin(&m, M_IP_ROUTE_ADD_DEL);
+            msg_route(&m, is_add, r->table_id, af, addr, plen, nh, ~0u, r->weight);
+            if (api_send(&m) < 0) {
+                api_close();
+                rv = VPP_API_ERR_IO;
+                goto out;
+            }
+            sent++;
+        }
+        /* Routes rejected above were never sent */
+        while (done < sent && routes[done].rv == VPP_API_ERR_INVAL)
+            done++;
+        if (done == sent)
+            continue;
+
+        if (api_recv(&len) < 0) {
+            api_close();
+            rv = VPP_API_ERR_IO;
+            goto out;
+        }
+        if (api_event(len) || len < 10)
+            continue;
+        uint32_t ctx = rd_u32(api.rx + 2);
+        for (size_t i = done; i < sent; i++) {
+            if (routes[i].rv != VPP_API_ERR_INVAL && ctxs[i] == ctx) {
+                routes[i].rv = (int32_t)rd_u32(api.rx + 6);
+                done = i + 1;
+                break;
+            }
+        }
+    }
+out:
+    free(ctxs);
+    return rv;
+}
+
+int vpp_api_lcp_add_del(uint32_t sw_if_index, const char *host_if, int is_add) {
+    api_msg_t m;
+    uint32_t ctx;
+
+    if (is_add && (!host_if || !host_if[0] || strlen(host_if) >= 16))
+        return VPP_API_ERR_INVAL;
+    if (!api_has(M_LCP_ITF_PAIR_ADD_DEL))
+        return VPP_API_FALLBACK;
+    ctx = msg_begin(&m, M_LCP_ITF_PAIR_ADD_DEL);
+    msg_u8(&m, is_add ? 1 : 0);
+    msg_u32(&m, sw_if_index);
+    msg_str(&m, is_add ? host_if : NULL, 16);
+    msg_u8(&m, 0);                      /* host_if_type: tap */
+    msg_str(&m, NULL, 32);              /* netns: plugin default */
+    return api_simple(&m, ctx);
+}
@@ -0,0 +1,93 @@
+/*
+ * VPP binary API client for the Klish plugin
+ * One connection to VPP's API socket per klishd session
+ */
+
+#ifndef VPP_API_H
+#define VPP_API_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Overridable with -D, as VPP_CLI_SOCKET is */
+#ifndef VPP_API_SOCKET
+#define VPP_API_SOCKET "/run/vpp/api.sock"
+#endif
+
+/* Return codes besides 0 (success) and VPP's own negative retvals */
+#define VPP_API_FALLBACK    1       /* No API path for this request, use the CLI */
+#define VPP_API_ERR_IO      -1000   /* Connection to VPP lost mid-request */
+#define VPP_API_ERR_INVAL   -1001   /* Malformed argument */
+#define VPP_API_ERR_NOENT   -1002   /* No such interface */
+
+/* Interface as reported by sw_interface_details */
+typedef struct {
+    uint32_t sw_if_index;
+    uint32_t sup_sw_if_index;
+    uint32_t sub_id;
+    uint32_t mtu;           /* L3 MTU */
+    int admin_up;
+    int link_up;
+    char name[64];
+} vpp_api_iface_t;
+
+/* Address as reported by ip_address_details */
+typedef struct {
+    uint32_t sw_if_index;
+    int is_ipv6;
+    char prefix[64];        /* "addr/len" */
+} vpp_api_addr_t;
+
+/* Interface change as reported by sw_interface_event */
+#define VPP_API_RESYNC 0xffffffffu  /* sw_if_index: events may have been missed */
+typedef struct {
+    uint32_t sw_if_index;
+    int admin_up;
+    int link_up;
+    int deleted;
+} vpp_api_iface_event_t;
+
+/* Route for vpp_api_route_batch() */
+typedef struct {
+    char prefix[48];
+    char next_hop[48];
+    uint32_t table_id;
+    uint8_t weight;
+    int rv;                 /* VPP's retval once done */
+} vpp_api_route_t;
+
+typedef void (*vpp_api_iface_fn)(const vpp_api_iface_t *iface, void *arg);
+typedef void (*vpp_api_addr_fn)(const vpp_api_addr_t *addr, void *arg);
+typedef void (*vpp_api_event_fn)(const vpp_api_iface_event_t *ev, void *arg);
+
+/* Connection */
+int vpp_api_connected(void);
+void vpp_api_disconnect(void);
+const char *vpp_api_strerror(int rv);
+int vpp_api_want_interface_events(vpp_api_event_fn fn, void *arg);
+int vpp_api_poll_events(void);
+
+/* Interfaces */
+int vpp_api_iface_dump(vpp_api_iface_fn fn, void *arg);
+int vpp_api_iface_lookup(const char *name, uint32_t *sw_if_index);
+int vpp_api_addr_dump(const uint32_t *sw_if_index, size_t count, vpp_api_addr_fn fn, void *arg);
+int vpp_api_set_admin_state(uint32_t sw_if_index, int up);
+int vpp_api_set_mtu(uint32_t sw_if_index, uint32_t mtu);
+int vpp_api_add_del_address(uint32_t sw_if_index, const char *prefix, int is_add);
+int vpp_api_create_loopback(int instance, uint32_t *sw_if_index);
+int vpp_api_delete_loopback(uint32_t sw_if_index);
+int vpp_api_create_vlan_subif(uint32_t parent, uint32_t vlan_id, uint32_t *sw_if_index);
+int vpp_api_delete_subif(uint32_t sw_if_index);
+
+/* Bonds */
+int vpp_api_bond_create(int id, const char *mode, const char *lb, uint32_t *sw_if_index);
+int vpp_api_bond_delete(uint32_t sw_if_index);
+int vpp_api_bond_add_member(uint32_t bond, uint32_t member);
+int vpp_api_bond_detach_member(uint32_t member);
+
+/* Routes and Linux Control Plane */
+int vpp_api_route_add_del(const char *prefix, const char *next_hop, uint32_t sw_if_index, int is_add);
+int vpp_api_route_batch(vpp_api_route_t *routes, size_t count, int is_add);
+int vpp_api_lcp_add_del(uint32_t sw_if_index, const char *host_if, int is_add);
+
+#endif /* VPP_API_H */
@@ -0,0 +1,581 @@
+/*
+ * Persistent connection to VPP's CLI socket for the Klish plugin
+ * The socket speaks telnet: options are negotiated once per connection,
+ * the prompt is learned at connect time and then delimits every reply.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "vpp_cli.h"
+
+#define TELNET_IAC 255
+#define TELNET_DONT 254
+#define TELNET_DO 253
+#define TELNET_WONT 252
+#define TELNET_WILL 251
+#define TELNET_SB 250
+#define TELNET_SE 240
+#define TELNET_OPT_TTYPE 24
+#define TELNET_TTYPE_IS 0
+#define TELNET_TTYPE_SEND 1
+
+#define CLI_TERMINAL_TYPE "klish"
+#define CLI_CONNECT_TIMEOUT_MS 3000
+#define CLI_READ_TIMEOUT_MS 30000   /* Inactivity limit, e.g. "ping" is slow */
+#define CLI_PROMPT_MAX 64
+#define CLI_TAIL_MAX (CLI_PROMPT_MAX + 2)
+#define CLI_READ_CHUNK 4096
+#define CLI_BATCH_WINDOW 16         /* Batch commands in flight at once */
+
+/* Telnet parser states */
+enum { TN_DATA, TN_IAC, TN_OPT, TN_SB, TN_SB_IAC };
+
+/* Per-session connection state. The owner PID detects a descriptor
+ * inherited across fork, which must not be shared with the parent. */
+static struct {
+    int fd;
+    pid_t owner;
+    char prompt[CLI_PROMPT_MAX];
+    size_t prompt_len;
+    int tn_state;
+    unsigned char tn_cmd;
+    unsigned char sb[8];
+    size_t sb_len;
+} cli = { .fd = -1 };
+
+/* Reply being streamed to a consumer. The last prompt_len bytes are
+ * held back until more data shows they are not the closing prompt, so
+ * memory use does not depend on the size of the output. */
+typedef struct {
+    vpp_cli_output_fn fn;
+    void *arg;
+    int stopped;                /* Consumer asked for no more output */
+    int echo_done;              /* VPP echoes the command line first */
+    int done;                   /* Closing prompt seen */
+    char tail[CLI_TAIL_MAX];    /* Last bytes of the stream, for the prompt */
+    size_t tail_len;
+    char held[CLI_PROMPT_MAX];  /* Output not yet known to be output */
+    size_t held_len;
+} cli_reply_t;
+
+/* Caller's buffer for vpp_cli_exec() */
+typedef struct {
+    char *out;
+    size_t size;
+    size_t len;
+} cli_buf_t;
+
+static int cli_write_all(const void *data, size_t len) {
+    const unsigned char *p = data;
+    while (len > 0) {
+        ssize_t n = send(cli.fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Answer an option request: we only offer a terminal type, which keeps
+ * VPP from waiting for it before printing the first prompt */
+static void telnet_option(unsigned char cmd, unsigned char opt) {
+    unsigned char reply[3] = { TELNET_IAC, 0, opt };
+
+    if (cmd == TELNET_DO)
+        reply[1] = opt == TELNET_OPT_TTYPE ? TELNET_WILL : TELNET_WONT;
+    else
+        return;
+    cli_write_all(reply, sizeof(reply));
+}
+
+static void telnet_subneg(void) {
+    if (cli.sb_len >= 2 && cli.sb[0] == TELNET_OPT_TTYPE && cli.sb[1] == TELNET_TTYPE_SEND) {
+        unsigned char reply[32];
+        size_t n = 0;
+        reply[n++] = TELNET_IAC;
+        reply[n++] = TELNET_SB;
+        reply[n++] = TELNET_OPT_TTYPE;
+        reply[n++] = TELNET_TTYPE_IS;
+        memcpy(reply + n, CLI_TERMINAL_TYPE, strlen(CLI_TERMINAL_TYPE));
+        n += strlen(CLI_TERMINAL_TYPE);
+        reply[n++] = TELNET_IAC;
+        reply[n++] = TELNET_SE;
+        cli_write_all(reply, n);
+    }
+}
+
+/* Strip telnet commands and carriage returns from @data in place.
+ * Parser state persists across reads, so sequences split between two
+ * reads are handled. Returns the length of the remaining text. */
+static size_t filter_telnet(unsigned char *data, size_t len) {
+    size_t j = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = data[i];
+
+        switch (cli.tn_state) {
+        case TN_DATA:
+            if (c == TELNET_IAC)
+                cli.tn_state = TN_IAC;
+            else if (c != '\r' && c != 0)
+                data[j++] = c;
+            break;
+        case TN_IAC:
+            if (c == TELNET_IAC) {
+                data[j++] = c;  /* Escaped IAC */
+                cli.tn_state = TN_DATA;
+            } else if (c == TELNET_SB) {
+                cli.sb_len = 0;
+                cli.tn_state = TN_SB;
+            } else if (c >= TELNET_WILL && c <= TELNET_DONT) {
+                cli.tn_cmd = c;
+                cli.tn_state = TN_OPT;
+            } else {
+                cli.tn_state = TN_DATA;  /* NOP, GA, ... */
+            }
+            break;
+        case TN_OPT:
+            telnet_option(cli.tn_cmd, c);
+            cli.tn_state = TN_DATA;
+            break;
+        case TN_SB:
+            if (c == TELNET_IAC)
+                cli.tn_state = TN_SB_IAC;
+            else if (cli.sb_len < sizeof(cli.sb))
+                cli.sb[cli.sb_len++] = c;
+            break;
+        case TN_SB_IAC:
+            if (c == TELNET_SE) {
+                telnet_subneg();
+                cli.tn_state = TN_DATA;
+            } else {
+                cli.tn_state = TN_SB;
+            }
+            break;
+        }
+    }
+    return j;
+}
+
+/* Read and filter whatever is available within @timeout_ms */
+static ssize_t cli_read(unsigned char *buf, size_t size, int timeout_ms) {
+    for (;;) {
+        struct pollfd pfd = { .fd = cli.fd, .events = POLLIN };
+        int rc = poll(&pfd, 1, timeout_ms);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc <= 0)
+            return -1;
+        ssize_t n = read(cli.fd, buf, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        return (ssize_t)filter_telnet(buf, (size_t)n);
+    }
+}
+
+static void cli_close(void) {
+    if (cli.fd >= 0)
+        close(cli.fd);
+    cli.fd = -1;
+}
+
+static void reply_emit(cli_reply_t *r, const char *data, size_t len) {
+    if (len > 0 && r->fn && !r->stopped && r->fn(data, len, r->arg) != 0)
+        r->stopped = 1;
+}
+
+/* Pass text on to the consumer, dropping the echoed command line */
+static void reply_add(cli_reply_t *r, const char *data, size_t len) {
+    /* Track the tail of the raw stream for prompt detection */
+    if (len >= CLI_TAIL_MAX) {
+        memcpy(r->tail, data + len - CLI_TAIL_MAX, CLI_TAIL_MAX);
+        r->tail_len = CLI_TAIL_MAX;
+    } else {
+        size_t keep = r->tail_len + len > CLI_TAIL_MAX ? CLI_TAIL_MAX - len : r->tail_len;
+        memmove(r->tail, r->tail + r->tail_len - keep, keep);
+        memcpy(r->tail + keep, data, len);
+        r->tail_len = keep + len;
+    }
+
+    if (!r->echo_done) {
+        const char *nl = memchr(data, '\n', len);
+        if (!nl)
+            return;
+        r->echo_done = 1;
+        len -= (size_t)(nl + 1 - data);
+        data = nl + 1;
+    }
+
+    /* Everything but the last prompt_len bytes of the stream is output */
+    size_t total = r->held_len + len;
+    if (total <= cli.prompt_len) {
+        memcpy(r->held + r->held_len, data, len);
+        r->held_len = total;
+        return;
+    }
+    size_t emit = total - cli.prompt_len;
+    size_t from_held = emit < r->held_len ? emit : r->held_len;
+    reply_emit(r, r->held, from_held);
+    reply_emit(r, data, emit - from_held);
+    memmove(r->held, r->held + from_held, r->held_len - from_held);
+    r->held_len -= from_held;
+    memcpy(r->held + r->held_len, data + (emit - from_held), len - (emit - from_held));
+    r->held_len = cli.prompt_len;
+}
+
+/* Feed text from the socket to the reply and return how much of it the
+ * reply takes. It ends with "\n<prompt>"; when commands are pipelined the
+ * next reply may follow in the same read, and is left to the caller. */
+static size_t reply_feed(cli_reply_t *r, const char *data, size_t len) {
+    char win[CLI_TAIL_MAX + CLI_READ_CHUNK];
+    size_t need = cli.prompt_len + 1;
+    size_t wlen = r->tail_len + len;
+    size_t used = len;
+
+    /* Search tail + data; a match lying wholly in the tail would have
+     * ended the reply on an earlier read */
+    memcpy(win, r->tail, r->tail_len);
+    memcpy(win + r->tail_len, data, len);
+    for (const char *p = win; (p = memchr(p, '\n', wlen - (size_t)(p - win))) != NULL; p++) {
+        if (wlen - (size_t)(p - win) < need)
+            break;
+        if (memcmp(p + 1, cli.prompt, cli.prompt_len) == 0) {
+            used = (size_t)(p - win) + need - r->tail_len;
+            r->done = 1;
+            break;
+        }
+    }
+    reply_add(r, data, used);
+    return used;
+}
+
+/* Learn the prompt: send an empty line, then wait until the stream ends
+ * with two identical non-empty lines - the welcome prompt and ours */
+static int cli_learn_prompt(void) {
+    char text[4096];
+    size_t len = 0;
+    unsigned char buf[1024];
+
+    if (cli_write_all("\n", 1) < 0)
+        return -1;
+    for (;;) {
+        ssize_t n = cli_read(buf, sizeof(buf), CLI_CONNECT_TIMEOUT_MS);
+        if (n < 0)
+            return -1;
+        if (len + (size_t)n >= sizeof(text)) {
+            /* Only the end matters; keep the last half */
+            memmove(text, text + sizeof(text) / 2, len - sizeof(text) / 2);
+            len -= sizeof(text) / 2;
+        }
+        memcpy(text + len, buf, (size_t)n);
+        len += (size_t)n;
+        text[len] = 0;
+
+        char *last = strrchr(text, '\n');
+        if (!last || !last[1])
+            continue;
+        size_t plen = strlen(last + 1);
+        if (plen >= CLI_PROMPT_MAX || (size_t)(last - text) < plen)
+            continue;
+        const char *prev = last - plen;
+        if ((prev == text || prev[-1] == '\n') && memcmp(prev, last + 1, plen) == 0) {
+            memcpy(cli.prompt, last + 1, plen);
+            cli.prompt[plen] = 0;
+            cli.prompt_len = plen;
+            return 0;
+        }
+    }
+}
+
+static int cli_send_line(const char *cmd) {
+    size_t len = strlen(cmd);
+    if (cli_write_all(cmd, len) < 0)
+        return -1;
+    return cli_write_all("\n", 1);
+}
+
+/* Run a command on an established connection */
+static int cli_run(const char *cmd, cli_reply_t *r) {
+    unsigned char buf[CLI_READ_CHUNK];
+
+    if (cli_send_line(cmd) < 0)
+        return VPP_CLI_ERR_CONNECT;
+    while (!r->done) {
+        ssize_t n = cli_read(buf, sizeof(buf), CLI_READ_TIMEOUT_MS);
+        if (n < 0) {
+            /* The stream is out of step with our commands now */
+            cli_close();
+            return VPP_CLI_ERR_IO;
+        }
+        /* Anything after the prompt was not asked for; drop it */
+        reply_feed(r, (const char *)buf, (size_t)n);
+    }
+    /* What is still held back is the prompt itself */
+    return 0;
+}
+
+static int cli_open(void) {
+    struct sockaddr_un addr;
+    cli_reply_t r;
+
+    cli.fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (cli.fd < 0)
+        return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, VPP_CLI_SOCKET, sizeof(addr.sun_path) - 1);
+    if (connect(cli.fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        cli_close();
+        return -1;
+    }
+    cli.owner = getpid();
+    cli.tn_state = TN_DATA;
+    cli.prompt_len = 0;
+
+    if (cli_learn_prompt() < 0) {
+        cli_close();
+        return -1;
+    }
+
+    /* Output must never stop at a "--More--" pager prompt */
+    memset(&r, 0, sizeof(r));
+    if (cli_run("set terminal pager off", &r) != 0) {
+        cli_close();
+        return -1;
+    }
+    return 0;
+}
+
+/* Detect a connection VPP closed while we were idle (e.g. VPP restart) */
+static int cli_alive(void) {
+    struct pollfd pfd = { .fd = cli.fd, .events = POLLIN };
+    char c;
+
+    if (poll(&pfd, 1, 0) == 0)
+        return 1;
+    if (recv(cli.fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) > 0) {
+        /* Unsolicited output between commands; discard it */
+        unsigned char buf[1024];
+        while (recv(cli.fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+            ;
+        return 1;
+    }
+    return 0;
+}
+
+/* Make sure this process owns a live connection */
+static int cli_ready(void) {
+    if (cli.fd >= 0 && cli.owner != getpid()) {
+        /* Inherited from the session process; leave its socket alone */
+        close(cli.fd);
+        cli.fd = -1;
+    }
+    if (cli.fd >= 0 && !cli_alive())
+        cli_close();
+    if (cli.fd < 0 && cli_open() < 0)
+        return -1;
+    return 0;
+}
+
+int vpp_cli_connected(void) {
+    return cli_ready() == 0;
+}
+
+/* Execute @cmd, passing its output (without echo and prompt) to @fn in
+ * chunks as it arrives. Output the consumer declines is still drained
+ * from the socket, so the next command starts in step. */
+int vpp_cli_stream(const char *cmd, vpp_cli_output_fn fn, void *arg) {
+    cli_reply_t r;
+    int rv;
+
+    if (cli_ready() < 0)
+        return VPP_CLI_ERR_CONNECT;
+
+    memset(&r, 0, sizeof(r));
+    r.fn = fn;
+    r.arg = arg;
+    rv = cli_run(cmd, &r);
+    if (rv == VPP_CLI_ERR_CONNECT) {
+        /* Nothing reached VPP; reconnect once and retry */
+        cli_close();
+        if (cli_ready() < 0)
+            return VPP_CLI_ERR_CONNECT;
+        rv = cli_run(cmd, &r);
+        if (rv == VPP_CLI_ERR_CONNECT)
+            cli_close();
+    }
+    return rv;
+}
+
+static int buf_append(const char *data, size_t len, void *arg) {
+    cli_buf_t *b = arg;
+    size_t room = b->size - 1 - b->len;
+    size_t n = len < room ? len : room;
+
+    memcpy(b->out + b->len, data, n);
+    b->len += n;
+    b->out[b->len] = 0;
+    return b->len >= b->size - 1;
+}
+
+/* Execute @cmd and copy its output into @out, truncated to @size */
+int vpp_cli_exec(const char *cmd, char *out, size_t size) {
+    cli_buf_t b = { out, size, 0 };
+
+    if (!out || size == 0)
+        return vpp_cli_stream(cmd, NULL, NULL);
+    out[0] = 0;
+    return vpp_cli_stream(cmd, buf_append, &b);
+}
+
+static int batch_append(const char *data, size_t len, void *arg) {
+    vpp_cli_batch_t *c = arg;
+
+    if (c->len + len + 1 > c->size) {
+        size_t size = c->size ? c->size : CLI_READ_CHUNK;
+        while (size < c->len + len + 1)
+            size *= 2;
+        char *out = realloc(c->out, size);
+        if (!out)
+            return 1;
+        c->out = out;
+        c->size = size;
+    }
+    memcpy(c->out + c->len, data, len);
+    c->len += len;
+    c->out[c->len] = 0;
+    return 0;
+}
+
+static void batch_drop(vpp_cli_batch_t *cmds, size_t from, size_t to) {
+    for (size_t i = from; i < to; i++) {
+        free(cmds[i].out);
+        cmds[i].out = NULL;
+        cmds[i].len = cmds[i].size = 0;
+    }
+}
+
+static void batch_reply(cli_reply_t *r, vpp_cli_batch_t *c) {
+    memset(r, 0, sizeof(*r));
+    r->fn = batch_append;
+    r->arg = c;
+}
+
+/* Write the command lines of @cmds[from..to) with a single send */
+static int batch_send(vpp_cli_batch_t *cmds, size_t from, size_t to) {
+    char buf[CLI_READ_CHUNK];
+    size_t len = 0;
+
+    for (size_t i = from; i < to; i++) {
+        size_t n = strlen(cmds[i].cmd);
+        if (len + n + 1 > sizeof(buf)) {
+            if (len > 0 && cli_write_all(buf, len) < 0)
+                return -1;
+            len = 0;
+            if (n + 1 > sizeof(buf)) {
+                if (cli_send_line(cmds[i].cmd) < 0)
+                    return -1;
+                continue;
+            }
+        }
+        memcpy(buf + len, cmds[i].cmd, n);
+        buf[len + n] = '\n';
+        len += n + 1;
+    }
+    return len > 0 ? cli_write_all(buf, len) : 0;
+}
+
+/* Pipeline a batch on an established connection: up to CLI_BATCH_WINDOW
+ * commands are written ahead of the replies being read back */
+static int cli_run_batch(vpp_cli_batch_t *cmds, size_t count) {
+    unsigned char buf[CLI_READ_CHUNK];
+    size_t sent = 0, done = 0;
+    cli_reply_t r;
+
+    batch_reply(&r, &cmds[0]);
+    while (done < count) {
+        if (sent - done < CLI_BATCH_WINDOW / 2 && sent < count) {
+            size_t to = done + CLI_BATCH_WINDOW < count ? done + CLI_BATCH_WINDOW : count;
+            if (batch_send(cmds, sent, to) < 0) {
+                if (sent == 0)
+                    return VPP_CLI_ERR_CONNECT;
+                cli_close();
+                batch_drop(cmds, done, count);
+                return VPP_CLI_ERR_IO;
+            }
+            sent = to;
+        }
+
+        ssize_t n = cli_read(buf, sizeof(buf), CLI_READ_TIMEOUT_MS);
+        if (n < 0) {
+            /* Replies still missing can not be told apart any more */
+            cli_close();
+            batch_drop(cmds, done, count);
+            return VPP_CLI_ERR_IO;
+        }
+        size_t off = 0;
+        while (off < (size_t)n && done < count) {
+            off += reply_feed(&r, (const char *)buf + off, (size_t)n - off);
+            if (!r.done)
+                break;
+            if (!cmds[done].out)
+                batch_append("", 0, &cmds[done]);
+            if (++done < count)
+                batch_reply(&r, &cmds[done]);
+        }
+    }
+    return 0;
+}
+
+/* Execute every command of @cmds over the session connection, pipelined,
+ * collecting each output (without echo and prompt) into its own slot.
+ * On error, slots of commands that did not complete have a NULL out. */
+int vpp_cli_batch(vpp_cli_batch_t *cmds, size_t count) {
+    int rv;
+
+    for (size_t i = 0; i < count; i++) {
+        cmds[i].out = NULL;
+        cmds[i].len = cmds[i].size = 0;
+    }
+    if (count == 0)
+        return 0;
+    if (cli_ready() < 0)
+        return VPP_CLI_ERR_CONNECT;
+
+    rv = cli_run_batch(cmds, count);
+    if (rv == VPP_CLI_ERR_CONNECT) {
+        /* Nothing reached VPP; reconnect once and retry */
+        cli_close();
+        if (cli_ready() < 0)
+            return VPP_CLI_ERR_CONNECT;
+        rv = cli_run_batch(cmds, count);
+        if (rv == VPP_CLI_ERR_CONNECT)
+            cli_close();
+    }
+    return rv;
+}
+
+void vpp_cli_batch_free(vpp_cli_batch_t *cmds, size_t count) {
+    batch_drop(cmds, 0, count);
+}
+
+void vpp_cli_disconnect(void) {
+    if (cli.fd >= 0 && cli.owner == getpid())
+        cli_close();
+    cli.fd = -1;
+}
@@ -0,0 +1,37 @@
+/*
+ * Persistent connection to VPP's CLI socket for the Klish plugin
+ */
+
+#ifndef VPP_CLI_H
+#define VPP_CLI_H
+
+#include <stddef.h>
+
+/* Overridable at build time, e.g. to run against a fake VPP */
+#ifndef VPP_CLI_SOCKET
+#define VPP_CLI_SOCKET "/run/vpp/cli.sock"
+#endif
+
+/* Return codes besides 0 (success) */
+#define VPP_CLI_ERR_CONNECT -1  /* Nothing was sent, safe to retry elsewhere */
+#define VPP_CLI_ERR_IO      -2  /* Connection lost after the command was sent */
+
+/* Receives output chunks as they arrive; return non-zero to discard the rest */
+typedef int (*vpp_cli_output_fn)(const char *data, size_t len, void *arg);
+
+/* One command of a batch and its collected output */
+typedef struct {
+    const char *cmd;
+    char *out;      /* NUL-terminated; NULL if the command did not complete */
+    size_t len;
+    size_t size;
+} vpp_cli_batch_t;
+
+int vpp_cli_stream(const char *cmd, vpp_cli_output_fn fn, void *arg);
+int vpp_cli_exec(const char *cmd, char *out, size_t size);
+int vpp_cli_batch(vpp_cli_batch_t *cmds, size_t count);
+void vpp_cli_batch_free(vpp_cli_batch_t *cmds, size_t count);
+int vpp_cli_connected(void);
+void vpp_cli_disconnect(void);
+
+#endif /* VPP_CLI_H */
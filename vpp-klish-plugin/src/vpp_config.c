@@ -0,0 +1,596 @@
+/*
+ * Configuration changes for the Klish plugin
+ * Operations are ordered by a stable counting sort on their section, so
+ * within a section they keep the order they were given in. VPP runs CLI
+ * commands one after another, which lets a whole section share a batch.
+ *
+ * Two configurations are compared object by object. An object is keyed by
+ * its section and interface for settings an interface has one of, and by
+ * the whole command for addresses and routes, which an interface or the
+ * table may have many of; keys are hashed, so a diff costs linear time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#include "vpp_cli.h"
+#include "vpp_config.h"
+#include "vpp_routes.h"
+
+static const char *section_names[VPP_CFG_SECTIONS] = {
+    [VPP_CFG_CREATE] = "interfaces",
+    [VPP_CFG_MEMBER] = "bond members",
+    [VPP_CFG_SUBIF] = "subinterfaces",
+    [VPP_CFG_MTU] = "mtu",
+    [VPP_CFG_ADDRESS] = "addresses",
+    [VPP_CFG_STATE] = "interface state",
+    [VPP_CFG_LCP] = "lcp",
+    [VPP_CFG_ROUTE] = "routes",
+    [VPP_CFG_DELETE] = "deletions",
+};
+
+const char *vpp_cfg_section_name(int section) {
+    if (section < 0 || section >= VPP_CFG_SECTIONS)
+        return "unknown";
+    return section_names[section];
+}
+
+int vpp_cfg_add(vpp_cfg_ops_t *ops, int section, const char *iface, const char *fmt, ...) {
+    va_list ap;
+
+    if (section < 0 || section >= VPP_CFG_SECTIONS)
+        return -1;
+    if (ops->count == ops->cap) {
+        size_t cap = ops->cap ? ops->cap * 2 : 64;
+        vpp_cfg_op_t *grown = realloc(ops->ops, cap * sizeof(*grown));
+        if (!grown)
+            return -1;
+        ops->ops = grown;
+        ops->cap = cap;
+    }
+    vpp_cfg_op_t *op = &ops->ops[ops->count];
+    op->section = section;
+    snprintf(op->iface, sizeof(op->iface), "%s", iface ? iface : "");
+    va_start(ap, fmt);
+    vsnprintf(op->cmd, sizeof(op->cmd), fmt, ap);
+    va_end(ap);
+    op->line = 0;
+    ops->count++;
+    return 0;
+}
+
+static int is_create(const vpp_cfg_op_t *op) {
+    return op->section == VPP_CFG_CREATE || op->section == VPP_CFG_SUBIF;
+}
+
+/* Whether some operation creates @iface */
+int vpp_cfg_creates(const vpp_cfg_ops_t *ops, const char *iface) {
+    for (size_t i = 0; i < ops->count; i++) {
+        if (is_create(&ops->ops[i]) && strcmp(ops->ops[i].iface, iface) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* Fill @order with operation indexes in push order */
+size_t vpp_cfg_order(const vpp_cfg_ops_t *ops, size_t *order) {
+    size_t start[VPP_CFG_SECTIONS + 1] = { 0 };
+
+    for (size_t i = 0; i < ops->count; i++)
+        start[ops->ops[i].section + 1]++;
+    for (int s = 0; s < VPP_CFG_SECTIONS; s++)
+        start[s + 1] += start[s];
+    for (size_t i = 0; i < ops->count; i++)
+        order[start[ops->ops[i].section]++] = i;
+    return ops->count;
+}
+
+#define LINE_FIELDS 12
+
+static size_t split_fields(vpp_sv_t line, vpp_sv_t *f) {
+    size_t n = 0;
+
+    while (n < LINE_FIELDS && vpp_sv_field(&line, &f[n]))
+        n++;
+    return n;
+}
+
+/* Read one line of a saved configuration as write-memory produces it;
+ * returns 0 if it was added, 1 for blank lines and comments and -1 for
+ * a command that does not belong in one */
+int vpp_cfg_parse_line(vpp_cfg_ops_t *ops, vpp_sv_t line, unsigned int lineno) {
+    vpp_sv_t f[LINE_FIELDS];
+    size_t n = split_fields(line, f);
+    char iface[64] = "";
+    int section = -1;
+
+    if (n == 0 || f[0].p[0] == '#' || f[0].p[0] == '!')
+        return 1;
+
+    if (n >= 3 && vpp_sv_eq(f[0], "create") && vpp_sv_eq(f[1], "loopback")) {
+        section = VPP_CFG_CREATE;
+        if (n == 5 && vpp_sv_eq(f[3], "instance"))
+            snprintf(iface, sizeof(iface), "loop%.*s", (int)f[4].len, f[4].p);
+    } else if (n >= 3 && vpp_sv_eq(f[0], "create") && vpp_sv_eq(f[1], "bond")) {
+        section = VPP_CFG_CREATE;
+        for (size_t i = 2; i + 1 < n; i++) {
+            if (vpp_sv_eq(f[i], "id"))
+                snprintf(iface, sizeof(iface), "BondEthernet%.*s", (int)f[i + 1].len, f[i + 1].p);
+        }
+    } else if (n >= 4 && vpp_sv_eq(f[0], "create") && vpp_sv_eq(f[1], "sub")) {
+        section = VPP_CFG_SUBIF;
+        snprintf(iface, sizeof(iface), "%.*s.%.*s", (int)f[2].len, f[2].p, (int)f[3].len, f[3].p);
+    } else if (n == 4 && vpp_sv_eq(f[0], "bond") && vpp_sv_eq(f[1], "add")) {
+        section = VPP_CFG_MEMBER;
+        vpp_sv_copy(f[3], iface, sizeof(iface));
+    } else if (n >= 3 && vpp_sv_eq(f[0], "set") && vpp_sv_eq(f[1], "interface")) {
+        if (n == 6 && vpp_sv_eq(f[2], "mtu") && vpp_sv_eq(f[3], "packet")) {
+            section = VPP_CFG_MTU;
+            vpp_sv_copy(f[5], iface, sizeof(iface));
+        } else if (n >= 6 && vpp_sv_eq(f[2], "ip") && vpp_sv_eq(f[3], "address")) {
+            section = VPP_CFG_ADDRESS;
+            vpp_sv_copy(f[n == 7 && vpp_sv_eq(f[4], "del") ? 5 : 4], iface, sizeof(iface));
+        } else if (n == 5 && vpp_sv_eq(f[2], "state")) {
+            section = VPP_CFG_STATE;
+            vpp_sv_copy(f[3], iface, sizeof(iface));
+        }
+    } else if (n >= 5 && vpp_sv_eq(f[0], "lcp") && vpp_sv_eq(f[1], "create")) {
+        section = VPP_CFG_LCP;
+        vpp_sv_copy(f[2], iface, sizeof(iface));
+    } else if (n >= 4 && vpp_sv_eq(f[0], "ip") && vpp_sv_eq(f[1], "route")) {
+        section = VPP_CFG_ROUTE;
+    } else if (n == 4 && (vpp_sv_eq(f[0], "ip") || vpp_sv_eq(f[0], "ip6")) &&
+               vpp_sv_eq(f[1], "table") && vpp_sv_eq(f[2], "add")) {
+        /* Ahead of the routes in it, as write-memory puts it */
+        section = VPP_CFG_ROUTE;
+    }
+    if (section < 0)
+        return -1;
+
+    /* Keep the command as written, without surrounding blanks */
+    const char *end = f[n - 1].p + f[n - 1].len;
+    if (vpp_cfg_add(ops, section, iface, "%.*s", (int)(end - f[0].p), f[0].p) < 0)
+        return -1;
+    ops->ops[ops->count - 1].line = lineno;
+    return 0;
+}
+
+static int has_addr(const vpp_ift_t *t, const vpp_ift_iface_t *row, vpp_sv_t prefix) {
+    for (size_t i = 0; i < row->addr_count; i++) {
+        if (vpp_sv_eq(prefix, t->addrs[row->addr_first + i].prefix))
+            return 1;
+    }
+    return 0;
+}
+
+/* Whether @t shows that @op would change nothing */
+static int in_effect(const vpp_cfg_op_t *op, const vpp_ift_t *t) {
+    const vpp_ift_iface_t *row = op->iface[0] ? vpp_ift_find(t, op->iface) : NULL;
+    vpp_sv_t f[LINE_FIELDS];
+    size_t n;
+    uint32_t mtu;
+
+    if (!row)
+        return 0;
+    n = split_fields(vpp_sv(op->cmd, strlen(op->cmd)), f);
+    switch (op->section) {
+    case VPP_CFG_CREATE:
+    case VPP_CFG_SUBIF:
+        return 1;
+    case VPP_CFG_MEMBER:
+        return vpp_sv_eq(f[1], "add") && vpp_sv_eq(f[2], row->bond);
+    case VPP_CFG_MTU:
+        return vpp_sv_u32(f[4], &mtu) == 0 && mtu == row->mtu;
+    case VPP_CFG_ADDRESS:
+        return n == 6 && has_addr(t, row, f[5]);
+    case VPP_CFG_STATE:
+        return vpp_sv_eq(f[4], "up") == row->admin_up;
+    case VPP_CFG_LCP:
+        return vpp_sv_eq(f[1], "create") && vpp_sv_eq(f[4], row->lcp_host);
+    default:
+        return 0;
+    }
+}
+
+/* Drop operations whose effect @t already shows, so applying a saved
+ * configuration to a box that has most of it costs only the difference;
+ * returns how many were dropped */
+size_t vpp_cfg_prune(vpp_cfg_ops_t *ops, const vpp_ift_t *t) {
+    size_t kept = 0;
+
+    for (size_t i = 0; i < ops->count; i++) {
+        if (!in_effect(&ops->ops[i], t))
+            ops->ops[kept++] = ops->ops[i];
+    }
+    size_t dropped = ops->count - kept;
+    ops->count = kept;
+    return dropped;
+}
+
+static int name_cmp(const void *a, const void *b) {
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+static int in_names(const char **names, size_t count, const char *name) {
+    return bsearch(&name, names, count, sizeof(*names), name_cmp) != NULL;
+}
+
+/* Check that every operation refers to interfaces that exist in @t or are
+ * created along the way; returns the number of problems found */
+int vpp_cfg_validate(const vpp_cfg_ops_t *ops, const vpp_ift_t *t,
+                     vpp_cfg_error_fn fn, void *arg) {
+    const char **created = malloc((ops->count ? ops->count : 1) * sizeof(*created));
+    const char **deleted = malloc((ops->count ? ops->count : 1) * sizeof(*deleted));
+    size_t ncreated = 0, ndeleted = 0;
+    int problems = 0;
+
+    if (!created || !deleted) {
+        free(created);
+        free(deleted);
+        return -1;
+    }
+    for (size_t i = 0; i < ops->count; i++) {
+        if (is_create(&ops->ops[i]))
+            created[ncreated++] = ops->ops[i].iface;
+        else if (ops->ops[i].section == VPP_CFG_DELETE)
+            deleted[ndeleted++] = ops->ops[i].iface;
+    }
+    qsort(created, ncreated, sizeof(*created), name_cmp);
+    qsort(deleted, ndeleted, sizeof(*deleted), name_cmp);
+
+    for (size_t i = 0; i < ops->count; i++) {
+        const vpp_cfg_op_t *op = &ops->ops[i];
+        const char *dot = strchr(op->iface, '.');
+        char parent[64];
+
+        if (!op->iface[0])
+            continue;
+        if (is_create(op)) {
+            if (vpp_ift_find(t, op->iface)) {
+                fn(op, "interface already exists", arg);
+                problems++;
+            } else if (op->section == VPP_CFG_SUBIF && dot) {
+                snprintf(parent, sizeof(parent), "%.*s", (int)(dot - op->iface), op->iface);
+                if (!vpp_ift_find(t, parent) && !in_names(created, ncreated, parent)) {
+                    fn(op, "parent interface does not exist", arg);
+                    problems++;
+                }
+            }
+        } else if (!vpp_ift_find(t, op->iface) && !in_names(created, ncreated, op->iface)) {
+            fn(op, "interface does not exist", arg);
+            problems++;
+        } else if (op->section != VPP_CFG_DELETE && in_names(deleted, ndeleted, op->iface)) {
+            fn(op, "interface is also being deleted", arg);
+            problems++;
+        }
+    }
+    free(created);
+    free(deleted);
+    return problems;
+}
+
+/* VPP says nothing when a command succeeds, except that creating an
+ * interface prints its name; anything else is the reason it failed */
+static int op_failed(const vpp_cli_batch_t *cmd) {
+    const char *p = cmd->out;
+    int words = 0;
+
+    if (!p)
+        return 1;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+            p++;
+        if (!*p)
+            break;
+        words++;
+        while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+            p++;
+    }
+    return words > 1;
+}
+
+static uint64_t now_usec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/* Record the routes VPP took in a pushed section, in runs of adds and
+ * deletes so that a route added and then deleted ends up deleted */
+static void record_routes(const vpp_cfg_ops_t *ops, const size_t *order,
+                          const vpp_cli_batch_t *batch, size_t n) {
+    vpp_route_t *run = malloc((n ? n : 1) * sizeof(*run));
+    size_t len = 0;
+    int run_add = 1, is_add;
+
+    if (!run)
+        return;
+    for (size_t i = 0; i < n; i++) {
+        const char *cmd = ops->ops[order[i]].cmd;
+
+        if (op_failed(&batch[i]) ||
+            vpp_route_parse(vpp_sv(cmd, strlen(cmd)), &run[len], &is_add) < 0)
+            continue;
+        if (len && is_add != run_add) {
+            vpp_routes_record(run, len, run_add);
+            run[0] = run[len];
+            len = 0;
+        }
+        run_add = is_add;
+        len++;
+    }
+    vpp_routes_record(run, len, run_add);
+    free(run);
+}
+
+/* Push @ops section by section, filling @stats (if given) per section;
+ * returns how many VPP rejected, or a VPP_CLI_ERR_ code if the connection
+ * failed */
+int vpp_cfg_push(const vpp_cfg_ops_t *ops, vpp_cfg_stats_t *stats,
+                 vpp_cfg_error_fn fn, void *arg) {
+    size_t *order = malloc((ops->count ? ops->count : 1) * sizeof(*order));
+    vpp_cli_batch_t *batch = calloc(ops->count ? ops->count : 1, sizeof(*batch));
+    int failed = 0;
+
+    if (!order || !batch) {
+        free(order);
+        free(batch);
+        return VPP_CLI_ERR_CONNECT;
+    }
+    vpp_cfg_order(ops, order);
+    if (stats)
+        memset(stats, 0, VPP_CFG_SECTIONS * sizeof(*stats));
+
+    for (size_t first = 0; first < ops->count; ) {
+        int section = ops->ops[order[first]].section;
+        uint64_t started = now_usec();
+        size_t n = 0, section_failed = 0;
+
+        while (first + n < ops->count && ops->ops[order[first + n]].section == section) {
+            batch[n].cmd = ops->ops[order[first + n]].cmd;
+            n++;
+        }
+        int rv = vpp_cli_batch(batch, n);
+        for (size_t i = 0; rv == 0 && i < n; i++) {
+            if (op_failed(&batch[i])) {
+                const char *why = batch[i].out ? batch[i].out : "no reply from VPP";
+                fn(&ops->ops[order[first + i]], why, arg);
+                section_failed++;
+            }
+        }
+        if (rv == 0 && section == VPP_CFG_ROUTE)
+            record_routes(ops, order + first, batch, n);
+        failed += (int)section_failed;
+        if (stats) {
+            stats[section].ops = n;
+            stats[section].failed = section_failed;
+            stats[section].usec = now_usec() - started;
+        }
+        vpp_cli_batch_free(batch, n);
+        if (rv != 0) {
+            failed = rv;
+            break;
+        }
+        first += n;
+    }
+    free(order);
+    free(batch);
+    return failed;
+}
+
+static vpp_sv_t op_key(const vpp_cfg_op_t *op) {
+    if (op->section == VPP_CFG_ADDRESS || op->section == VPP_CFG_ROUTE || !op->iface[0])
+        return vpp_sv(op->cmd, strlen(op->cmd));
+    return vpp_sv(op->iface, strlen(op->iface));
+}
+
+static uint64_t op_hash(const vpp_cfg_op_t *op) {
+    vpp_sv_t key = op_key(op);
+    uint64_t h = 14695981039346656037ULL ^ (uint64_t)op->section;
+
+    h *= 1099511628211ULL;
+    for (size_t i = 0; i < key.len; i++) {
+        h ^= (unsigned char)key.p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static int same_key(const vpp_cfg_op_t *a, const vpp_cfg_op_t *b) {
+    vpp_sv_t ka = op_key(a), kb = op_key(b);
+    return a->section == b->section && ka.len == kb.len && memcmp(ka.p, kb.p, ka.len) == 0;
+}
+
+/* Compare @from with @to; @diff receives what @to adds, removes and
+ * changes, in push order */
+int vpp_cfg_diff(const vpp_cfg_ops_t *from, const vpp_cfg_ops_t *to, vpp_cfg_diff_t *diff) {
+    size_t mask = 63, n = 0;
+    size_t start[VPP_CFG_SECTIONS + 1] = { 0 };
+
+    while (mask + 1 < 2 * from->count)
+        mask = mask * 2 + 1;
+    size_t *slot = calloc(mask + 1, sizeof(*slot));     /* From index + 1 */
+    char *matched = calloc(from->count ? from->count : 1, 1);
+    vpp_cfg_delta_t *found = malloc((from->count + to->count + 1) * sizeof(*found));
+    diff->items = malloc((from->count + to->count + 1) * sizeof(*diff->items));
+    diff->count = 0;
+    if (!slot || !matched || !found || !diff->items) {
+        free(slot);
+        free(matched);
+        free(found);
+        vpp_cfg_diff_free(diff);
+        return -1;
+    }
+
+    /* Where a configuration sets something twice, the later one is what
+     * takes effect */
+    for (size_t i = 0; i < from->count; i++) {
+        size_t h = (size_t)op_hash(&from->ops[i]) & mask;
+        while (slot[h] && !same_key(&from->ops[slot[h] - 1], &from->ops[i]))
+            h = (h + 1) & mask;
+        if (slot[h])
+            matched[slot[h] - 1] = 1;
+        slot[h] = i + 1;
+    }
+
+    for (size_t i = 0; i < to->count; i++) {
+        const vpp_cfg_op_t *op = &to->ops[i];
+        size_t h = (size_t)op_hash(op) & mask;
+        while (slot[h] && !same_key(&from->ops[slot[h] - 1], op))
+            h = (h + 1) & mask;
+        if (!slot[h]) {
+            found[n++] = (vpp_cfg_delta_t){ VPP_CFG_ADDED, NULL, op };
+            continue;
+        }
+        const vpp_cfg_op_t *old = &from->ops[slot[h] - 1];
+        matched[slot[h] - 1] = 1;
+        if (strcmp(old->cmd, op->cmd) != 0)
+            found[n++] = (vpp_cfg_delta_t){ VPP_CFG_CHANGED, old, op };
+    }
+    for (size_t i = 0; i < from->count; i++) {
+        if (!matched[i])
+            found[n++] = (vpp_cfg_delta_t){ VPP_CFG_REMOVED, &from->ops[i], NULL };
+    }
+
+    /* Stable counting sort on the section, as for pushing */
+    for (size_t i = 0; i < n; i++)
+        start[(found[i].to ? found[i].to : found[i].from)->section + 1]++;
+    for (int s = 0; s < VPP_CFG_SECTIONS; s++)
+        start[s + 1] += start[s];
+    for (size_t i = 0; i < n; i++)
+        diff->items[start[(found[i].to ? found[i].to : found[i].from)->section]++] = found[i];
+    diff->count = n;
+
+    free(slot);
+    free(matched);
+    free(found);
+    return 0;
+}
+
+static int names_bond(const vpp_cfg_op_t *op, const char *bond) {
+    vpp_sv_t f[LINE_FIELDS];
+    size_t n = split_fields(vpp_sv(op->cmd, strlen(op->cmd)), f);
+    return op->section == VPP_CFG_MEMBER && n == 4 && vpp_sv_eq(f[2], bond);
+}
+
+/* The command that takes back what @op did, 0 if there is nothing to take
+ * back, -1 if out of memory */
+static int undo_op(vpp_cfg_ops_t *undo, const vpp_cfg_op_t *op) {
+    vpp_sv_t f[LINE_FIELDS];
+    size_t n = split_fields(vpp_sv(op->cmd, strlen(op->cmd)), f);
+
+    switch (op->section) {
+    case VPP_CFG_CREATE:
+        if (strncmp(op->iface, "loop", 4) == 0)
+            return vpp_cfg_add(undo, VPP_CFG_DELETE, op->iface,
+                               "delete loopback interface intfc %s", op->iface);
+        return vpp_cfg_add(undo, VPP_CFG_DELETE, op->iface, "delete bond %s", op->iface);
+    case VPP_CFG_SUBIF:
+        return vpp_cfg_add(undo, VPP_CFG_DELETE, op->iface, "delete sub %s", op->iface);
+    case VPP_CFG_MEMBER:
+        return vpp_cfg_add(undo, VPP_CFG_MEMBER, op->iface, "bond del %s", op->iface);
+    case VPP_CFG_ADDRESS:
+        if (n != 6)
+            return 0;
+        return vpp_cfg_add(undo, VPP_CFG_ADDRESS, op->iface, "set interface ip address del %s %.*s",
+                           op->iface, (int)f[5].len, f[5].p);
+    case VPP_CFG_STATE:
+        return vpp_cfg_add(undo, VPP_CFG_STATE, op->iface, "set interface state %s down", op->iface);
+    case VPP_CFG_LCP:
+        return vpp_cfg_add(undo, VPP_CFG_LCP, op->iface, "lcp delete %s", op->iface);
+    case VPP_CFG_ROUTE:
+        /* A table may be holding routes from elsewhere; leave it */
+        if (n < 3 || !vpp_sv_eq(f[1], "route") || !vpp_sv_eq(f[2], "add"))
+            return 0;
+        return vpp_cfg_add(undo, VPP_CFG_ROUTE, NULL, "ip route del%s", f[2].p + f[2].len);
+    default:
+        return 0;
+    }
+}
+
+static int is_recreated(const vpp_cfg_delta_t *d) {
+    return d->change == VPP_CFG_CHANGED && is_create(d->to);
+}
+
+/*
+ * Commands that turn @from into @to, changing only what differs: @undo
+ * takes back what @from has and @to does not, and is pushed first; @redo
+ * adds what @to has. Nothing is taken back from an interface that is
+ * deleted anyway. A bond whose mode or load-balance changed can only be
+ * deleted and created again, which takes everything on it along, so all
+ * of @to that refers to it is redone.
+ */
+int vpp_cfg_delta(const vpp_cfg_ops_t *from, const vpp_cfg_ops_t *to,
+                  vpp_cfg_ops_t *undo, vpp_cfg_ops_t *redo) {
+    vpp_cfg_diff_t diff;
+    const char **gone, **recreated;
+    size_t ngone = 0, nrecreated = 0;
+    int rv = 0;
+
+    if (vpp_cfg_diff(from, to, &diff) < 0)
+        return -1;
+    gone = malloc((diff.count ? diff.count : 1) * 2 * sizeof(*gone));
+    if (!gone) {
+        vpp_cfg_diff_free(&diff);
+        return -1;
+    }
+    recreated = gone + (diff.count ? diff.count : 1);
+    for (size_t i = 0; i < diff.count; i++) {
+        const vpp_cfg_delta_t *d = &diff.items[i];
+        if (d->from && is_create(d->from) && (d->change == VPP_CFG_REMOVED || is_recreated(d)))
+            gone[ngone++] = d->from->iface;
+        if (is_recreated(d))
+            recreated[nrecreated++] = d->to->iface;
+    }
+    qsort(gone, ngone, sizeof(*gone), name_cmp);
+    qsort(recreated, nrecreated, sizeof(*recreated), name_cmp);
+
+    /* Taken back in reverse, so subinterfaces go before their parents */
+    for (size_t i = diff.count; rv == 0 && i-- > 0; ) {
+        const vpp_cfg_delta_t *d = &diff.items[i];
+        if (!d->from)
+            continue;
+        if (!is_create(d->from) && in_names(gone, ngone, d->from->iface))
+            continue;
+        if (d->change == VPP_CFG_REMOVED || is_create(d->from) ||
+            d->from->section == VPP_CFG_MEMBER || d->from->section == VPP_CFG_LCP)
+            rv = undo_op(undo, d->from);
+    }
+
+    for (size_t i = 0; rv == 0 && i < diff.count; i++) {
+        const vpp_cfg_delta_t *d = &diff.items[i];
+        if (d->to && !in_names(recreated, nrecreated, d->to->iface))
+            rv = vpp_cfg_add(redo, d->to->section, d->to->iface, "%s", d->to->cmd);
+    }
+    for (size_t i = 0; rv == 0 && nrecreated && i < to->count; i++) {
+        const vpp_cfg_op_t *op = &to->ops[i];
+        if (in_names(recreated, nrecreated, op->iface)) {
+            rv = vpp_cfg_add(redo, op->section, op->iface, "%s", op->cmd);
+            continue;
+        }
+        for (size_t j = 0; rv == 0 && j < nrecreated; j++) {
+            if (names_bond(op, recreated[j])) {
+                rv = vpp_cfg_add(redo, op->section, op->iface, "%s", op->cmd);
+                break;
+            }
+        }
+    }
+    free(gone);
+    vpp_cfg_diff_free(&diff);
+    return rv;
+}
+
+void vpp_cfg_diff_free(vpp_cfg_diff_t *diff) {
+    free(diff->items);
+    diff->items = NULL;
+    diff->count = 0;
+}
+
+void vpp_cfg_clear(vpp_cfg_ops_t *ops) {
+    free(ops->ops);
+    ops->ops = NULL;
+    ops->count = ops->cap = 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * Configuration changes for the Klish plugin
+ * A change is a VPP CLI command tagged with the kind of object it touches.
+ * Pushing a list runs the kinds in dependency order, each as one pipelined
+ * batch, so a large change costs a few round trips rather than one per line.
+ */
+
+#ifndef VPP_CONFIG_H
+#define VPP_CONFIG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vpp_iftable.h"
+#include "vpp_text.h"
+
+/* Sections in the order they are pushed */
+enum {
+    VPP_CFG_CREATE,     /* Loopbacks and bonds */
+    VPP_CFG_MEMBER,     /* Bond membership */
+    VPP_CFG_SUBIF,      /* VLAN subinterfaces */
+    VPP_CFG_MTU,
+    VPP_CFG_ADDRESS,
+    VPP_CFG_STATE,
+    VPP_CFG_LCP,
+    VPP_CFG_ROUTE,
+    VPP_CFG_DELETE,     /* Interfaces removed, after whatever referred to them */
+    VPP_CFG_SECTIONS
+};
+
+typedef struct {
+    int section;
+    char iface[64];     /* Interface created, changed or removed; empty for routes */
+    char cmd[256];
+    unsigned int line;  /* Line of the file it was read from, 0 if typed */
+} vpp_cfg_op_t;
+
+typedef struct {
+    vpp_cfg_op_t *ops;
+    size_t count;
+    size_t cap;
+} vpp_cfg_ops_t;
+
+/* What a push did in one section */
+typedef struct {
+    size_t ops;
+    size_t failed;
+    uint64_t usec;
+} vpp_cfg_stats_t;
+
+enum { VPP_CFG_ADDED, VPP_CFG_REMOVED, VPP_CFG_CHANGED };
+
+/* One object that differs between two configurations */
+typedef struct {
+    int change;
+    const vpp_cfg_op_t *from;   /* NULL if added */
+    const vpp_cfg_op_t *to;     /* NULL if removed */
+} vpp_cfg_delta_t;
+
+/* Differences in push order */
+typedef struct {
+    vpp_cfg_delta_t *items;
+    size_t count;
+} vpp_cfg_diff_t;
+
+/* Receives each operation that failed validation or that VPP rejected */
+typedef void (*vpp_cfg_error_fn)(const vpp_cfg_op_t *op, const char *error, void *arg);
+
+int vpp_cfg_add(vpp_cfg_ops_t *ops, int section, const char *iface, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+int vpp_cfg_creates(const vpp_cfg_ops_t *ops, const char *iface);
+size_t vpp_cfg_order(const vpp_cfg_ops_t *ops, size_t *order);
+int vpp_cfg_parse_line(vpp_cfg_ops_t *ops, vpp_sv_t line, unsigned int lineno);
+size_t vpp_cfg_prune(vpp_cfg_ops_t *ops, const vpp_ift_t *t);
+int vpp_cfg_validate(const vpp_cfg_ops_t *ops, const vpp_ift_t *t,
+                     vpp_cfg_error_fn fn, void *arg);
+int vpp_cfg_push(const vpp_cfg_ops_t *ops, vpp_cfg_stats_t *stats,
+                 vpp_cfg_error_fn fn, void *arg);
+int vpp_cfg_diff(const vpp_cfg_ops_t *from, const vpp_cfg_ops_t *to, vpp_cfg_diff_t *diff);
+int vpp_cfg_delta(const vpp_cfg_ops_t *from, const vpp_cfg_ops_t *to,
+                  vpp_cfg_ops_t *undo, vpp_cfg_ops_t *redo);
+void vpp_cfg_diff_free(vpp_cfg_diff_t *diff);
+const char *vpp_cfg_section_name(int section);
+void vpp_cfg_clear(vpp_cfg_ops_t *ops);
+
+#endif /* VPP_CONFIG_H */
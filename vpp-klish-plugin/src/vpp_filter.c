@@ -0,0 +1,213 @@
+/*
+ * Output modifiers for the Klish plugin
+ * Output is taken a chunk at a time. The complete lines of a chunk are
+ * searched as one block: a pattern without regex syntax is found with
+ * memmem and only the lines it hits are located, so text that does not
+ * match is skipped without being split into lines. Regexes are tried
+ * line by line in place. Only a line cut by the chunk end is copied.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+
+#include "vpp_filter.h"
+
+static void emit(vpp_filter_t *f, const char *p, size_t len) {
+    if (len && !f->stopped && f->out(p, len, f->arg) != 0)
+        f->stopped = 1;
+}
+
+static int matches(vpp_filter_t *f, const char *p, size_t len) {
+    if (f->is_regex) {
+        regmatch_t m[1];
+        char buf[VPP_FILTER_LINE_MAX + 1];
+
+        /* regexec needs a terminated string */
+        if (len > VPP_FILTER_LINE_MAX)
+            len = VPP_FILTER_LINE_MAX;
+        memcpy(buf, p, len);
+        buf[len] = 0;
+        return regexec(&f->re, buf, 1, m, 0) == 0;
+    }
+    return !f->literal_len || memmem(p, len, f->literal, f->literal_len) != NULL;
+}
+
+/* One line, with its "\n" unless it was the last of the output */
+static void filter_line(vpp_filter_t *f, const char *p, size_t len) {
+    size_t text = len && p[len - 1] == '\n' ? len - 1 : len;
+
+    switch (f->kind) {
+    case VPP_FILTER_INCLUDE:
+        if (matches(f, p, text))
+            emit(f, p, len);
+        break;
+    case VPP_FILTER_EXCLUDE:
+        if (!matches(f, p, text))
+            emit(f, p, len);
+        break;
+    case VPP_FILTER_BEGIN:
+        if (f->passing || matches(f, p, text)) {
+            f->passing = 1;
+            emit(f, p, len);
+        }
+        break;
+    case VPP_FILTER_SECTION:
+        /* A matching line and the lines indented under it */
+        if (matches(f, p, text))
+            f->passing = 1;
+        else if (!text || (p[0] != ' ' && p[0] != '\t'))
+            f->passing = 0;
+        if (f->passing)
+            emit(f, p, len);
+        break;
+    default:
+        if (matches(f, p, text))
+            f->count++;
+        break;
+    }
+}
+
+static const char *line_start(const char *from, const char *p) {
+    const char *nl = p > from ? memrchr(from, '\n', (size_t)(p - from)) : NULL;
+    return nl ? nl + 1 : from;
+}
+
+static const char *line_end(const char *p, const char *end) {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    return nl ? nl + 1 : end;
+}
+
+/* Complete lines, ending in "\n" */
+static void filter_block(vpp_filter_t *f, const char *p, size_t len) {
+    const char *end = p + len, *hit, *start;
+
+    if (f->is_regex || f->kind == VPP_FILTER_SECTION) {
+        while (p < end && !f->stopped) {
+            const char *next = line_end(p, end);
+            filter_line(f, p, (size_t)(next - p));
+            p = next;
+        }
+        return;
+    }
+    if (f->kind == VPP_FILTER_BEGIN && f->passing) {
+        emit(f, p, len);
+        return;
+    }
+    if (!f->literal_len) {
+        if (f->kind == VPP_FILTER_COUNT) {
+            for (const char *nl = p; (nl = memchr(nl, '\n', (size_t)(end - nl))); nl++)
+                f->count++;
+        } else if (f->kind != VPP_FILTER_EXCLUDE) {
+            emit(f, p, len);
+        }
+        return;
+    }
+
+    while (p < end && !f->stopped) {
+        hit = memmem(p, (size_t)(end - p), f->literal, f->literal_len);
+        if (!hit) {
+            if (f->kind == VPP_FILTER_EXCLUDE)
+                emit(f, p, (size_t)(end - p));
+            return;
+        }
+        start = line_start(p, hit);
+        const char *next = line_end(hit, end);
+        switch (f->kind) {
+        case VPP_FILTER_INCLUDE:
+            emit(f, start, (size_t)(next - start));
+            break;
+        case VPP_FILTER_EXCLUDE:
+            /* Everything up to the matching line passes in one piece */
+            emit(f, p, (size_t)(start - p));
+            break;
+        case VPP_FILTER_BEGIN:
+            f->passing = 1;
+            emit(f, start, (size_t)(end - start));
+            return;
+        default:
+            f->count++;
+            break;
+        }
+        p = next;
+    }
+}
+
+int vpp_filter_init(vpp_filter_t *f, int kind, const char *pattern,
+                    vpp_filter_out_fn out, void *arg, char *err, size_t err_size) {
+    memset(f, 0, sizeof(*f));
+    f->kind = kind;
+    f->out = out;
+    f->arg = arg;
+    if (!pattern)
+        pattern = "";
+
+    if (strpbrk(pattern, ".[]()*+?{}|^$\\") == NULL && strlen(pattern) < sizeof(f->literal)) {
+        f->literal_len = strlen(pattern);
+        memcpy(f->literal, pattern, f->literal_len);
+        return 0;
+    }
+    int rc = regcomp(&f->re, pattern, REG_EXTENDED | REG_NOSUB);
+    if (rc != 0) {
+        regerror(rc, &f->re, err, err_size);
+        return -1;
+    }
+    f->is_regex = 1;
+    return 0;
+}
+
+/* Filter the next chunk of output; non-zero once the receiver stopped */
+int vpp_filter_feed(vpp_filter_t *f, const char *data, size_t len) {
+    while (len && !f->stopped) {
+        const char *nl;
+        size_t n;
+
+        if (!f->line_len && (nl = memrchr(data, '\n', len))) {
+            n = (size_t)(nl - data) + 1;
+            filter_block(f, data, n);
+            data += n;
+            len -= n;
+            continue;
+        }
+        /* Complete the held line, or hold the chunk's last one */
+        nl = memchr(data, '\n', len);
+        n = nl ? (size_t)(nl - data) + 1 : len;
+        if (f->line_len + n > sizeof(f->line)) {
+            n = sizeof(f->line) - f->line_len;
+            nl = NULL;
+            memcpy(f->line + f->line_len, data, n);
+            filter_line(f, f->line, sizeof(f->line));
+            f->line_len = 0;
+        } else {
+            memcpy(f->line + f->line_len, data, n);
+            f->line_len += n;
+            if (nl) {
+                filter_line(f, f->line, f->line_len);
+                f->line_len = 0;
+            }
+        }
+        data += n;
+        len -= n;
+    }
+    return f->stopped;
+}
+
+/* Flush a last line without "\n" and, for count, report the total */
+int vpp_filter_finish(vpp_filter_t *f) {
+    if (f->line_len)
+        filter_line(f, f->line, f->line_len);
+    f->line_len = 0;
+    if (f->kind == VPP_FILTER_COUNT) {
+        char buf[32];
+        int n = snprintf(buf, sizeof(buf), "%llu\n", f->count);
+        emit(f, buf, (size_t)n);
+    }
+    return f->stopped;
+}
+
+void vpp_filter_free(vpp_filter_t *f) {
+    if (f->is_regex)
+        regfree(&f->re);
+    f->is_regex = 0;
+}
@@ -0,0 +1,41 @@
+/*
+ * Output modifiers for the Klish plugin
+ * "| include", "| exclude", "| begin", "| section" and "| count" applied
+ * to output as it streams past, holding at most one partial line.
+ */
+
+#ifndef VPP_FILTER_H
+#define VPP_FILTER_H
+
+#include <stddef.h>
+#include <regex.h>
+
+enum { VPP_FILTER_INCLUDE, VPP_FILTER_EXCLUDE, VPP_FILTER_BEGIN, VPP_FILTER_SECTION, VPP_FILTER_COUNT };
+
+#define VPP_FILTER_LINE_MAX 4096    /* Longer lines are matched in pieces */
+
+/* Receives output that passed the filter; return non-zero to stop */
+typedef int (*vpp_filter_out_fn)(const char *data, size_t len, void *arg);
+
+typedef struct {
+    int kind;
+    char literal[256];          /* Pattern without regex syntax, matched with memmem */
+    size_t literal_len;
+    regex_t re;
+    int is_regex;
+    int passing;                /* Begin: matched already; section: inside one */
+    unsigned long long count;
+    vpp_filter_out_fn out;
+    void *arg;
+    int stopped;
+    char line[VPP_FILTER_LINE_MAX];
+    size_t line_len;
+} vpp_filter_t;
+
+int vpp_filter_init(vpp_filter_t *f, int kind, const char *pattern,
+                    vpp_filter_out_fn out, void *arg, char *err, size_t err_size);
+int vpp_filter_feed(vpp_filter_t *f, const char *data, size_t len);
+int vpp_filter_finish(vpp_filter_t *f);
+void vpp_filter_free(vpp_filter_t *f);
+
+#endif /* VPP_FILTER_H */
@@ -0,0 +1,866 @@
+/*
+ * Cached interface table for the Klish plugin
+ * Interfaces and addresses come from the binary API when it is available,
+ * otherwise from "show interface" and "show interface addr"; bond
+ * membership and LCP pairs are always scraped from the CLI. All CLI
+ * output needed for one refresh is fetched with a single pipelined batch.
+ * With an interface event subscription, admin/link changes and deletions
+ * are applied in place; a new interface triggers a reload.
+ *
+ * Sessions share the table through memory mapped before klishd forks
+ * them: one refresher process talks to VPP and publishes snapshots under
+ * a seqlock, sessions copy them without locking and ask for a refresh
+ * when theirs is stale. Without it, each session loads its own table.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "vpp_api.h"
+#include "vpp_cli.h"
+#include "vpp_iftable.h"
+#include "vpp_text.h"
+
+static struct {
+    vpp_ift_t t;
+    size_t cap;
+    size_t addr_cap;
+    size_t *addr_owner;         /* Row of each address while loading */
+    size_t *index;              /* One block holding the three below */
+    size_t index_cap;
+    size_t *by_name;            /* Row numbers in name order */
+    size_t *name_slot;          /* Hash by name, row + 1, 0 if empty */
+    size_t *idx_slot;           /* Hash by sw_if_index, likewise */
+    size_t slot_mask;
+    unsigned int generation;    /* Bumped by vpp_ift_invalidate() */
+    unsigned int loaded_gen;
+    int loaded;
+    int loading;
+    int live;                   /* Interface events are subscribed */
+    uint64_t loaded_at;
+    unsigned int ttl_ms;
+    vpp_ift_event_t ring[VPP_IFT_EVENT_RING];
+    size_t ring_next;
+    size_t ring_count;
+    int dirty;                  /* Changed by events since published */
+    uint32_t copied_seq;        /* Snapshot this copy was taken from */
+    int shared_valid;
+    int shared_live;
+    uint32_t shared_gen;
+    uint64_t shared_at;
+} ift = { .ttl_ms = VPP_IFT_DEFAULT_TTL_MS, .copied_seq = 1 };
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static vpp_ift_iface_t *ift_add_row(vpp_sv_t name) {
+    if (ift.t.count == ift.cap) {
+        size_t cap = ift.cap ? ift.cap * 2 : 64;
+        vpp_ift_iface_t *rows = realloc(ift.t.ifaces, cap * sizeof(*rows));
+        if (!rows)
+            return NULL;
+        ift.t.ifaces = rows;
+        ift.cap = cap;
+    }
+    vpp_ift_iface_t *row = &ift.t.ifaces[ift.t.count++];
+    memset(row, 0, sizeof(*row));
+    vpp_sv_copy(name, row->name, sizeof(row->name));
+    return row;
+}
+
+static int ift_add_addr(size_t row, vpp_sv_t prefix) {
+    if (ift.t.addr_count == ift.addr_cap) {
+        size_t cap = ift.addr_cap ? ift.addr_cap * 2 : 64;
+        vpp_ift_addr_t *addrs = realloc(ift.t.addrs, cap * sizeof(*addrs));
+        if (!addrs)
+            return -1;
+        ift.t.addrs = addrs;
+        size_t *owner = realloc(ift.addr_owner, cap * sizeof(*owner));
+        if (!owner)
+            return -1;
+        ift.addr_owner = owner;
+        ift.addr_cap = cap;
+    }
+    vpp_ift_addr_t *a = &ift.t.addrs[ift.t.addr_count];
+    memset(a, 0, sizeof(*a));
+    vpp_sv_copy(prefix, a->prefix, sizeof(a->prefix));
+    ift.addr_owner[ift.t.addr_count++] = row;
+    return 0;
+}
+
+static int by_name_cmp(const void *a, const void *b) {
+    return strcmp(ift.t.ifaces[*(const size_t *)a].name,
+                  ift.t.ifaces[*(const size_t *)b].name);
+}
+
+static size_t hash_name(vpp_sv_t name) {
+    size_t h = 2166136261u;
+
+    for (size_t i = 0; i < name.len; i++)
+        h = (h ^ (unsigned char)name.p[i]) * 16777619u;
+    return h;
+}
+
+static size_t hash_index(uint32_t sw_if_index) {
+    return (size_t)sw_if_index * 2654435761u;
+}
+
+/* Rebuild name order and both hashes after rows were added or removed.
+ * Slots are at most half full, so probes stay short at any scale. */
+static int ift_index(void) {
+    size_t slots = 16, need;
+
+    while (slots < ift.t.count * 2)
+        slots *= 2;
+    need = ift.t.count + 2 * slots;
+    if (need > ift.index_cap) {
+        size_t *block = malloc(need * sizeof(*block));
+        if (!block)
+            return -1;
+        free(ift.index);
+        ift.index = block;
+        ift.index_cap = need;
+    }
+    ift.by_name = ift.index;
+    ift.name_slot = ift.by_name + ift.t.count;
+    ift.idx_slot = ift.name_slot + slots;
+    ift.slot_mask = slots - 1;
+    memset(ift.name_slot, 0, 2 * slots * sizeof(size_t));
+
+    for (size_t i = 0; i < ift.t.count; i++) {
+        const vpp_ift_iface_t *row = &ift.t.ifaces[i];
+        size_t h;
+
+        ift.by_name[i] = i;
+        for (h = hash_name(vpp_sv(row->name, strlen(row->name))) & ift.slot_mask; ift.name_slot[h];
+             h = (h + 1) & ift.slot_mask)
+            ;
+        ift.name_slot[h] = i + 1;
+        for (h = hash_index(row->sw_if_index) & ift.slot_mask; ift.idx_slot[h];
+             h = (h + 1) & ift.slot_mask)
+            ;
+        ift.idx_slot[h] = i + 1;
+    }
+    qsort(ift.by_name, ift.t.count, sizeof(size_t), by_name_cmp);
+    return 0;
+}
+
+static vpp_ift_iface_t *ift_lookup(vpp_sv_t name) {
+    if (!ift.index)
+        return NULL;
+    for (size_t h = hash_name(name) & ift.slot_mask; ift.name_slot[h];
+         h = (h + 1) & ift.slot_mask) {
+        vpp_ift_iface_t *row = &ift.t.ifaces[ift.name_slot[h] - 1];
+        if (vpp_sv_eq(name, row->name))
+            return row;
+    }
+    return NULL;
+}
+
+static vpp_ift_iface_t *ift_row_by_index(uint32_t sw_if_index) {
+    if (!ift.index)
+        return NULL;
+    for (size_t h = hash_index(sw_if_index) & ift.slot_mask; ift.idx_slot[h];
+         h = (h + 1) & ift.slot_mask) {
+        vpp_ift_iface_t *row = &ift.t.ifaces[ift.idx_slot[h] - 1];
+        if (row->sw_if_index == sw_if_index)
+            return row;
+    }
+    return NULL;
+}
+
+/* First position in name order whose name's first @len bytes compare
+ * greater than (@after) or not less than @prefix */
+static size_t ift_bound(const char *prefix, size_t len, int after) {
+    size_t lo = 0, hi = ift.t.count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int c = strncmp(ift.t.ifaces[ift.by_name[mid]].name, prefix, len);
+        if (c < 0 || (after && c == 0))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Group addresses by interface, keeping their order within each one */
+static int ift_group_addrs(void) {
+    size_t n = ift.t.addr_count;
+    vpp_ift_addr_t *sorted;
+
+    for (size_t i = 0; i < ift.t.count; i++)
+        ift.t.ifaces[i].addr_count = 0;
+    for (size_t i = 0; i < n; i++)
+        ift.t.ifaces[ift.addr_owner[i]].addr_count++;
+    size_t first = 0;
+    for (size_t i = 0; i < ift.t.count; i++) {
+        ift.t.ifaces[i].addr_first = first;
+        first += ift.t.ifaces[i].addr_count;
+        ift.t.ifaces[i].addr_count = 0;
+    }
+    if (n == 0)
+        return 0;
+
+    sorted = malloc(ift.addr_cap * sizeof(*sorted));
+    if (!sorted)
+        return -1;
+    for (size_t i = 0; i < n; i++) {
+        vpp_ift_iface_t *row = &ift.t.ifaces[ift.addr_owner[i]];
+        sorted[row->addr_first + row->addr_count++] = ift.t.addrs[i];
+    }
+    free(ift.t.addrs);
+    ift.t.addrs = sorted;
+    return 0;
+}
+
+/* Binary API path */
+
+typedef struct {
+    size_t *row_of;             /* sw_if_index -> row + 1, 0 if none */
+    uint32_t max_index;
+    int failed;
+} api_load_t;
+
+static void ift_api_iface(const vpp_api_iface_t *iface, void *arg) {
+    api_load_t *ld = arg;
+    vpp_ift_iface_t *row = ift_add_row(vpp_sv(iface->name, strlen(iface->name)));
+
+    if (!row) {
+        ld->failed = 1;
+        return;
+    }
+    row->sw_if_index = iface->sw_if_index;
+    row->mtu = iface->mtu;
+    row->admin_up = iface->admin_up;
+    row->link_up = iface->link_up;
+    if (iface->sw_if_index > ld->max_index)
+        ld->max_index = iface->sw_if_index;
+}
+
+static void ift_api_addr(const vpp_api_addr_t *addr, void *arg) {
+    api_load_t *ld = arg;
+
+    if (addr->sw_if_index > ld->max_index || !ld->row_of[addr->sw_if_index])
+        return;
+    if (ift_add_addr(ld->row_of[addr->sw_if_index] - 1,
+                     vpp_sv(addr->prefix, strlen(addr->prefix))) < 0)
+        ld->failed = 1;
+}
+
+static int ift_load_api(void) {
+    api_load_t ld = { NULL, 0, 0 };
+    uint32_t *idx;
+    int rv;
+
+    rv = vpp_api_iface_dump(ift_api_iface, &ld);
+    if (rv != 0 || ld.failed)
+        return -1;
+
+    idx = malloc((ift.t.count ? ift.t.count : 1) * sizeof(*idx));
+    ld.row_of = calloc((size_t)ld.max_index + 1, sizeof(*ld.row_of));
+    if (!idx || !ld.row_of) {
+        free(idx);
+        free(ld.row_of);
+        return -1;
+    }
+    for (size_t i = 0; i < ift.t.count; i++) {
+        idx[i] = ift.t.ifaces[i].sw_if_index;
+        ld.row_of[idx[i]] = i + 1;
+    }
+    rv = vpp_api_addr_dump(idx, ift.t.count, ift_api_addr, &ld);
+    free(idx);
+    free(ld.row_of);
+    return rv == 0 && !ld.failed ? 0 : -1;
+}
+
+/* CLI path */
+
+/* "Name  Idx  State  MTU (L3/IP4/IP6/MPLS)  Counter  Count" */
+static int ift_parse_interfaces(vpp_sv_t text) {
+    vpp_sv_t line, name, idx, state, mtu;
+
+    while (vpp_sv_line(&text, &line)) {
+        uint32_t index, l3_mtu = 0;
+
+        if (!line.len || line.p[0] == ' ' || vpp_sv_starts(line, "Name"))
+            continue;
+        if (!vpp_sv_field(&line, &name) || !vpp_sv_field(&line, &idx) ||
+            !vpp_sv_field(&line, &state) || vpp_sv_u32(idx, &index) < 0)
+            continue;
+        if (vpp_sv_field(&line, &mtu))
+            vpp_sv_u32(mtu, &l3_mtu);
+        vpp_ift_iface_t *row = ift_add_row(name);
+        if (!row)
+            return -1;
+        row->sw_if_index = index;
+        row->mtu = l3_mtu;
+        row->admin_up = vpp_sv_eq(state, "up");
+        row->link_up = row->admin_up;
+    }
+    return 0;
+}
+
+/* "loop0 (up):" followed by "  L3 192.168.1.1/24" lines */
+static int ift_parse_addresses(vpp_sv_t text) {
+    vpp_ift_iface_t *row = NULL;
+    vpp_sv_t line, word, rest;
+
+    while (vpp_sv_line(&text, &line)) {
+        if (line.len && line.p[0] != ' ' && memchr(line.p, '(', line.len)) {
+            row = vpp_sv_field(&line, &word) ? ift_lookup(word) : NULL;
+        } else if (row && vpp_sv_find(line, "L3 ", &rest) &&
+                   vpp_sv_field(&rest, &word) &&
+                   ift_add_addr((size_t)(row - ift.t.ifaces), word) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* "BondEthernet0" followed by "  mode: lacp", "  load balance: l34" and
+ * members indented by four spaces under the member counts */
+static void ift_parse_bonds(vpp_sv_t text) {
+    vpp_ift_iface_t *bond = NULL;
+    vpp_sv_t line, word, value;
+
+    while (vpp_sv_line(&text, &line)) {
+        int top = line.len && line.p[0] != ' ';
+        int member = vpp_sv_starts(line, "    ");
+
+        if (!vpp_sv_field(&line, &word))
+            continue;
+        if (top) {
+            bond = ift_lookup(word);
+        } else if (!bond) {
+            continue;
+        } else if (vpp_sv_eq(word, "mode:")) {
+            if (vpp_sv_field(&line, &value))
+                vpp_sv_copy(value, bond->bond_mode, sizeof(bond->bond_mode));
+        } else if (vpp_sv_eq(word, "load") && vpp_sv_field(&line, &value) &&
+                   vpp_sv_eq(value, "balance:")) {
+            if (vpp_sv_field(&line, &value))
+                vpp_sv_copy(value, bond->bond_lb, sizeof(bond->bond_lb));
+        } else if (member) {
+            vpp_ift_iface_t *row = ift_lookup(word);
+            if (row && row != bond)
+                memcpy(row->bond, bond->name, sizeof(row->bond));
+        }
+    }
+}
+
+/* "itf-pair: [0] BondEthernet0 tap4096 bond0 2 type tap netns dataplane" */
+static void ift_parse_lcp(vpp_sv_t text) {
+    vpp_sv_t line, word, vpp_if, tap_if, host_if;
+
+    while (vpp_sv_line(&text, &line)) {
+        if (!vpp_sv_field(&line, &word) || !vpp_sv_eq(word, "itf-pair:") ||
+            !vpp_sv_field(&line, &word) || !vpp_sv_field(&line, &vpp_if) ||
+            !vpp_sv_field(&line, &tap_if) || !vpp_sv_field(&line, &host_if))
+            continue;
+        vpp_ift_iface_t *row = ift_lookup(vpp_if);
+        if (row)
+            vpp_sv_copy(host_if, row->lcp_host, sizeof(row->lcp_host));
+    }
+}
+
+/* Interface events */
+
+static vpp_ift_event_t *ift_log(uint32_t sw_if_index, const char *name, int kind) {
+    vpp_ift_event_t *e = &ift.ring[ift.ring_next];
+
+    ift.dirty = 1;
+    ift.ring_next = (ift.ring_next + 1) % VPP_IFT_EVENT_RING;
+    if (ift.ring_count < VPP_IFT_EVENT_RING)
+        ift.ring_count++;
+    memset(e, 0, sizeof(*e));
+    e->when = time(NULL);
+    e->sw_if_index = sw_if_index;
+    e->kind = kind;
+    if (name)
+        strncpy(e->name, name, sizeof(e->name) - 1);
+    return e;
+}
+
+static void ift_event(const vpp_api_iface_event_t *ev, void *arg) {
+    vpp_ift_iface_t *row;
+    vpp_ift_event_t *e;
+    (void)arg;
+
+    if (ev->sw_if_index == VPP_API_RESYNC) {
+        /* Subscribed afresh; a load in progress already covers it */
+        if (!ift.loading)
+            ift.generation++;
+        return;
+    }
+
+    row = ift.loading ? NULL : ift_row_by_index(ev->sw_if_index);
+    if (ev->deleted) {
+        ift_log(ev->sw_if_index, row ? row->name : NULL, VPP_IFT_EV_DELETED);
+        if (row) {
+            size_t i = (size_t)(row - ift.t.ifaces);
+            memmove(row, row + 1, (ift.t.count - i - 1) * sizeof(*row));
+            ift.t.count--;
+            if (ift_index() < 0)
+                ift.generation++;
+        }
+    } else if (!row) {
+        /* A new interface, or one the dump in progress may have missed */
+        e = ift_log(ev->sw_if_index, NULL, ift.loading ? VPP_IFT_EV_STATE : VPP_IFT_EV_CREATED);
+        e->admin_up = ev->admin_up;
+        e->link_up = ev->link_up;
+    } else {
+        e = ift_log(ev->sw_if_index, row->name, VPP_IFT_EV_STATE);
+        e->admin_up = ev->admin_up;
+        e->link_up = ev->link_up;
+        e->admin_changed = row->admin_up != ev->admin_up;
+        e->link_changed = row->link_up != ev->link_up;
+        row->admin_up = ev->admin_up;
+        row->link_up = ev->link_up;
+        return;
+    }
+    if (!row)
+        ift.generation++;
+}
+
+/* Output of a batched command, empty if it did not complete */
+static vpp_sv_t batch_text(const vpp_cli_batch_t *cmd) {
+    return vpp_sv(cmd->out, cmd->len);
+}
+
+static void ift_reset(void) {
+    ift.t.count = 0;
+    ift.t.addr_count = 0;
+    ift.loaded = 0;
+    if (ift.index)
+        memset(ift.name_slot, 0, 2 * (ift.slot_mask + 1) * sizeof(size_t));
+}
+
+static int ift_load(void) {
+    enum { B_BOND, B_LCP, B_IFACE, B_ADDR, B_COUNT };
+    vpp_cli_batch_t batch[B_COUNT] = {
+        [B_BOND] = { .cmd = "show bond details" },
+        [B_LCP] = { .cmd = "show lcp" },
+        [B_IFACE] = { .cmd = "show interface" },
+        [B_ADDR] = { .cmd = "show interface addr" },
+    };
+    int use_api, rv = -1;
+
+    ift_reset();
+    /* Subscribe before dumping so no change falls in between */
+    if (!ift.live)
+        ift.live = vpp_api_want_interface_events(ift_event, NULL) == 0;
+    use_api = ift_load_api() == 0;
+    if (!use_api)
+        ift_reset();
+
+    /* Bond and LCP state has no API path here; interfaces only if the
+     * API could not provide them */
+    if (vpp_cli_batch(batch, use_api ? B_IFACE : B_COUNT) != 0)
+        goto out;
+
+    if (!use_api && ift_parse_interfaces(batch_text(&batch[B_IFACE])) < 0)
+        goto out;
+    if (ift_index() < 0)
+        goto out;
+    if (!use_api && ift_parse_addresses(batch_text(&batch[B_ADDR])) < 0)
+        goto out;
+    if (ift_group_addrs() < 0)
+        goto out;
+    ift_parse_bonds(batch_text(&batch[B_BOND]));
+    ift_parse_lcp(batch_text(&batch[B_LCP]));
+    rv = 0;
+out:
+    vpp_cli_batch_free(batch, B_COUNT);
+    if (rv != 0)
+        ift_reset();
+    return rv;
+}
+
+/* Load into this process, honouring the TTL and the generation */
+static int ift_refresh(int need) {
+    uint64_t now = now_ms();
+    unsigned int gen;
+    int rv;
+
+    if (ift.live && vpp_api_poll_events() < 0) {
+        /* Connection lost; whatever happened meanwhile is unknown */
+        ift.live = 0;
+        ift.generation++;
+    }
+    if (ift.loaded && ift.loaded_gen == ift.generation &&
+        ((need == VPP_IFT_STATE && ift.live) || now - ift.loaded_at < ift.ttl_ms))
+        return 0;
+
+    /* Events received while loading bump the generation past this */
+    gen = ift.generation;
+    ift.loading = 1;
+    rv = ift_load();
+    ift.loading = 0;
+    if (rv < 0)
+        return -1;
+    ift.loaded = 1;
+    ift.loaded_gen = gen;
+    ift.loaded_at = now;
+    return 0;
+}
+
+/* Cross-session sharing */
+
+#define SHARE_BYTES ((size_t)64 << 20)  /* Reserved; pages are touched on use */
+#define SHARE_TICK_MS 50
+#define SHARE_WAIT_MS 5000
+
+typedef struct {
+    uint32_t seq;               /* Seqlock, odd while a snapshot is written */
+    uint32_t generation;        /* Bumped by changes made in any session */
+    uint32_t requested;         /* Refresh requests from sessions */
+    uint32_t served;            /* Last request the snapshot answers */
+    int32_t refresher;          /* PID; negated PID of its spawner meanwhile */
+    int32_t daemon;             /* klishd; the refresher exits with it */
+    /* Written under the seqlock */
+    int valid;
+    int live;
+    uint32_t snapshot_gen;
+    uint64_t published_at;
+    size_t count;
+    size_t addr_count;
+    vpp_ift_event_t ring[VPP_IFT_EVENT_RING];
+    size_t ring_next;
+    size_t ring_count;
+    unsigned char data[];       /* Interfaces, then addresses */
+} share_t;
+
+static share_t *share;
+
+static void sleep_ms(unsigned int ms) {
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000 };
+    nanosleep(&ts, NULL);
+}
+
+static int pid_alive(pid_t pid) {
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+/* Whether a refresher runs, or is being spawned */
+static int refresher_alive(void) {
+    int32_t pid = __atomic_load_n(&share->refresher, __ATOMIC_ACQUIRE);
+    return pid_alive(pid < 0 ? -pid : pid);
+}
+
+static void share_publish(int valid, uint32_t gen, uint32_t req) {
+    size_t isize = ift.t.count * sizeof(vpp_ift_iface_t);
+    size_t asize = ift.t.addr_count * sizeof(vpp_ift_addr_t);
+    uint32_t seq = share->seq;
+
+    if (offsetof(share_t, data) + isize + asize > SHARE_BYTES)
+        valid = 0;
+
+    __atomic_store_n(&share->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    share->valid = valid;
+    share->live = ift.live;
+    share->snapshot_gen = gen;
+    share->published_at = now_ms();
+    share->count = valid ? ift.t.count : 0;
+    share->addr_count = valid ? ift.t.addr_count : 0;
+    if (valid) {
+        memcpy(share->data, ift.t.ifaces, isize);
+        memcpy(share->data + isize, ift.t.addrs, asize);
+    }
+    memcpy(share->ring, ift.ring, sizeof(ift.ring));
+    share->ring_next = ift.ring_next;
+    share->ring_count = ift.ring_count;
+    __atomic_store_n(&share->seq, seq + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&share->served, req, __ATOMIC_RELEASE);
+    ift.dirty = 0;
+}
+
+/* The refresher: the only process that loads from VPP while it runs */
+static void share_refresher(void) {
+    int fd;
+
+    signal(SIGINT, SIG_IGN);
+    signal(SIGHUP, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+
+    /* Keep none of the session's descriptors, its client socket above all */
+    vpp_api_disconnect();
+    vpp_cli_disconnect();
+    for (fd = (int)sysconf(_SC_OPEN_MAX) - 1; fd >= 0; fd--)
+        close(fd);
+    fd = open("/dev/null", O_RDWR);
+    if (fd == 0) {
+        dup2(0, 1);
+        dup2(0, 2);
+    }
+    ift.live = 0;
+    ift.loaded = 0;
+
+    /* A refresher killed while publishing left the seqlock odd over a
+     * torn snapshot: finish its write as an empty one, so that readers
+     * ask for a fresh snapshot and the next write starts even */
+    uint32_t seq = share->seq;
+    if (seq & 1) {
+        share->valid = 0;
+        share->count = 0;
+        share->addr_count = 0;
+        share->ring_count = 0;
+        __atomic_store_n(&share->seq, seq + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&share->refresher, (int32_t)getpid(), __ATOMIC_RELEASE);
+
+    for (;;) {
+        if (!pid_alive(share->daemon))
+            _exit(0);
+        if (ift.live && vpp_api_poll_events() < 0) {
+            ift.live = 0;
+            ift.generation++;
+        }
+
+        uint32_t req = __atomic_load_n(&share->requested, __ATOMIC_ACQUIRE);
+        uint32_t gen = __atomic_load_n(&share->generation, __ATOMIC_ACQUIRE);
+        if (req != share->served || gen != share->snapshot_gen ||
+            (ift.loaded && ift.loaded_gen != ift.generation)) {
+            unsigned int local_gen = ift.generation;
+            ift.loading = 1;
+            int rv = ift_load();
+            ift.loading = 0;
+            ift.loaded = rv == 0;
+            ift.loaded_gen = local_gen;
+            share_publish(rv == 0, gen, req);
+        } else if (ift.dirty && ift.loaded) {
+            share_publish(1, share->snapshot_gen, share->served);
+        }
+        sleep_ms(SHARE_TICK_MS);
+    }
+}
+
+/* Start the refresher unless one runs; only one session gets to */
+static int share_spawn(void) {
+    int32_t cur = __atomic_load_n(&share->refresher, __ATOMIC_ACQUIRE);
+    pid_t child;
+
+    if (pid_alive(cur < 0 ? -cur : cur))
+        return 0;
+    if (!__atomic_compare_exchange_n(&share->refresher, &cur, -(int32_t)getpid(),
+                                     0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return 0;
+    if (!share->daemon)
+        share->daemon = (int32_t)getppid();
+
+    child = fork();
+    if (child < 0) {
+        __atomic_store_n(&share->refresher, 0, __ATOMIC_RELEASE);
+        return -1;
+    }
+    if (child == 0) {
+        /* Detach, so the refresher outlives this session */
+        setsid();
+        if (fork() == 0)
+            share_refresher();
+        _exit(0);
+    }
+    waitpid(child, NULL, 0);
+    return 0;
+}
+
+/* Copy the current snapshot unless this process already has it. Fails
+ * if a write does not finish, as when its refresher was killed. */
+static int share_copy(void) {
+    for (unsigned int waited = 0; ; ) {
+        uint32_t seq = __atomic_load_n(&share->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            if (waited >= SHARE_WAIT_MS || (waited % 100 == 99 && !refresher_alive()))
+                return -1;
+            sleep_ms(1);
+            waited++;
+            continue;
+        }
+        if (seq == ift.copied_seq)
+            return 0;
+
+        size_t count = share->count, addr_count = share->addr_count;
+        size_t isize = count * sizeof(vpp_ift_iface_t);
+        size_t asize = addr_count * sizeof(vpp_ift_addr_t);
+        if (offsetof(share_t, data) + isize + asize > SHARE_BYTES)
+            continue;   /* Torn read */
+        if (count > ift.cap) {
+            vpp_ift_iface_t *rows = realloc(ift.t.ifaces, count * sizeof(*rows));
+            if (!rows)
+                return -1;
+            ift.t.ifaces = rows;
+            ift.cap = count;
+        }
+        if (addr_count > ift.addr_cap) {
+            vpp_ift_addr_t *addrs = realloc(ift.t.addrs, addr_count * sizeof(*addrs));
+            if (!addrs)
+                return -1;
+            ift.t.addrs = addrs;
+            ift.addr_cap = addr_count;
+        }
+        memcpy(ift.t.ifaces, share->data, isize);
+        memcpy(ift.t.addrs, share->data + isize, asize);
+        memcpy(ift.ring, share->ring, sizeof(ift.ring));
+        ift.ring_next = share->ring_next;
+        ift.ring_count = share->ring_count;
+        ift.shared_valid = share->valid;
+        ift.shared_live = share->live;
+        ift.shared_gen = share->snapshot_gen;
+        ift.shared_at = share->published_at;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&share->seq, __ATOMIC_RELAXED) != seq)
+            continue;
+
+        ift.t.count = count;
+        ift.t.addr_count = addr_count;
+        ift.ring_next %= VPP_IFT_EVENT_RING;
+        if (ift.ring_count > VPP_IFT_EVENT_RING)
+            ift.ring_count = VPP_IFT_EVENT_RING;
+        ift.copied_seq = seq;
+        return ift_index();
+    }
+}
+
+static int share_fresh(int need) {
+    uint32_t gen = __atomic_load_n(&share->generation, __ATOMIC_ACQUIRE);
+    return ift.shared_valid && ift.shared_gen == gen &&
+        ((need == VPP_IFT_STATE && ift.shared_live) || now_ms() - ift.shared_at < ift.ttl_ms);
+}
+
+/* Serve from the shared snapshot, asking the refresher for a new one
+ * if it is stale. Fails if there is no refresher to ask. */
+static int share_get(int need) {
+    if (!share || share_spawn() < 0)
+        return -1;
+    if (share_copy() < 0)
+        return -1;
+    if (share_fresh(need))
+        return 0;
+
+    uint32_t req = __atomic_add_fetch(&share->requested, 1, __ATOMIC_ACQ_REL);
+    for (unsigned int waited = 0; ; waited++) {
+        if ((int32_t)(__atomic_load_n(&share->served, __ATOMIC_ACQUIRE) - req) >= 0)
+            break;
+        if (waited >= SHARE_WAIT_MS)
+            return -1;
+        if (waited % 100 == 99 && !refresher_alive())
+            return -1;
+        sleep_ms(1);
+    }
+    if (share_copy() < 0 || !ift.shared_valid)
+        return -1;
+    return 0;
+}
+
+/* Map the shared table; done by klishd before sessions are forked */
+int vpp_ift_share_init(void) {
+    void *p;
+
+    if (share)
+        return 0;
+    p = mmap(NULL, SHARE_BYTES, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED)
+        return -1;
+    share = p;
+    return 0;
+}
+
+const vpp_ift_t *vpp_ift_get(int need) {
+    if (share_get(need) == 0)
+        return &ift.t;
+    return ift_refresh(need) == 0 ? &ift.t : NULL;
+}
+
+const vpp_ift_iface_t *vpp_ift_find(const vpp_ift_t *t, const char *name) {
+    if (t != &ift.t || !name)
+        return NULL;
+    return ift_lookup(vpp_sv(name, strlen(name)));
+}
+
+/* Names starting with the first @len bytes of @prefix form one range of
+ * name order; its size is returned and its start stored in @first */
+size_t vpp_ift_prefix(const vpp_ift_t *t, const char *prefix, size_t len, size_t *first) {
+    if (t != &ift.t)
+        return 0;
+    *first = ift_bound(prefix, len, 0);
+    return ift_bound(prefix, len, 1) - *first;
+}
+
+/* Interface at position @i of name order */
+const vpp_ift_iface_t *vpp_ift_by_name(const vpp_ift_t *t, size_t i) {
+    if (t != &ift.t || i >= ift.t.count)
+        return NULL;
+    return &ift.t.ifaces[ift.by_name[i]];
+}
+
+/* Longest common prefix of the @count names from @first of name order;
+ * in sorted order that is the common prefix of the range's two ends */
+size_t vpp_ift_common_prefix(const vpp_ift_t *t, size_t first, size_t count) {
+    const vpp_ift_iface_t *a = vpp_ift_by_name(t, first);
+    const vpp_ift_iface_t *b = count ? vpp_ift_by_name(t, first + count - 1) : NULL;
+    size_t n = 0;
+
+    if (!a || !b)
+        return 0;
+    while (a->name[n] && a->name[n] == b->name[n])
+        n++;
+    return n;
+}
+
+const vpp_ift_iface_t *vpp_ift_find_index(const vpp_ift_t *t, uint32_t sw_if_index) {
+    if (t != &ift.t)
+        return NULL;
+    return ift_row_by_index(sw_if_index);
+}
+
+size_t vpp_ift_event_count(void) {
+    return ift.ring_count;
+}
+
+/* Event @i of the ring, oldest first */
+const vpp_ift_event_t *vpp_ift_event(size_t i) {
+    if (i >= ift.ring_count)
+        return NULL;
+    size_t first = (ift.ring_next + VPP_IFT_EVENT_RING - ift.ring_count) % VPP_IFT_EVENT_RING;
+    return &ift.ring[(first + i) % VPP_IFT_EVENT_RING];
+}
+
+void vpp_ift_invalidate(void) {
+    ift.generation++;
+    if (share)
+        __atomic_add_fetch(&share->generation, 1, __ATOMIC_ACQ_REL);
+}
+
+void vpp_ift_set_ttl(unsigned int ttl_ms) {
+    ift.ttl_ms = ttl_ms;
+}
+
+void vpp_ift_free(void) {
+    free(ift.t.ifaces);
+    free(ift.t.addrs);
+    free(ift.addr_owner);
+    free(ift.index);
+    memset(&ift.t, 0, sizeof(ift.t));
+    ift.cap = ift.addr_cap = ift.index_cap = 0;
+    ift.addr_owner = ift.index = NULL;
+    ift.loaded = 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * Cached interface table for the Klish plugin
+ * Read paths share one snapshot of VPP's interfaces; handlers that change
+ * interfaces bump the generation, and a TTL bounds how long changes made
+ * outside this session go unnoticed.
+ */
+
+#ifndef VPP_IFTABLE_H
+#define VPP_IFTABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#define VPP_IFT_DEFAULT_TTL_MS 2000
+#define VPP_IFT_EVENT_RING 256
+
+/* What a reader needs. Names, indexes and admin/link state follow VPP's
+ * interface events when subscribed; the rest is only as fresh as the TTL. */
+enum { VPP_IFT_STATE, VPP_IFT_FULL };
+
+enum { VPP_IFT_EV_CREATED, VPP_IFT_EV_DELETED, VPP_IFT_EV_STATE };
+
+/* Recent interface event */
+typedef struct {
+    time_t when;                /* When the loading process received it */
+    uint32_t sw_if_index;
+    char name[64];              /* Empty if not known when received */
+    int kind;
+    int admin_up;
+    int link_up;
+    int admin_changed;
+    int link_changed;
+} vpp_ift_event_t;
+
+/* Address of an interface, "addr/len" */
+typedef struct {
+    char prefix[48];
+} vpp_ift_addr_t;
+
+typedef struct {
+    char name[64];
+    uint32_t sw_if_index;
+    uint32_t mtu;               /* L3 MTU */
+    int admin_up;
+    int link_up;
+    size_t addr_first;          /* Range in vpp_ift_t.addrs */
+    size_t addr_count;
+    char bond[64];              /* Bond this interface is a member of */
+    char bond_mode[32];         /* Set on bond interfaces only */
+    char bond_lb[16];
+    char lcp_host[32];          /* Linux host interface of the LCP pair */
+} vpp_ift_iface_t;
+
+typedef struct {
+    vpp_ift_iface_t *ifaces;
+    size_t count;
+    vpp_ift_addr_t *addrs;
+    size_t addr_count;
+} vpp_ift_t;
+
+/* Table no older than the last invalidation, and than the TTL unless only
+ * event-tracked state is needed; NULL if VPP could not be reached.
+ * Valid until the next call. */
+const vpp_ift_t *vpp_ift_get(int need);
+const vpp_ift_iface_t *vpp_ift_find(const vpp_ift_t *t, const char *name);
+const vpp_ift_iface_t *vpp_ift_find_index(const vpp_ift_t *t, uint32_t sw_if_index);
+size_t vpp_ift_prefix(const vpp_ift_t *t, const char *prefix, size_t len, size_t *first);
+const vpp_ift_iface_t *vpp_ift_by_name(const vpp_ift_t *t, size_t i);
+size_t vpp_ift_common_prefix(const vpp_ift_t *t, size_t first, size_t count);
+/* Call once a change to VPP's interfaces has been made, not before: a
+ * refresh it triggers must not read VPP ahead of the change */
+void vpp_ift_invalidate(void);
+size_t vpp_ift_event_count(void);
+const vpp_ift_event_t *vpp_ift_event(size_t i);
+void vpp_ift_set_ttl(unsigned int ttl_ms);
+int vpp_ift_share_init(void);
+void vpp_ift_free(void);
+
+#endif /* VPP_IFTABLE_H */
@@ -10,7 +10,13 @@
 #include <stdlib.h>
 
 #include <string.h>
-#include <sys/utsname.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <dirent.h>
+#include <poll.h>
+
+#include <time.h>
 
 #include <unistd.h>
 
@@ -18,12 +24,16 @@
 
 #include <sys/un.h>
 
+#include <arpa/inet.h>
+
 #include <errno.h>
 
 #include <assert.h>
 
 #include <ctype.h>
 
+#include <stdarg.h>
+
 
 #include <faux/faux.h>
 
@@ -31,6 +41,8 @@
 
 #include <faux/argv.h>
 
+#include <faux/ini.h>
+
 #include <klish/kplugin.h>
 
 #include <klish/kcontext.h>
@@ -41,322 +53,171 @@
 
 #include <klish/ksym.h>
 
+#include "vpp_api.h"
+#include "vpp_cli.h"
+#include "vpp_config.h"
+#include "vpp_filter.h"
+#include "vpp_iftable.h"
+#include "vpp_range.h"
+#include "vpp_routes.h"
+#include "vpp_runcfg.h"
+#include "vpp_save.h"
+#include "vpp_session.h"
+#include "vpp_stats.h"
+#include "vpp_sysinfo.h"
+#include "vpp_text.h"
+
 /* Forward declarations */
-static char* vpp_exec_cli(const char *cmd);
+static const char* vpp_exec_cli(const char *cmd);
+
+/* VPP output held for the command being run */
+static vpp_arena_t cmd_arena;
 
 
-#define VPP_CLI_SOCKET "/run/vpp/cli.sock"
-#define BUFFER_SIZE 8192
-#define TELNET_IAC 255
-#define TELNET_DONT 254
-#define TELNET_DO 253
-#define TELNET_WONT 252
-#define TELNET_WILL 251
-#define TELNET_SB 250
-#define TELNET_SE 240
+#define COMPLETE_MAX 64     /* Interface names listed per completion */
 
 /* Version */
 const uint8_t kplugin_vpp_major = KPLUGIN_MAJOR;
 const uint8_t kplugin_vpp_minor = KPLUGIN_MINOR;
 
-static int vpp_cli_fd = -1;
-
-/* File-based storage for current interface (shared across forked processes)
- * Uses parent PID to create unique file per client session */
-
-static void get_iface_file_path(char *path, size_t size) {
-    /* Use parent PID which is the klishd service process for this client */
-    snprintf(path, size, "/tmp/klish_vpp_iface_%d", getppid());
-}
-
-/* Get current interface from file */
+/* Interface being configured, held in the session's own memory */
 static const char* get_current_interface(void) {
-    static char iface[64];
-    char path[128];
-    FILE *f;
-    
-    get_iface_file_path(path, sizeof(path));
-    f = fopen(path, "r");
-    if (!f) {
-        return NULL;
-    }
-    
-    if (fgets(iface, sizeof(iface), f) == NULL) {
-        fclose(f);
-        return NULL;
-    }
-    fclose(f);
-    
-    /* Remove trailing newline */
-    size_t len = strlen(iface);
-    if (len > 0 && iface[len-1] == '\n') {
-        iface[len-1] = 0;
-    }
-    
-    return iface[0] ? iface : NULL;
+    return vpp_session_iface();
 }
 
-/* Set current interface to file */
 static void set_current_interface(const char *iface) {
-    char path[128];
-    FILE *f;
-    
-    get_iface_file_path(path, sizeof(path));
-    f = fopen(path, "w");
-    if (!f) {
-        fprintf(stderr, "ERROR: Cannot write to %s\n", path);
-        return;
-    }
-    
-    fprintf(f, "%s\n", iface);
-    fclose(f);
+    vpp_session_set_iface(iface);
 }
 
-/* Clear current interface (delete file) */
 static void clear_current_interface(void) {
-    char path[128];
-    get_iface_file_path(path, sizeof(path));
-    unlink(path);
+    vpp_session_set_iface(NULL);
 }
 
-/* Helper to read from socket until prompt or EOF, handling Telnet IAC */
-
 /* Bond configuration helpers */
-static void get_bond_config_file(char *path, size_t size, const char *bond_name) {
-    snprintf(path, size, "/tmp/klish_bond_%s", bond_name);
-}
-
 static void set_pending_bond_config(const char *bond_name, const char *mode, const char *lb) {
-    char path[128];
-    get_bond_config_file(path, sizeof(path), bond_name);
-    FILE *f = fopen(path, "w");
-    if (f) {
-        fprintf(f, "%s\n%s\n", mode ? mode : "", lb ? lb : "");
-        fclose(f);
-    }
+    vpp_session_set_bond(bond_name, mode, lb);
 }
 
 static int get_pending_bond_config(const char *bond_name, char *mode, size_t mode_sz, char *lb, size_t lb_sz) {
-    char path[128];
-    get_bond_config_file(path, sizeof(path), bond_name);
-    FILE *f = fopen(path, "r");
-    if (!f) return 0;
-    
-    if (mode) {
-        if (fgets(mode, mode_sz, f)) {
-            size_t len = strlen(mode);
-            if (len > 0 && mode[len-1] == '\n') mode[len-1] = 0;
-        } else mode[0] = 0;
-    }
-    if (lb) {
-        if (fgets(lb, lb_sz, f)) {
-            size_t len = strlen(lb);
-            if (len > 0 && lb[len-1] == '\n') lb[len-1] = 0;
-        } else lb[0] = 0;
-    }
-    fclose(f);
-    return 1;
+    return vpp_session_bond(bond_name, mode, mode_sz, lb, lb_sz);
 }
 
 static void clear_pending_bond_config(const char *bond_name) {
-    char path[128];
-    get_bond_config_file(path, sizeof(path), bond_name);
-    unlink(path);
+    vpp_session_clear_bond(bond_name);
 }
 
 static int bond_interface_exists(const char *bond_name) {
-    const char *result = vpp_exec_cli("show bond\n");
-    return (strstr(result, bond_name) != NULL);
-}
-
-static ssize_t read_until_prompt(int fd, char *buffer, size_t size) {
-    size_t total = 0;
-    ssize_t n;
-    unsigned char c;
-    int state = 0; // 0=Normal, 1=IAC, 2=IAC+Cmd, 3=SB
-    
-    memset(buffer, 0, size);
-    
-    while (total < size - 1) {
-        n = read(fd, &c, 1);
-        if (n <= 0) break; // EOF or Error
-        
-        // Telnet State Machine
-        if (state == 0) {
-            if (c == TELNET_IAC) {
-                state = 1;
-            } else {
-                buffer[total++] = c;
-            }
-        } else if (state == 1) { // Received IAC
-            if (c == TELNET_IAC) { // Escaped IAC (255 255)
-                buffer[total++] = c;
-                state = 0;
-            } else if (c == TELNET_SB) {
-                state = 3;
-            } else if (c >= TELNET_WILL && c <= TELNET_DONT) {
-                state = 2; // Expect option byte
-            } else {
-                state = 0; // Other commands (NOP, etc) - ignore
-            }
-        } else if (state == 2) { // Expecting Option Byte
-            state = 0; // Ignore option
-        } else if (state == 3) { // Inside Subnegotiation
-            if (c == TELNET_SE) { // End of subnegotiation? 
-                // Wait, SE is usually preceded by IAC.
-                // But simplified: just ignore until IAC SE.
-                // Actually, strictly it is IAC SE.
-                // Let's handle IAC inside SB.
-            }
-            if (c == TELNET_IAC) {
-                // Check next byte for SE
-                 // This simple state machine is imperfect for SB but sufficient for VPP
-                 // VPP sends IAC SB ... IAC SE
-            }
-             // For now, just stay in state 3 until we see IAC SE sequence?
-             // Let's refine:
-             // If we are in SB, we ignore everything until IAC SE.
-        }
-    }
-    
-    // Re-implementing read loop with better buffering and simpler logic
-    // We read chunk by chunk and filter.
-    return total;
+    const vpp_ift_t *t = vpp_ift_get(VPP_IFT_STATE);
+    return t && vpp_ift_find(t, bond_name) != NULL;
 }
 
-/* Better implementation of reading and filtering */
-static int read_and_filter(int fd, char *buffer, size_t size, const char *stop_str) {
-    size_t total = 0;
-    ssize_t n;
-    unsigned char buf[1024];
-    int in_iac = 0;
-    int in_sb = 0;
-
-    while (total < size - 1) {
-        n = read(fd, buf, sizeof(buf));
-        if (n <= 0) break;
-
-        for (ssize_t i = 0; i < n; i++) {
-            unsigned char c = buf[i];
-            
-            if (in_sb) {
-                if (in_iac && c == TELNET_SE) {
-                    in_sb = 0;
-                    in_iac = 0;
-                } else if (c == TELNET_IAC) {
-                    in_iac = 1;
-                } else {
-                    in_iac = 0;
-                }
-                continue;
-            }
-
-            if (in_iac) {
-                if (c == TELNET_SB) {
-                    in_sb = 1;
-                    in_iac = 0;
-                } else if (c >= TELNET_WILL && c <= TELNET_DONT) {
-                    // Expect one more byte (option code), but we handle it by just resetting in_iac
-                    // Wait, we need to skip the NEXT byte too.
-                    // This simple logic is failing.
-                    // Let's use a proper state variable.
-                } else {
-                    // Other commands or escaped IAC
-                    if (c == TELNET_IAC) {
-                         if (total < size - 1) buffer[total++] = c;
-                    }
-                    in_iac = 0;
-                }
-                continue;
-            }
-
-            if (c == TELNET_IAC) {
-                in_iac = 1;
-                continue;
-            }
-
-            // Normal char
-            if (total < size - 1) buffer[total++] = c;
-        }
-        buffer[total] = 0;
-        
-        // Check for stop string (prompt)
-        if (stop_str && strstr(buffer, stop_str)) {
-            return 0; // Found
-        }
-    }
-    return 0;
+/* Start vppctl for one command - used only when cli.sock is unreachable */
+static FILE *vppctl_open(const char *cmd) {
+    char vppctl_cmd[512];
+    snprintf(vppctl_cmd, sizeof(vppctl_cmd), 
+             "vppctl -s %s '%s' 2>/dev/null", VPP_CLI_SOCKET, cmd);
+    return popen(vppctl_cmd, "r");
 }
 
-/* Robust Telnet Filter */
-static void filter_telnet(unsigned char *data, ssize_t len, char *out, size_t *out_len) {
-    size_t j = 0;
-    for (ssize_t i = 0; i < len; ) {
-        if (data[i] == TELNET_IAC) {
-            i++;
-            if (i >= len) break;
-            if (data[i] == TELNET_IAC) {
-                out[j++] = data[i++]; // Escaped IAC
-            } else if (data[i] == TELNET_SB) {
-                i++;
-                while (i < len) {
-                    if (data[i] == TELNET_IAC) {
-                        i++;
-                        if (i < len && data[i] == TELNET_SE) {
-                            i++;
-                            break;
-                        }
-                    } else {
-                        i++;
-                    }
-                }
-            } else if (data[i] >= TELNET_WILL && data[i] <= TELNET_DONT) {
-                i += 2; // Skip Command + Option
-            } else {
-                i++; // Skip Command
-            }
-        } else {
-            out[j++] = data[i++];
-        }
+/* Copy a command, removing a trailing newline if present */
+static void clean_cli_cmd(char *out, size_t size, const char *cmd) {
+    strncpy(out, cmd, size - 1);
+    out[size - 1] = 0;
+    size_t len = strlen(out);
+    if (len > 0 && out[len-1] == '\n') {
+        out[len-1] = 0;
     }
-    *out_len = j;
-    out[j] = 0;
 }
 
-static char* vpp_exec_cli(const char *cmd) {
-    static char buffer[BUFFER_SIZE];
-    char vppctl_cmd[512];
-    FILE *fp;
-    size_t total = 0;
-    
-    /* Build vppctl command - remove trailing newline from cmd if present */
+/* Run a command, passing output chunks to @fn as they arrive, so memory
+ * use stays constant however large the output is */
+static int vpp_exec_cli_stream(const char *cmd, vpp_cli_output_fn fn, void *arg) {
     char clean_cmd[256];
-    strncpy(clean_cmd, cmd, sizeof(clean_cmd) - 1);
-    clean_cmd[sizeof(clean_cmd) - 1] = 0;
-    size_t len = strlen(clean_cmd);
-    if (len > 0 && clean_cmd[len-1] == '\n') {
-        clean_cmd[len-1] = 0;
-    }
+    char chunk[4096];
+    size_t n;
+    int stopped = 0;
     
-    /* Use vppctl which is much faster than raw socket */
-    snprintf(vppctl_cmd, sizeof(vppctl_cmd), 
-             "vppctl -s %s '%s' 2>/dev/null", VPP_CLI_SOCKET, clean_cmd);
+    clean_cli_cmd(clean_cmd, sizeof(clean_cmd), cmd);
     
-    fp = popen(vppctl_cmd, "r");
-    if (!fp) {
-        snprintf(buffer, BUFFER_SIZE, "Error: Cannot execute vppctl: %s\n", strerror(errno));
-        return buffer;
-    }
+    int rv = vpp_cli_stream(clean_cmd, fn, arg);
+    if (rv != VPP_CLI_ERR_CONNECT)
+        return rv;
     
-    /* Read output */
-    buffer[0] = 0;
-    while (fgets(buffer + total, BUFFER_SIZE - total, fp) != NULL) {
-        total = strlen(buffer);
-        if (total >= BUFFER_SIZE - 1) break;
+    FILE *fp = vppctl_open(clean_cmd);
+    if (!fp)
+        return VPP_CLI_ERR_CONNECT;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        if (!stopped && fn(chunk, n, arg) != 0)
+            stopped = 1;
     }
-    
     pclose(fp);
-    return buffer;
+    return 0;
+}
+
+/* Output collected for vpp_exec_cli() */
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t size;
+} cli_output_t;
+
+static int collect_chunk(const char *data, size_t len, void *arg) {
+    cli_output_t *out = arg;
+    
+    if (out->len + len + 1 > out->size) {
+        size_t size = out->size ? out->size : 4096;
+        while (size < out->len + len + 1)
+            size *= 2;
+        char *buf = vpp_arena_grow(&cmd_arena, out->buf, out->size, size);
+        if (!buf)
+            return 1;   /* Keep what fits */
+        out->buf = buf;
+        out->size = size;
+    }
+    memcpy(out->buf + out->len, data, len);
+    out->len += len;
+    out->buf[out->len] = 0;
+    return 0;
+}
+
+/* Run a command and return all of its output; it lives in the command
+ * arena, so it stays valid until the command is over */
+static const char* vpp_exec_cli(const char *cmd) {
+    cli_output_t out = { NULL, 0, 0 };
+    
+    int rv = vpp_exec_cli_stream(cmd, collect_chunk, &out);
+    if (rv == VPP_CLI_ERR_IO) {
+        return "Error: Connection to VPP lost\n";
+    } else if (rv != 0) {
+        char *msg = vpp_arena_alloc(&cmd_arena, 128);
+        if (!msg)
+            return "Error: Cannot execute vppctl\n";
+        snprintf(msg, 128, "Error: Cannot execute vppctl: %s\n", strerror(errno));
+        return msg;
+    }
+    return out.buf ? out.buf : "";
+}
+
+/* Stream sink printing VPP output straight to the user; forked, the
+ * handler's stdout is a pipe to klish, which must not wait for a full
+ * buffer */
+static int print_chunk(const char *data, size_t len, void *arg) {
+    kcontext_printf((kcontext_t *)arg, "%.*s", (int)len, data);
+    fflush(stdout);
+    return 0;
+}
+
+/* Show handler body: stream a command's output as it is produced */
+static int vpp_show_cli(kcontext_t *context, const char *cmd) {
+    int rv = vpp_exec_cli_stream(cmd, print_chunk, context);
+    if (rv == VPP_CLI_ERR_IO) {
+        kcontext_printf(context, "\nError: Connection to VPP lost\n");
+        return -1;
+    } else if (rv != 0) {
+        kcontext_printf(context, "Error: Cannot reach VPP (is it running?)\n");
+        return -1;
+    }
+    return 0;
 }
 
 /* Get parameter value from context - returns LAST matching entry */
@@ -388,129 +249,610 @@ static const char* get_param(kcontext_t *context, const char *name) {
     return kparg_value(result_parg);
 }
 
+/* Report a failed binary API request */
+static int api_error(kcontext_t *context, int rv) {
+    kcontext_printf(context, "Error: %s\n", vpp_api_strerror(rv));
+    return -1;
+}
+
+/* Candidate configuration: while it is on, configuration commands are
+ * staged here and reach VPP only on commit */
+static int candidate_mode;
+static vpp_cfg_ops_t candidate;
+
+/* Interfaces being configured together in interface range mode */
+static vpp_range_t range;
+
+static int stage(kcontext_t *context, int section, const char *iface, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static int stage(kcontext_t *context, int section, const char *iface, const char *fmt, ...) {
+    char cmd[256];
+    va_list ap;
+    
+    va_start(ap, fmt);
+    vsnprintf(cmd, sizeof(cmd), fmt, ap);
+    va_end(ap);
+    if (vpp_cfg_add(&candidate, section, iface, "%s", cmd) < 0) {
+        kcontext_printf(context, "Error: Cannot stage change: out of memory\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Report an operation that was refused, with its line if read from a file */
+static void print_op_error(const vpp_cfg_op_t *op, const char *error, void *arg) {
+    size_t len = strlen(error);
+    while (len > 0 && (error[len - 1] == '\n' || error[len - 1] == '\r'))
+        len--;
+    if (op->line)
+        kcontext_printf((kcontext_t *)arg, "Error: line %u: %s: %.*s\n", op->line, op->cmd, (int)len, error);
+    else
+        kcontext_printf((kcontext_t *)arg, "Error: %s: %.*s\n", op->cmd, (int)len, error);
+}
+
+/* Stage creating a loopback or VLAN subinterface unless it exists already */
+static int stage_interface(kcontext_t *context, const char *iface) {
+    const vpp_ift_t *t = vpp_ift_get(VPP_IFT_STATE);
+    const char *dot = strchr(iface, '.');
+    int instance, vlan_id;
+    
+    if ((t && vpp_ift_find(t, iface)) || vpp_cfg_creates(&candidate, iface))
+        return 0;
+    if (strncmp(iface, "loop", 4) == 0 && sscanf(iface, "loop%d", &instance) == 1 && !dot)
+        return stage(context, VPP_CFG_CREATE, iface, "create loopback interface instance %d", instance);
+    if (dot) {
+        vlan_id = atoi(dot + 1);
+        if (vlan_id > 0 && vlan_id < 4096)
+            return stage(context, VPP_CFG_SUBIF, iface, "create sub %.*s %d",
+                         (int)(dot - iface), iface, vlan_id);
+    }
+    return 0;
+}
+
 /* Show interfaces with IP addresses - Cisco style with MTU and multi-IP */
 int vpp_show_interfaces(kcontext_t *context) {
-    char iface_buf[BUFFER_SIZE];
-    char addr_buf[BUFFER_SIZE];
-    
-    /* Get interface list */
-    const char *ifaces = vpp_exec_cli("show interface\n");
-    strncpy(iface_buf, ifaces, BUFFER_SIZE - 1);
-    iface_buf[BUFFER_SIZE - 1] = 0;
-    
-    /* Get IP addresses */
-    const char *addrs = vpp_exec_cli("show interface addr\n");
-    strncpy(addr_buf, addrs, BUFFER_SIZE - 1);
-    addr_buf[BUFFER_SIZE - 1] = 0;
-    
-    /* Interface data structure - supports multiple IPs */
-    struct {
-        char name[64];
-        char ips[8][48];  /* Max 8 IPs per interface */
-        int ip_count;
-        int mtu;
-        int is_up;
-    } interfaces[128];
-    int iface_count = 0;
-    
-    /* Parse interface names, status, and MTU from "show interface" output */
-    /* Format: Name  Idx  State  MTU (L3/IP4/IP6/MPLS) */
-    char *line = strtok(iface_buf, "\n");
-    while (line && iface_count < 128) {
-        /* Skip header line and empty lines */
-        if (strstr(line, "Name") || strlen(line) < 5) {
-            line = strtok(NULL, "\n");
+    const vpp_ift_t *t = vpp_ift_get(VPP_IFT_FULL);
+    
+    if (!t) {
+        kcontext_printf(context, "Error: Cannot reach VPP (is it running?)\n");
+        return -1;
+    }
+    
+    /* Print header */
+    kcontext_printf(context, "%-32s %-20s %5s %-6s %-8s\n",
+        "Interface", "IP-Address", "MTU", "Status", "Protocol");
+    
+    /* Print formatted table */
+    for (size_t i = 0; i < t->count; i++) {
+        const vpp_ift_iface_t *row = &t->ifaces[i];
+        const vpp_ift_addr_t *addrs = &t->addrs[row->addr_first];
+        
+        /* First IP with interface name */
+        kcontext_printf(context, "%-32s %-20s %5u %-6s %-8s\n",
+            row->name,
+            row->addr_count ? addrs[0].prefix : "unassigned",
+            row->mtu,
+            row->admin_up ? "up" : "down",
+            row->link_up ? "up" : "down");
+        
+        /* Additional IPs on separate lines */
+        for (size_t j = 1; j < row->addr_count; j++) {
+            kcontext_printf(context, "%-32s %-20s\n", "", addrs[j].prefix);
+        }
+    }
+    
+    return 0;
+}
+
+/* Interface counters, read from VPP's stats segment */
+static vpp_stats_ifaces_t if_stats;
+
+static int load_if_stats(kcontext_t *context) {
+    if (vpp_stats_ifaces(&if_stats) < 0) {
+        kcontext_printf(context, "Error: Cannot read VPP's stats segment (%s)\n", VPP_STATS_SOCKET);
+        return -1;
+    }
+    return 0;
+}
+
+static const vpp_stats_iface_t *find_if_stats(const char *name) {
+    for (size_t i = 0; i < if_stats.count; i++) {
+        if (strcmp(if_stats.ifaces[i].name, name) == 0)
+            return &if_stats.ifaces[i];
+    }
+    return NULL;
+}
+
+/* show interfaces counters [name] */
+int vpp_show_interfaces_counters(kcontext_t *context) {
+    const char *name = get_param(context, "interface");
+    
+    if (load_if_stats(context) < 0)
+        return -1;
+    
+    if (name) {
+        const vpp_stats_iface_t *c = find_if_stats(name);
+        if (!c) {
+            kcontext_printf(context, "Error: Interface %s not found\n", name);
+            return -1;
+        }
+        kcontext_printf(context, "%s (sw_if_index %zu)\n", c->name, (size_t)(c - if_stats.ifaces));
+        kcontext_printf(context, "  RX: %llu packets, %llu bytes\n",
+                        (unsigned long long)c->rx.packets, (unsigned long long)c->rx.bytes);
+        kcontext_printf(context, "  TX: %llu packets, %llu bytes\n",
+                        (unsigned long long)c->tx.packets, (unsigned long long)c->tx.bytes);
+        kcontext_printf(context, "  Drops: %llu, RX errors: %llu, TX errors: %llu, RX missed: %llu\n",
+                        (unsigned long long)c->drops, (unsigned long long)c->rx_errors,
+                        (unsigned long long)c->tx_errors, (unsigned long long)c->rx_miss);
+        return 0;
+    }
+    
+    kcontext_printf(context, "%-32s %14s %16s %14s %16s %12s %10s\n",
+        "Interface", "RX packets", "RX bytes", "TX packets", "TX bytes", "Drops", "Errors");
+    for (size_t i = 0; i < if_stats.count; i++) {
+        const vpp_stats_iface_t *c = &if_stats.ifaces[i];
+        if (!c->name[0])
+            continue;
+        kcontext_printf(context, "%-32s %14llu %16llu %14llu %16llu %12llu %10llu\n",
+            c->name, (unsigned long long)c->rx.packets, (unsigned long long)c->rx.bytes,
+            (unsigned long long)c->tx.packets, (unsigned long long)c->tx.bytes,
+            (unsigned long long)c->drops, (unsigned long long)(c->rx_errors + c->tx_errors));
+    }
+    
+    return 0;
+}
+
+/* Live interface rates. The monitor redraws until interrupted, so klish
+ * runs it forked, like the filters, and it streams each frame as drawn. */
+#define MONITOR_INTERVAL_MAX 3600
+#define MONITOR_THREADS_MAX 256
+#define MONITOR_EOL "\033[K"      /* Each line clears what was under it */
+#define RATES_ROW "%-32s %9s %9s %9s %9s %9s %9s%s\n"
+
+static volatile sig_atomic_t monitor_stop;
+
+static void monitor_signal(int sig) {
+    (void)sig;
+    monitor_stop = 1;
+}
+
+/* "950", "12.4k", "9.87G" */
+static void format_rate(char *buf, size_t size, double rate) {
+    static const char unit[] = " kMGT";
+    int u = 0;
+    
+    while (rate >= 999.5 && u < 4) {
+        rate /= 1000;
+        u++;
+    }
+    if (u == 0)
+        snprintf(buf, size, "%.0f", rate);
+    else
+        snprintf(buf, size, "%.*f%c", rate < 9.995 ? 2 : rate < 99.95 ? 1 : 0, rate, unit[u]);
+}
+
+/* Per second over @secs; a counter that went back was cleared meanwhile */
+static double counter_rate(uint64_t now, uint64_t before, double secs) {
+    return (double)(now >= before ? now - before : now) / secs;
+}
+
+/* Wait until @deadline_ns, or until Ctrl-C, whether klish passes it on as
+ * a signal or as ^C on stdin */
+static void monitor_wait(uint64_t deadline_ns, int *in) {
+    struct pollfd pfd = { *in, POLLIN, 0 };
+    struct timespec ts;
+    uint64_t now;
+    char buf[64];
+    ssize_t n;
+    
+    while (!monitor_stop) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        now = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+        if (now >= deadline_ns)
+            return;
+        pfd.fd = *in;
+        if (poll(&pfd, 1, (int)((deadline_ns - now + 999999) / 1000000)) <= 0 || !pfd.revents)
+            continue;
+        n = read(*in, buf, sizeof(buf));
+        if (n <= 0) {
+            *in = -1;           /* Nothing more will come; just sleep */
             continue;
         }
-        
-        /* Skip counter lines (indented lines with rx/tx/drops) */
-        if (line[0] == ' ') {
-            line = strtok(NULL, "\n");
+        if (memchr(buf, 0x03, (size_t)n) || memchr(buf, 'q', (size_t)n))
+            monitor_stop = 1;
+    }
+}
+
+static void rates_row(kcontext_t *context, const char *label, const vpp_stats_iface_t *c,
+                      const vpp_stats_iface_t *p, double secs, const char *eol) {
+    char rx_pps[16], rx_bps[16], tx_pps[16], tx_bps[16], drops[16], errors[16];
+    
+    format_rate(rx_pps, sizeof(rx_pps), counter_rate(c->rx.packets, p->rx.packets, secs));
+    format_rate(rx_bps, sizeof(rx_bps), 8 * counter_rate(c->rx.bytes, p->rx.bytes, secs));
+    format_rate(tx_pps, sizeof(tx_pps), counter_rate(c->tx.packets, p->tx.packets, secs));
+    format_rate(tx_bps, sizeof(tx_bps), 8 * counter_rate(c->tx.bytes, p->tx.bytes, secs));
+    format_rate(drops, sizeof(drops), counter_rate(c->drops, p->drops, secs));
+    format_rate(errors, sizeof(errors), counter_rate(c->rx_errors + c->tx_errors + c->rx_miss,
+                                                     p->rx_errors + p->tx_errors + p->rx_miss, secs));
+    kcontext_printf(context, RATES_ROW, label, rx_pps, rx_bps, tx_pps, tx_bps, drops, errors, eol);
+}
+
+/* One interface: its totals, then what each VPP thread handled of it */
+static void monitor_draw_one(kcontext_t *context, size_t index, const vpp_stats_ifaces_t *cur,
+                             const vpp_stats_ifaces_t *prev, const vpp_stats_iface_t *tcur,
+                             const vpp_stats_iface_t *tprev, size_t threads, double secs) {
+    char label[32];
+    
+    kcontext_printf(context, RATES_ROW, "", "RX pps", "RX bps", "TX pps", "TX bps", "Drops/s", "Errors/s",
+                    MONITOR_EOL);
+    rates_row(context, cur->ifaces[index].name, &cur->ifaces[index], &prev->ifaces[index], secs, MONITOR_EOL);
+    kcontext_printf(context, "\033[K\n");
+    kcontext_printf(context, "By thread, RX being that of the queues placed on it:\033[K\n");
+    for (size_t t = 0; t < threads; t++) {
+        const vpp_stats_iface_t *c = &tcur[t];
+        if (!c->rx.packets && !c->tx.packets && !c->drops && !c->rx_errors && !c->tx_errors)
+            continue;   /* Never touched this interface */
+        if (t == 0)
+            snprintf(label, sizeof(label), "vpp_main");
+        else
+            snprintf(label, sizeof(label), "vpp_wk_%zu", t - 1);
+        rates_row(context, label, c, &tprev[t], secs, MONITOR_EOL);
+    }
+}
+
+/* monitor interface [name|all] [interval N] */
+int vpp_monitor_interface(kcontext_t *context) {
+    const char *name = get_param(context, "interface");
+    const char *seconds = get_param(context, "seconds");
+    unsigned long interval = seconds ? strtoul(seconds, NULL, 10) : 1;
+    vpp_stats_ifaces_t snap[2] = { { 0 } }, *cur = &snap[0], *prev = &snap[1], *tmp;
+    vpp_stats_iface_t *threads[2] = { NULL, NULL };
+    size_t nthreads[2] = { 0, 0 }, index = 0;
+    struct sigaction sa, old_int, old_term, old_hup;
+    int single = name && strcmp(name, "all") != 0;
+    int in = STDIN_FILENO, rv = 0, frames = 0;
+    
+    if (interval < 1 || interval > MONITOR_INTERVAL_MAX) {
+        kcontext_printf(context, "Error: Interval must be 1 to %d seconds\n", MONITOR_INTERVAL_MAX);
+        return -1;
+    }
+    if (vpp_stats_ifaces(cur) < 0) {
+        kcontext_printf(context, "Error: Cannot read VPP's stats segment (%s)\n", VPP_STATS_SOCKET);
+        vpp_stats_ifaces_free(cur);
+        return -1;
+    }
+    if (single) {
+        for (index = 0; index < cur->count && strcmp(cur->ifaces[index].name, name) != 0; index++)
+            ;
+        if (index == cur->count) {
+            kcontext_printf(context, "Error: Interface %s not found\n", name);
+            vpp_stats_ifaces_free(cur);
+            return -1;
+        }
+        threads[0] = calloc(MONITOR_THREADS_MAX, sizeof(vpp_stats_iface_t));
+        threads[1] = calloc(MONITOR_THREADS_MAX, sizeof(vpp_stats_iface_t));
+        if (!threads[0] || !threads[1]) {
+            kcontext_printf(context, "Error: Out of memory\n");
+            rv = -1;
+            goto out;
+        }
+        vpp_stats_iface_threads(index, threads[0], MONITOR_THREADS_MAX, &nthreads[0]);
+    }
+    
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = monitor_signal;     /* No SA_RESTART: wake the wait */
+    sigemptyset(&sa.sa_mask);
+    monitor_stop = 0;
+    sigaction(SIGINT, &sa, &old_int);
+    sigaction(SIGTERM, &sa, &old_term);
+    sigaction(SIGHUP, &sa, &old_hup);
+    
+    kcontext_printf(context, "\033[H\033[2JSampling every %lus, Ctrl-C to stop\n", interval);
+    fflush(stdout);
+    while (!monitor_stop) {
+        monitor_wait(cur->taken_ns + interval * 1000000000ull, &in);
+        if (monitor_stop)
+            break;
+        tmp = prev, prev = cur, cur = tmp;
+        if (vpp_stats_ifaces(cur) < 0) {
+            kcontext_printf(context, "\033[HWaiting for VPP's stats segment (%s)\033[K\n", VPP_STATS_SOCKET);
+            fflush(stdout);
+            cur->taken_ns = prev->taken_ns + interval * 1000000000ull;
+            cur->count = 0;     /* Nothing to compare the next sample with */
             continue;
         }
-        
-        /* Parse: "local0  0  down  0/0/0/0" or "loop0  1  up  9000/0/0/0" */
-        char name[64] = {0};
-        int idx;
-        char state[16] = {0};
-        int mtu_l3 = 9000;
-        
-        if (sscanf(line, "%63s %d %15s %d", name, &idx, state, &mtu_l3) >= 3) {
-            strncpy(interfaces[iface_count].name, name, 63);
-            interfaces[iface_count].is_up = (strstr(state, "up") != NULL);
-            interfaces[iface_count].mtu = mtu_l3;
-            interfaces[iface_count].ip_count = 0;
-            iface_count++;
+        if (single) {
+            vpp_stats_iface_t *t = threads[0];
+            threads[0] = threads[1], threads[1] = t;
+            nthreads[1] = nthreads[0];
+            if (vpp_stats_iface_threads(index, threads[0], MONITOR_THREADS_MAX, &nthreads[0]) < 0)
+                nthreads[0] = 0;
         }
         
-        line = strtok(NULL, "\n");
+        double secs = (double)(cur->taken_ns - prev->taken_ns) / 1e9;
+        kcontext_printf(context, "\033[HEvery %lus, Ctrl-C to stop, sample %d\033[K\n\033[K\n", interval, ++frames);
+        if (single) {
+            if (index >= cur->count || index >= prev->count ||
+                strcmp(cur->ifaces[index].name, name) != 0 || strcmp(prev->ifaces[index].name, name) != 0)
+                kcontext_printf(context, "Interface %s is gone\033[K\n", name);
+            else
+                monitor_draw_one(context, index, cur, prev, threads[0], threads[1],
+                                 nthreads[0] < nthreads[1] ? nthreads[0] : nthreads[1], secs);
+        } else {
+            kcontext_printf(context, RATES_ROW, "Interface", "RX pps", "RX bps", "TX pps", "TX bps",
+                            "Drops/s", "Errors/s", MONITOR_EOL);
+            for (size_t i = 0; i < cur->count; i++) {
+                const vpp_stats_iface_t *c = &cur->ifaces[i];
+                /* Rows of the previous sample are only comparable by name */
+                if (!c->name[0] || i >= prev->count || strcmp(c->name, prev->ifaces[i].name) != 0)
+                    continue;
+                rates_row(context, c->name, c, &prev->ifaces[i], secs, MONITOR_EOL);
+            }
+        }
+        kcontext_printf(context, "\033[J");
+        fflush(stdout);
     }
     
-    /* Parse IP addresses from "show interface addr" output */
-    char *addr_line = strtok(addr_buf, "\n");
-    char current_iface[64] = {0};
-    int current_idx = -1;
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    sigaction(SIGHUP, &old_hup, NULL);
+    kcontext_printf(context, "\n");
+out:
+    free(threads[0]);
+    free(threads[1]);
+    vpp_stats_ifaces_free(&snap[0]);
+    vpp_stats_ifaces_free(&snap[1]);
+    return rv;
+}
+
+/* Top talkers. Rates come from two snapshots TOP_SAMPLE_MS apart, and
+ * the hottest are picked with a min-heap holding the N best so far, so
+ * each counter costs O(log N) however many there are. */
+#define TOP_SAMPLE_MS 1000
+#define TOP_DEFAULT 10
+#define TOP_MAX 1000
+
+typedef struct {
+    double rate;
+    size_t index;
+} top_item_t;
+
+typedef struct {
+    top_item_t *items;
+    size_t count;
+    size_t max;
+} top_heap_t;
+
+static void top_swap(top_heap_t *h, size_t i, size_t j) {
+    top_item_t t = h->items[i];
+    h->items[i] = h->items[j];
+    h->items[j] = t;
+}
+
+static void top_sift_down(top_heap_t *h, size_t i) {
+    for (;;) {
+        size_t l = 2 * i + 1, r = l + 1, m = i;
+        if (l < h->count && h->items[l].rate < h->items[m].rate)
+            m = l;
+        if (r < h->count && h->items[r].rate < h->items[m].rate)
+            m = r;
+        if (m == i)
+            return;
+        top_swap(h, i, m);
+        i = m;
+    }
+}
+
+/* Keep @index if its rate is among the h->max highest seen */
+static void top_push(top_heap_t *h, double rate, size_t index) {
+    if (h->count < h->max) {
+        size_t i = h->count++;
+        h->items[i].rate = rate;
+        h->items[i].index = index;
+        while (i > 0 && h->items[(i - 1) / 2].rate > h->items[i].rate) {
+            top_swap(h, i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+    } else if (rate > h->items[0].rate) {
+        h->items[0].rate = rate;
+        h->items[0].index = index;
+        top_sift_down(h, 0);
+    }
+}
+
+/* Leave h->items sorted, highest rate first */
+static void top_sort(top_heap_t *h) {
+    size_t count = h->count;
     
-    while (addr_line) {
-        /* Lines like "loop0 (up):" indicate interface name */
-        /* Lines like "  L3 127.0.0.2/8" indicate IP address */
-        
-        if (addr_line[0] != ' ' && strchr(addr_line, '(')) {
-            /* This is an interface line: "loop0 (up):" */
-            sscanf(addr_line, "%63s", current_iface);
-            /* Find matching interface index */
-            current_idx = -1;
-            for (int i = 0; i < iface_count; i++) {
-                if (strcmp(interfaces[i].name, current_iface) == 0) {
-                    current_idx = i;
-                    break;
-                }
-            }
-        } else if (strstr(addr_line, "L3 ") && current_idx >= 0) {
-            /* This is an IP line: "  L3 192.168.1.1/24" */
-            char *ip_start = strstr(addr_line, "L3 ");
-            if (ip_start && interfaces[current_idx].ip_count < 8) {
-                ip_start += 3; /* Skip "L3 " */
-                /* Keep full IP with prefix */
-                char ip[48] = {0};
-                sscanf(ip_start, "%47s", ip);
-                strncpy(interfaces[current_idx].ips[interfaces[current_idx].ip_count], ip, 47);
-                interfaces[current_idx].ip_count++;
-            }
+    while (h->count > 1) {
+        top_swap(h, 0, --h->count);
+        top_sift_down(h, 0);
+    }
+    h->count = count;
+}
+
+static int top_init(kcontext_t *context, top_heap_t *h) {
+    const char *count = get_param(context, "count");
+    unsigned long n = count ? strtoul(count, NULL, 10) : TOP_DEFAULT;
+    
+    if (n < 1 || n > TOP_MAX) {
+        kcontext_printf(context, "Error: Count must be 1 to %d\n", TOP_MAX);
+        return -1;
+    }
+    h->count = 0;
+    h->max = n;
+    h->items = malloc(n * sizeof(*h->items));
+    if (!h->items) {
+        kcontext_printf(context, "Error: Out of memory\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* show top interfaces [by pps|bps|drops] [count] */
+int vpp_show_top_interfaces(kcontext_t *context) {
+    const char *order = get_param(context, "order");
+    vpp_stats_ifaces_t before = { 0 };
+    top_heap_t heap;
+    double secs;
+    int by;
+    
+    if (!order || strcmp(order, "pps") == 0)
+        by = 0;
+    else if (strcmp(order, "bps") == 0)
+        by = 1;
+    else if (strcmp(order, "drops") == 0)
+        by = 2;
+    else {
+        kcontext_printf(context, "Error: Order by pps, bps or drops\n");
+        return -1;
+    }
+    if (top_init(context, &heap) < 0)
+        return -1;
+    if (vpp_stats_ifaces(&before) < 0) {
+        kcontext_printf(context, "Error: Cannot read VPP's stats segment (%s)\n", VPP_STATS_SOCKET);
+        free(heap.items);
+        return -1;
+    }
+    usleep(TOP_SAMPLE_MS * 1000);
+    if (load_if_stats(context) < 0) {
+        vpp_stats_ifaces_free(&before);
+        free(heap.items);
+        return -1;
+    }
+    secs = (double)(if_stats.taken_ns - before.taken_ns) / 1e9;
+    
+    for (size_t i = 0; i < if_stats.count && i < before.count; i++) {
+        const vpp_stats_iface_t *c = &if_stats.ifaces[i], *p = &before.ifaces[i];
+        double rate;
+        if (!c->name[0] || strcmp(c->name, p->name) != 0)
+            continue;   /* Not the same interface in both snapshots */
+        if (by == 0)
+            rate = counter_rate(c->rx.packets + c->tx.packets, p->rx.packets + p->tx.packets, secs);
+        else if (by == 1)
+            rate = counter_rate(c->rx.bytes + c->tx.bytes, p->rx.bytes + p->tx.bytes, secs);
+        else
+            rate = counter_rate(c->drops, p->drops, secs);
+        if (rate > 0)
+            top_push(&heap, rate, i);
+    }
+    top_sort(&heap);
+    
+    if (!heap.count) {
+        kcontext_printf(context, "No interface %s in the last %.1fs\n",
+                        by == 2 ? "dropped packets" : "passed traffic", secs);
+    } else {
+        kcontext_printf(context, RATES_ROW, "Interface", "RX pps", "RX bps", "TX pps", "TX bps",
+                        "Drops/s", "Errors/s", "");
+        for (size_t i = 0; i < heap.count; i++) {
+            size_t k = heap.items[i].index;
+            rates_row(context, if_stats.ifaces[k].name, &if_stats.ifaces[k], &before.ifaces[k], secs, "");
         }
-        
-        addr_line = strtok(NULL, "\n");
     }
+    vpp_stats_ifaces_free(&before);
+    free(heap.items);
+    return 0;
+}
+
+/* show top errors [count] - the error counters moving fastest */
+int vpp_show_top_errors(kcontext_t *context) {
+    vpp_stats_counters_t before = { 0 }, after = { 0 };
+    top_heap_t heap;
+    double secs;
+    int rv = -1;
     
-    /* Print header */
-    kcontext_printf(context, "%-32s %-20s %5s %-6s %-8s\n",
-        "Interface", "IP-Address", "MTU", "Status", "Protocol");
+    if (top_init(context, &heap) < 0)
+        return -1;
+    if (vpp_stats_counters("/err/", &before) < 0)
+        goto out;
+    usleep(TOP_SAMPLE_MS * 1000);
+    if (vpp_stats_counters("/err/", &after) < 0)
+        goto out;
+    secs = (double)(after.taken_ns - before.taken_ns) / 1e9;
+    
+    /* The directory keeps its order unless VPP added or removed counters
+     * meanwhile; those that moved are skipped for this once */
+    for (size_t i = 0; i < after.count && i < before.count; i++) {
+        const vpp_stats_counter_t *c = &after.items[i], *p = &before.items[i];
+        double rate;
+        if (strcmp(c->name, p->name) != 0)
+            continue;
+        if ((rate = counter_rate(c->value, p->value, secs)) > 0)
+            top_push(&heap, rate, i);
+    }
+    top_sort(&heap);
     
-    /* Print formatted table */
-    for (int i = 0; i < iface_count; i++) {
-        if (interfaces[i].ip_count == 0) {
-            /* No IP assigned */
-            kcontext_printf(context, "%-32s %-20s %5d %-6s %-8s\n",
-                interfaces[i].name,
-                "unassigned",
-                interfaces[i].mtu,
-                interfaces[i].is_up ? "up" : "down",
-                interfaces[i].is_up ? "up" : "down");
+    if (!heap.count) {
+        kcontext_printf(context, "No error counter moved in the last %.1fs\n", secs);
+    } else {
+        kcontext_printf(context, "%9s %14s  %-28s %s\n", "Rate/s", "Count", "Node", "Reason");
+        for (size_t i = 0; i < heap.count; i++) {
+            const vpp_stats_counter_t *c = &after.items[heap.items[i].index];
+            const char *node = c->name + strlen("/err/");
+            const char *reason = strchr(node, '/');
+            char rate[16];
+            format_rate(rate, sizeof(rate), heap.items[i].rate);
+            kcontext_printf(context, "%9s %14llu  %-28.*s %s\n", rate, (unsigned long long)c->value,
+                            reason ? (int)(reason - node) : (int)strlen(node), node, reason ? reason + 1 : "");
+        }
+    }
+    rv = 0;
+out:
+    if (rv < 0)
+        kcontext_printf(context, "Error: Cannot read VPP's stats segment (%s)\n", VPP_STATS_SOCKET);
+    vpp_stats_counters_free(&before);
+    vpp_stats_counters_free(&after);
+    free(heap.items);
+    return rv;
+}
+
+/* Show recent interface events - admin/link changes, creation, deletion */
+int vpp_show_interface_events(kcontext_t *context) {
+    const vpp_ift_t *t = vpp_ift_get(VPP_IFT_STATE);
+    size_t count;
+    
+    if (!t) {
+        kcontext_printf(context, "Error: Cannot reach VPP (is it running?)\n");
+        return -1;
+    }
+    
+    count = vpp_ift_event_count();
+    if (count == 0) {
+        kcontext_printf(context, "No interface events recorded in this session\n");
+        return 0;
+    }
+    
+    kcontext_printf(context, "%-19s %-32s %s\n", "Time", "Interface", "Event");
+    for (size_t i = 0; i < count; i++) {
+        const vpp_ift_event_t *e = vpp_ift_event(i);
+        char when[32], name[64], what[48];
+        
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&e->when));
+        
+        /* Interfaces created since are known by now */
+        const vpp_ift_iface_t *row = e->name[0] ? NULL : vpp_ift_find_index(t, e->sw_if_index);
+        if (e->name[0])
+            snprintf(name, sizeof(name), "%s", e->name);
+        else if (row)
+            snprintf(name, sizeof(name), "%s", row->name);
+        else
+            snprintf(name, sizeof(name), "sw_if_index %u", e->sw_if_index);
+        
+        if (e->kind == VPP_IFT_EV_CREATED) {
+            snprintf(what, sizeof(what), "created");
+        } else if (e->kind == VPP_IFT_EV_DELETED) {
+            snprintf(what, sizeof(what), "deleted");
+        } else if (e->admin_changed || e->link_changed) {
+            snprintf(what, sizeof(what), "%s%s%s",
+                e->admin_changed ? (e->admin_up ? "admin up" : "admin down") : "",
+                e->admin_changed && e->link_changed ? ", " : "",
+                e->link_changed ? (e->link_up ? "link up" : "link down") : "");
         } else {
-            /* First IP with interface name */
-            kcontext_printf(context, "%-32s %-20s %5d %-6s %-8s\n",
-                interfaces[i].name,
-                interfaces[i].ips[0],
-                interfaces[i].mtu,
-                interfaces[i].is_up ? "up" : "down",
-                interfaces[i].is_up ? "up" : "down");
-            
-            /* Additional IPs on separate lines */
-            for (int j = 1; j < interfaces[i].ip_count; j++) {
-                kcontext_printf(context, "%-32s %-20s\n", "",
-                    interfaces[i].ips[j]);
-            }
+            snprintf(what, sizeof(what), "admin %s, link %s",
+                e->admin_up ? "up" : "down", e->link_up ? "up" : "down");
         }
+        kcontext_printf(context, "%-19s %-32s %s\n", when, name, what);
     }
     
     return 0;
@@ -518,133 +860,79 @@ int vpp_show_interfaces(kcontext_t *context) {
 
 /* Show interface details */
 int vpp_show_interface_detail(kcontext_t *context) {
-    const char *result = vpp_exec_cli("show interface addr\n");
-    kcontext_printf(context, "%s", result);
-    return 0;
+    return vpp_show_cli(context, "show interface addr");
 }
 
 /* Show IP interface brief */
 int vpp_show_ip_interface_brief(kcontext_t *context) {
-    const char *result = vpp_exec_cli("show int addr\n");
-    kcontext_printf(context, "%s", result);
+    return vpp_show_cli(context, "show int addr");
+}
+
+/* Configuration rendered as VPP commands, in push order; -1 if VPP could
+ * not be reached or memory ran out */
+static int running_ops(kcontext_t *context, int fresh, vpp_cfg_ops_t *ops,
+                       const vpp_rc_t **rc, size_t **order) {
+    *rc = vpp_rc_collect(fresh);
+    if (!*rc) {
+        kcontext_printf(context, "Error: Cannot reach VPP (is it running?)\n");
+        return -1;
+    }
+    *order = NULL;
+    if (vpp_rc_ops(*rc, ops) < 0 ||
+        !(*order = malloc((ops->count ? ops->count : 1) * sizeof(**order)))) {
+        kcontext_printf(context, "Error: Out of memory\n");
+        vpp_cfg_clear(ops);
+        return -1;
+    }
+    vpp_cfg_order(ops, *order);
     return 0;
 }
 
-/* Show running config (stub) */
-int vpp_show_running_config(kcontext_t *context) {
-    kcontext_printf(context, "!\n! VPP Running Configuration\n!\n");
-    
-    /* Show loopback interfaces */
-    const char *iface_list = vpp_exec_cli("show interface");
-    char iface_buf[BUFFER_SIZE];
-    strncpy(iface_buf, iface_list, BUFFER_SIZE - 1);
-    iface_buf[BUFFER_SIZE - 1] = 0;
-    
-    char *iline = strtok(iface_buf, "\n");
-    while (iline) {
-        if (iline[0] != ' ' && strncmp(iline, "loop", 4) == 0) {
-            kcontext_printf(context, "create loopback interface\n");
-        }
-        iline = strtok(NULL, "\n");
+static void print_sections(kcontext_t *context, const vpp_cfg_ops_t *ops,
+                           const size_t *order, int first, int last) {
+    for (size_t i = 0; i < ops->count; i++) {
+        const vpp_cfg_op_t *op = &ops->ops[order[i]];
+        if (op->section >= first && op->section <= last)
+            kcontext_printf(context, "%s\n", op->cmd);
     }
+}
+
+/* Show running config */
+int vpp_show_running_config(kcontext_t *context) {
+    vpp_cfg_ops_t ops = { NULL, 0, 0 };
+    const vpp_rc_t *rc;
+    size_t *order;
     
-    /* Show bond interfaces */
-    const char *bond_info = vpp_exec_cli("show bond");
-    char bond_buf[BUFFER_SIZE];
-    strncpy(bond_buf, bond_info, BUFFER_SIZE - 1);
-    bond_buf[BUFFER_SIZE - 1] = 0;
+    if (running_ops(context, 0, &ops, &rc, &order) < 0)
+        return -1;
     
-    char *bline = strtok(bond_buf, "\n");
-    while (bline) {
-        if (strstr(bline, "BondEthernet")) {
-            kcontext_printf(context, "create bond mode lacp load-balance l34\n");
-        }
-        bline = strtok(NULL, "\n");
-    }
-    
-    /* Show VLAN subinterfaces */
-    const char *sub_list = vpp_exec_cli("show interface");
-    char sub_buf[BUFFER_SIZE];
-    strncpy(sub_buf, sub_list, BUFFER_SIZE - 1);
-    sub_buf[BUFFER_SIZE - 1] = 0;
-    
-    char *sline = strtok(sub_buf, "\n");
-    while (sline) {
-        if (sline[0] != ' ') {
-            char name[64] = {0};
-            if (sscanf(sline, "%63s", name) == 1) {
-                char *dot = strchr(name, '.');
-                if (dot && strncmp(name, "tap", 3) != 0) {
-                    char parent[64] = {0};
-                    size_t plen = dot - name;
-                    if (plen >= sizeof(parent)) plen = sizeof(parent) - 1;
-                    strncpy(parent, name, plen);
-                    int vlan_id = atoi(dot + 1);
-                    if (vlan_id > 0 && vlan_id < 4096) {
-                        kcontext_printf(context, "create sub %s %d\n", parent, vlan_id);
-                    }
-                }
-            }
-        }
-        sline = strtok(NULL, "\n");
-    }
+    kcontext_printf(context, "!\n! VPP Running Configuration\n!\n");
     
+    /* Interfaces, bond members and VLAN subinterfaces */
+    print_sections(context, &ops, order, VPP_CFG_CREATE, VPP_CFG_SUBIF);
     kcontext_printf(context, "!\n");
     
     /* Show interface configuration */
-    const char *addrs = vpp_exec_cli("show interface addr");
-    char addr_buf[BUFFER_SIZE];
-    strncpy(addr_buf, addrs, BUFFER_SIZE - 1);
-    addr_buf[BUFFER_SIZE - 1] = 0;
-    
-    char *line = strtok(addr_buf, "\n");
-    char current_iface[64] = {0};
-    int skip_iface = 0;
-    while (line) {
-        if (line[0] != ' ' && strchr(line, '(')) {
-            sscanf(line, "%63s", current_iface);
-            skip_iface = (strncmp(current_iface, "tap", 3) == 0 ||
-                         strcmp(current_iface, "local0") == 0);
-            
-            if (!skip_iface && strstr(line, "(up)") && current_iface[0]) {
-                kcontext_printf(context, "!\ninterface %s\n", current_iface);
-                kcontext_printf(context, " no shutdown\n");
-            } else if (!skip_iface && current_iface[0]) {
-                kcontext_printf(context, "!\ninterface %s\n", current_iface);
-                kcontext_printf(context, " shutdown\n");
-            }
-        } else if (strstr(line, "L3 ") && current_iface[0] && !skip_iface) {
-            char *ip_start = strstr(line, "L3 ");
-            if (ip_start) {
-                ip_start += 3;
-                char ip[48] = {0};
-                sscanf(ip_start, "%47s", ip);
-                kcontext_printf(context, " ip address %s\n", ip);
-            }
+    for (size_t i = 0; i < rc->count; i++) {
+        const vpp_rc_iface_t *r = &rc->ifaces[i];
+        kcontext_printf(context, "!\ninterface %s\n", r->name);
+        kcontext_printf(context, r->admin_up ? " no shutdown\n" : " shutdown\n");
+        if (r->mtu)
+            kcontext_printf(context, " mtu %u\n", r->mtu);
+        for (size_t j = 0; j < r->addr_count; j++) {
+            kcontext_printf(context, " ip address %s\n", rc->addrs[r->addr_first + j].prefix);
         }
-        line = strtok(NULL, "\n");
     }
     
-    /* Show LCP */
+    /* Show LCP and routes */
     kcontext_printf(context, "!\n");
-    const char *lcp = vpp_exec_cli("show lcp");
-    char lcp_buf[BUFFER_SIZE];
-    strncpy(lcp_buf, lcp, BUFFER_SIZE - 1);
-    lcp_buf[BUFFER_SIZE - 1] = 0;
-    
-    line = strtok(lcp_buf, "\n");
-    while (line) {
-        if (strstr(line, "itf-pair:")) {
-            int idx;
-            char vpp_if[64], tap_if[64], host_if[32];
-            if (sscanf(line, "itf-pair: [%d] %63s %63s %31s", &idx, vpp_if, tap_if, host_if) >= 4) {
-                kcontext_printf(context, "lcp create %s host-if %s\n", vpp_if, host_if);
-            }
-        }
-        line = strtok(NULL, "\n");
-    }
+    print_sections(context, &ops, order, VPP_CFG_LCP, VPP_CFG_LCP);
+    kcontext_printf(context, "!\n");
+    print_sections(context, &ops, order, VPP_CFG_ROUTE, VPP_CFG_ROUTE);
     
     kcontext_printf(context, "!\nend\n");
+    free(order);
+    vpp_cfg_clear(&ops);
     return 0;
 }
 
@@ -666,8 +954,24 @@ int vpp_config_interface_ip(kcontext_t *context) {
         return -1;
     }
     
+    if (candidate_mode)
+        return stage(context, VPP_CFG_ADDRESS, iface, "set interface ip address %s %s", iface, ip_prefix);
+    
+    uint32_t sw_if_index;
+    int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_add_del_address(sw_if_index, ip_prefix, 1);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "IP address %s configured on %s\n", ip_prefix, iface);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     snprintf(cmd, sizeof(cmd), "set interface ip address %s %s", iface, ip_prefix);
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strlen(result) > 0 && (strstr(result, "error") != NULL || strstr(result, "failed") != NULL || strstr(result, "conflict") != NULL)) {
         kcontext_printf(context, "%s", result);
         return -1;
@@ -693,8 +997,24 @@ int vpp_no_interface_ip(kcontext_t *context) {
         return -1;
     }
     
+    if (candidate_mode)
+        return stage(context, VPP_CFG_ADDRESS, iface, "set interface ip address del %s %s", iface, ip_prefix);
+    
+    uint32_t sw_if_index;
+    int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_add_del_address(sw_if_index, ip_prefix, 0);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "IP address %s removed from %s\n", ip_prefix, iface);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     snprintf(cmd, sizeof(cmd), "set interface ip address del %s %s\n", iface, ip_prefix);
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strlen(result) > 0 && strstr(result, "error") != NULL) {
         kcontext_printf(context, "%s", result);
     } else {
@@ -719,8 +1039,24 @@ int vpp_config_interface_ipv6(kcontext_t *context) {
         return -1;
     }
     
+    if (candidate_mode)
+        return stage(context, VPP_CFG_ADDRESS, iface, "set interface ip address %s %s", iface, ip_prefix);
+    
+    uint32_t sw_if_index;
+    int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_add_del_address(sw_if_index, ip_prefix, 1);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "IPv6 address %s configured on %s\n", ip_prefix, iface);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     snprintf(cmd, sizeof(cmd), "set interface ip address %s %s\n", iface, ip_prefix);
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strlen(result) > 0 && strstr(result, "error") != NULL) {
         kcontext_printf(context, "%s", result);
     } else {
@@ -745,8 +1081,24 @@ int vpp_no_interface_ipv6(kcontext_t *context) {
         return -1;
     }
     
+    if (candidate_mode)
+        return stage(context, VPP_CFG_ADDRESS, iface, "set interface ip address del %s %s", iface, ip_prefix);
+    
+    uint32_t sw_if_index;
+    int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_add_del_address(sw_if_index, ip_prefix, 0);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "IPv6 address %s removed from %s\n", ip_prefix, iface);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     snprintf(cmd, sizeof(cmd), "set interface ip address del %s %s\n", iface, ip_prefix);
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strlen(result) > 0 && strstr(result, "error") != NULL) {
         kcontext_printf(context, "%s", result);
     } else {
@@ -765,8 +1117,24 @@ int vpp_interface_up(kcontext_t *context) {
         return -1;
     }
     
+    if (candidate_mode)
+        return stage(context, VPP_CFG_STATE, iface, "set interface state %s up", iface);
+    
+    uint32_t sw_if_index;
+    int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_set_admin_state(sw_if_index, 1);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "Interface %s is now up\n", iface);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     snprintf(cmd, sizeof(cmd), "set interface state %s up\n", iface);
     vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     kcontext_printf(context, "Interface %s is now up\n", iface);
     return 0;
 }
@@ -781,8 +1149,24 @@ int vpp_interface_down(kcontext_t *context) {
         return -1;
     }
     
+    if (candidate_mode)
+        return stage(context, VPP_CFG_STATE, iface, "set interface state %s down", iface);
+    
+    uint32_t sw_if_index;
+    int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_set_admin_state(sw_if_index, 0);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "Interface %s is now administratively down\n", iface);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     snprintf(cmd, sizeof(cmd), "set interface state %s down\n", iface);
     vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     kcontext_printf(context, "Interface %s is now administratively down\n", iface);
     return 0;
 }
@@ -792,31 +1176,52 @@ int vpp_enter_interface(kcontext_t *context) {
     const char *iface = get_param(context, "interface");
     char cmd[256];
     
-    
     if (!iface) {
         kcontext_printf(context, "Error: Interface name required\n");
         return -1;
     }
     
+    vpp_range_clear(&range);
+    if (candidate_mode) {
+        if (stage_interface(context, iface) < 0)
+            return -1;
+        set_current_interface(iface);
+        return 0;
+    }
+    
     /* Check if it's a loopback interface (starts with 'loop') */
     if (strncmp(iface, "loop", 4) == 0) {
         int instance = 0;
         if (sscanf(iface, "loop%d", &instance) == 1) {
-            /* Create loopback with specific instance number */
-            snprintf(cmd, sizeof(cmd), "create loopback interface instance %d", instance);
-            const char *result = vpp_exec_cli(cmd);
+            /* Create loopback with specific instance number, unless it exists */
+            uint32_t sw_if_index;
+            int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+            if (rv == VPP_API_ERR_NOENT) {
+                rv = vpp_api_create_loopback(instance, &sw_if_index);
+                vpp_ift_invalidate();
+                if (rv == 0)
+                    kcontext_printf(context, "Loopback interface %s created\n", iface);
+            }
+            if (rv != 0 && rv != VPP_API_FALLBACK)
+                return api_error(context, rv);
             
-            /* Check if created or already exists */
-            if (strstr(result, iface) || strlen(result) == 0) {
-                kcontext_printf(context, "Loopback interface %s created\n", iface);
-            } else if (strstr(result, "already exists") || strstr(result, "is in use")) {
-                /* Already exists - OK */
-            } else if (strstr(result, "unknown input") != NULL) {
-        kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
-        kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
-        return -1;
-    } else if (strlen(result) > 0) {
-                kcontext_printf(context, "%s", result);
+            if (rv == VPP_API_FALLBACK) {
+                snprintf(cmd, sizeof(cmd), "create loopback interface instance %d", instance);
+                const char *result = vpp_exec_cli(cmd);
+                vpp_ift_invalidate();
+            
+                /* Check if created or already exists */
+                if (strstr(result, iface) || strlen(result) == 0) {
+                    kcontext_printf(context, "Loopback interface %s created\n", iface);
+                } else if (strstr(result, "already exists") || strstr(result, "is in use")) {
+                    /* Already exists - OK */
+                } else if (strstr(result, "unknown input") != NULL) {
+            kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
+            kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
+            return -1;
+        } else if (strlen(result) > 0) {
+                    kcontext_printf(context, "%s", result);
+                }
             }
         }
     }
@@ -835,19 +1240,36 @@ int vpp_enter_interface(kcontext_t *context) {
         vlan_id = atoi(dot + 1);
         
         if (vlan_id > 0 && vlan_id < 4096) {
-            /* Create subinterface: create sub <parent> <vlan_id> */
-            snprintf(cmd, sizeof(cmd), "create sub %s %d", parent, vlan_id);
-            const char *result = vpp_exec_cli(cmd);
+            /* Create subinterface on the parent, unless it exists */
+            uint32_t sw_if_index, parent_index;
+            int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+            if (rv == VPP_API_ERR_NOENT) {
+                rv = vpp_api_iface_lookup(parent, &parent_index);
+                if (rv == 0)
+                    rv = vpp_api_create_vlan_subif(parent_index, vlan_id, &sw_if_index);
+                vpp_ift_invalidate();
+                if (rv == 0)
+                    kcontext_printf(context, "VLAN subinterface %s created\n", iface);
+            }
+            if (rv != 0 && rv != VPP_API_FALLBACK)
+                return api_error(context, rv);
             
-            /* Check if created or already exists */
-            if (strstr(result, iface) || strlen(result) == 0 || strstr(result, "already exists")) {
-                kcontext_printf(context, "VLAN subinterface %s created\n", iface);
-            } else if (strstr(result, "unknown input") != NULL) {
-        kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
-        kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
-        return -1;
-    } else if (strlen(result) > 0) {
-                kcontext_printf(context, "%s", result);
+            if (rv == VPP_API_FALLBACK) {
+                /* Create subinterface: create sub <parent> <vlan_id> */
+                snprintf(cmd, sizeof(cmd), "create sub %s %d", parent, vlan_id);
+                const char *result = vpp_exec_cli(cmd);
+                vpp_ift_invalidate();
+            
+                /* Check if created or already exists */
+                if (strstr(result, iface) || strlen(result) == 0 || strstr(result, "already exists")) {
+                    kcontext_printf(context, "VLAN subinterface %s created\n", iface);
+                } else if (strstr(result, "unknown input") != NULL) {
+            kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
+            kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
+            return -1;
+        } else if (strlen(result) > 0) {
+                    kcontext_printf(context, "%s", result);
+                }
             }
         }
     }
@@ -859,9 +1281,228 @@ int vpp_enter_interface(kcontext_t *context) {
 /* Exit interface configuration mode - clears interface name */
 int vpp_exit_interface(kcontext_t *context) {
     clear_current_interface();
+    vpp_range_clear(&range);
     return 0;
 }
 
+static double elapsed_since(const struct timespec *started) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - started->tv_sec) + (double)(now.tv_nsec - started->tv_nsec) / 1e9;
+}
+
+/* Add the command creating @name to @ops if it is a loopback or VLAN
+ * subinterface; 0 if it cannot be created */
+static int add_create(vpp_cfg_ops_t *ops, const char *name) {
+    const char *dot = strchr(name, '.');
+    int instance, vlan_id;
+    
+    if (strncmp(name, "loop", 4) == 0 && !dot && sscanf(name, "loop%d", &instance) == 1)
+        return vpp_cfg_add(ops, VPP_CFG_CREATE, name, "create loopback interface instance %d",
+                           instance) < 0 ? -1 : 1;
+    if (dot && (vlan_id = atoi(dot + 1)) > 0 && vlan_id < 4096)
+        return vpp_cfg_add(ops, VPP_CFG_SUBIF, name, "create sub %.*s %d",
+                           (int)(dot - name), name, vlan_id) < 0 ? -1 : 1;
+    return 0;
+}
+
+/* Enter interface range mode, creating the loopbacks and VLAN
+ * subinterfaces of the range that do not exist yet in one batch */
+int vpp_enter_interface_range(kcontext_t *context) {
+    const char *spec = get_param(context, "range");
+    vpp_cfg_ops_t ops = { NULL, 0, 0 };
+    struct timespec started;
+    const vpp_ift_t *t;
+    char err[128];
+    size_t staged = candidate.count, missing = 0;
+    int rv = -1;
+    
+    if (!spec) {
+        kcontext_printf(context, "Error: Interface range required\n");
+        return -1;
+    }
+    if (vpp_range_parse(&range, spec, err, sizeof(err)) < 0) {
+        kcontext_printf(context, "Error: Invalid interface range: %s\n", err);
+        return -1;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    if (!candidate_mode)
+        vpp_ift_invalidate();
+    t = vpp_ift_get(VPP_IFT_STATE);
+    if (!t) {
+        kcontext_printf(context, "Error: Cannot reach VPP (is it running?)\n");
+        goto out;
+    }
+    for (size_t i = 0; i < range.count; i++) {
+        const char *name = range.members[i].name;
+        int added;
+        
+        const char *dot = strchr(name, '.');
+        char parent[64];
+        
+        if (vpp_ift_find(t, name) || (candidate_mode && vpp_cfg_creates(&candidate, name)))
+            continue;
+        if (dot) {
+            snprintf(parent, sizeof(parent), "%.*s", (int)(dot - name), name);
+            if (!vpp_ift_find(t, parent) && !(candidate_mode && vpp_cfg_creates(&candidate, parent))) {
+                kcontext_printf(context, "Error: Interface %s does not exist\n", parent);
+                goto out;
+            }
+        }
+        added = add_create(candidate_mode ? &candidate : &ops, name);
+        if (added < 0) {
+            kcontext_printf(context, "Error: Out of memory\n");
+            goto out;
+        } else if (added == 0 && missing++ < 10) {
+            kcontext_printf(context, "Error: Interface %s does not exist\n", name);
+        }
+    }
+    if (missing) {
+        if (missing > 10)
+            kcontext_printf(context, "... and %zu more\n", missing - 10);
+        goto out;
+    }
+    
+    if (ops.count) {
+        int failed = vpp_cfg_push(&ops, NULL, print_op_error, context);
+        vpp_ift_invalidate();
+        if (failed < 0) {
+            kcontext_printf(context, "Error: Connection to VPP lost\n");
+            goto out;
+        }
+        kcontext_printf(context, "Created %zu interface(s) in %.3f s", ops.count - (size_t)failed,
+                        elapsed_since(&started));
+        if (failed)
+            kcontext_printf(context, "; %d failed", failed);
+        kcontext_printf(context, "\n");
+        if (failed)
+            goto out;
+    }
+    clear_current_interface();
+    rv = 0;
+out:
+    vpp_cfg_clear(&ops);
+    if (rv != 0) {
+        /* Stage all of the range or none of it */
+        if (candidate_mode)
+            candidate.count = staged;
+        vpp_range_clear(&range);
+    }
+    return rv;
+}
+
+/* What a command in range mode does to each member */
+enum { RANGE_ADDRESS, RANGE_ADDRESS_DEL, RANGE_MTU, RANGE_UP, RANGE_DOWN, RANGE_LCP, RANGE_LCP_DEL };
+
+static int range_cmd(int what, const char *iface, const char *value, char *buf, size_t size) {
+    switch (what) {
+    case RANGE_ADDRESS:
+        return snprintf(buf, size, "set interface ip address %s %s", iface, value);
+    case RANGE_ADDRESS_DEL:
+        return snprintf(buf, size, "set interface ip address del %s %s", iface, value);
+    case RANGE_MTU:
+        return snprintf(buf, size, "set interface mtu packet %s %s", value, iface);
+    case RANGE_UP:
+        return snprintf(buf, size, "set interface state %s up", iface);
+    case RANGE_DOWN:
+        return snprintf(buf, size, "set interface state %s down", iface);
+    case RANGE_LCP:
+        return snprintf(buf, size, "lcp create %s host-if %s", iface, value);
+    default:
+        return snprintf(buf, size, "lcp delete %s", iface);
+    }
+}
+
+/* Apply one interface-view command to every member of the range as one
+ * pipelined batch; @param names a value that may hold templates */
+static int range_apply(kcontext_t *context, int section, int what, const char *param) {
+    const char *tmpl = param ? get_param(context, param) : NULL;
+    vpp_cfg_ops_t ops = { NULL, 0, 0 };
+    vpp_cfg_ops_t *target = candidate_mode ? &candidate : &ops;
+    size_t staged = candidate.count;
+    struct timespec started;
+    int failed;
+    
+    if (!range.count) {
+        kcontext_printf(context, "Error: Not in interface range mode\n");
+        return -1;
+    }
+    if (param && !tmpl) {
+        kcontext_printf(context, "Error: Missing parameters\n");
+        return -1;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    for (size_t i = 0; i < range.count; i++) {
+        const char *iface = range.members[i].name;
+        char value[128], cmd[256];
+        
+        if (tmpl && vpp_range_expand(tmpl, &range, i, value, sizeof(value)) < 0) {
+            kcontext_printf(context, "Error: Invalid template: %s\n", tmpl);
+            goto fail;
+        }
+        range_cmd(what, iface, tmpl ? value : "", cmd, sizeof(cmd));
+        if (vpp_cfg_add(target, section, iface, "%s", cmd) < 0) {
+            kcontext_printf(context, "Error: Out of memory\n");
+            goto fail;
+        }
+    }
+    
+    if (candidate_mode) {
+        kcontext_printf(context, "Staged %zu change(s)\n", range.count);
+        return 0;
+    }
+    failed = vpp_cfg_push(&ops, NULL, print_op_error, context);
+    vpp_ift_invalidate();
+    vpp_cfg_clear(&ops);
+    if (failed < 0) {
+        kcontext_printf(context, "Error: Connection to VPP lost\n");
+        return -1;
+    }
+    kcontext_printf(context, "Applied to %zu interface(s) in %.3f s", range.count - (size_t)failed,
+                    elapsed_since(&started));
+    if (failed)
+        kcontext_printf(context, "; %d failed", failed);
+    kcontext_printf(context, "\n");
+    return failed ? -1 : 0;
+    
+fail:
+    /* Nothing of a command that could not be expanded is kept */
+    if (candidate_mode)
+        candidate.count = staged;
+    vpp_cfg_clear(&ops);
+    return -1;
+}
+
+int vpp_range_ip_address(kcontext_t *context) {
+    return range_apply(context, VPP_CFG_ADDRESS, RANGE_ADDRESS, "address");
+}
+
+int vpp_range_no_ip_address(kcontext_t *context) {
+    return range_apply(context, VPP_CFG_ADDRESS, RANGE_ADDRESS_DEL, "address");
+}
+
+int vpp_range_mtu(kcontext_t *context) {
+    return range_apply(context, VPP_CFG_MTU, RANGE_MTU, "mtu");
+}
+
+int vpp_range_up(kcontext_t *context) {
+    return range_apply(context, VPP_CFG_STATE, RANGE_UP, NULL);
+}
+
+int vpp_range_down(kcontext_t *context) {
+    return range_apply(context, VPP_CFG_STATE, RANGE_DOWN, NULL);
+}
+
+int vpp_range_lcp(kcontext_t *context) {
+    return range_apply(context, VPP_CFG_LCP, RANGE_LCP, "hostif");
+}
+
+int vpp_range_no_lcp(kcontext_t *context) {
+    return range_apply(context, VPP_CFG_LCP, RANGE_LCP_DEL, NULL);
+}
+
 /* Set MTU for current interface */
 int vpp_set_mtu(kcontext_t *context) {
     const char *mtu = get_param(context, "mtu");
@@ -878,9 +1519,25 @@ int vpp_set_mtu(kcontext_t *context) {
         return -1;
     }
     
+    if (candidate_mode)
+        return stage(context, VPP_CFG_MTU, iface, "set interface mtu packet %s %s", mtu, iface);
+    
+    uint32_t sw_if_index;
+    int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_set_mtu(sw_if_index, (uint32_t)strtoul(mtu, NULL, 10));
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "MTU set to %s on %s\n", mtu, iface);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     /* VPP command: set interface mtu packet <value> <interface> */
     snprintf(cmd, sizeof(cmd), "set interface mtu packet %s %s\n", mtu, iface);
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strstr(result, "unknown input") != NULL) {
         kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
         kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
@@ -909,8 +1566,24 @@ int vpp_lcp_create_current(kcontext_t *context) {
         return -1;
     }
     
+    if (candidate_mode)
+        return stage(context, VPP_CFG_LCP, iface, "lcp create %s host-if %s", iface, hostif);
+    
+    uint32_t sw_if_index;
+    int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_lcp_add_del(sw_if_index, hostif, 1);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "LCP created: %s -> %s\n", iface, hostif);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     snprintf(cmd, sizeof(cmd), "lcp create %s host-if %s\n", iface, hostif);
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strstr(result, "unknown input") != NULL) {
         kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
         kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
@@ -933,8 +1606,24 @@ int vpp_lcp_delete_current(kcontext_t *context) {
         return -1;
     }
     
+    if (candidate_mode)
+        return stage(context, VPP_CFG_LCP, iface, "lcp delete %s", iface);
+    
+    uint32_t sw_if_index;
+    int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_lcp_add_del(sw_if_index, NULL, 0);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "LCP deleted: %s\n", iface);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     snprintf(cmd, sizeof(cmd), "lcp delete %s\n", iface);
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strstr(result, "unknown input") != NULL) {
         kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
         kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
@@ -952,12 +1641,24 @@ int vpp_create_loopback(kcontext_t *context) {
     const char *instance = get_param(context, "instance");
     char cmd[256];
     
+    uint32_t sw_if_index;
+    int rv = vpp_api_create_loopback(instance && strlen(instance) > 0 ? atoi(instance) : -1,
+                                     &sw_if_index);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "Loopback created (sw_if_index %u)\n", sw_if_index);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     if (instance && strlen(instance) > 0) {
         snprintf(cmd, sizeof(cmd), "create loopback interface instance %s", instance);
     } else {
         snprintf(cmd, sizeof(cmd), "create loopback interface");
     }
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     kcontext_printf(context, "%s", result);
     return 0;
 }
@@ -973,297 +1674,1029 @@ int vpp_create_tap(kcontext_t *context) {
         snprintf(cmd, sizeof(cmd), "create tap id 0\n");
     }
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     kcontext_printf(context, "%s", result);
     return 0;
 }
 
 /* Show VPP version */
 int vpp_show_version(kcontext_t *context) {
-    const char *result = vpp_exec_cli("show version\n");
-    kcontext_printf(context, "%s", result);
+    return vpp_show_cli(context, "show version");
+}
+
+/* Address or prefix given to "show-ip-route" */
+typedef struct {
+    int af;
+    uint8_t addr[16];
+    int plen;
+} route_query_t;
+
+/* "x.x.x.x", "x.x.x.x/y" or their IPv6 forms; an address is a host prefix */
+static int parse_route_query(vpp_sv_t text, route_query_t *q) {
+    char buf[64];
+    char *slash, *end;
+    
+    if (text.len >= sizeof(buf))
+        return -1;
+    vpp_sv_copy(text, buf, sizeof(buf));
+    slash = strchr(buf, '/');
+    if (slash)
+        *slash = 0;
+    q->af = strchr(buf, ':') ? AF_INET6 : AF_INET;
+    memset(q->addr, 0, sizeof(q->addr));
+    if (inet_pton(q->af, buf, q->addr) != 1)
+        return -1;
+    q->plen = q->af == AF_INET6 ? 128 : 32;
+    if (slash) {
+        long len = strtol(slash + 1, &end, 10);
+        if (end == slash + 1 || *end || len < 0 || len > q->plen)
+            return -1;
+        q->plen = (int)len;
+    }
     return 0;
 }
 
-/* Show IP routes */
+/* Whether @inner lies within @outer */
+static int route_within(const route_query_t *outer, const route_query_t *inner) {
+    int full = outer->plen / 8, bits = outer->plen % 8;
+    
+    if (inner->af != outer->af || inner->plen < outer->plen ||
+        memcmp(inner->addr, outer->addr, (size_t)full) != 0)
+        return 0;
+    return !bits || ((inner->addr[full] ^ outer->addr[full]) & (0xff00 >> bits)) == 0;
+}
+
+/* Show IP routes: all of them, or the one VPP forwards an address or
+ * prefix with, looked up by VPP itself */
 int vpp_show_ip_route(kcontext_t *context) {
-    const char *result = vpp_exec_cli("show ip fib\n");
-    kcontext_printf(context, "%s", result);
+    const char *prefix = get_param(context, "prefix");
+    route_query_t q;
+    char cmd[128];
+    
+    if (!prefix)
+        return vpp_show_cli(context, "show ip fib");
+    if (parse_route_query(vpp_sv(prefix, strlen(prefix)), &q) < 0) {
+        kcontext_printf(context, "Error: Invalid address or prefix: %s\n", prefix);
+        return -1;
+    }
+    snprintf(cmd, sizeof(cmd), "show %s fib %s", q.af == AF_INET6 ? "ip6" : "ip", prefix);
+    return vpp_show_cli(context, cmd);
+}
+
+/* Entries of the default table within a prefix, filtered as they stream */
+typedef struct {
+    kcontext_t *context;
+    route_query_t q;
+    int in_default;
+    int printing;
+    size_t matched;
+} fib_filter_t;
+
+static int fib_filter_line(vpp_sv_t line, void *arg) {
+    fib_filter_t *f = arg;
+    vpp_sv_t rest = line, field;
+    route_query_t entry;
+    
+    if (line.len && line.p[0] != ' ') {
+        f->printing = 0;
+        if (vpp_sv_starts(line, "ipv4-VRF:") || vpp_sv_starts(line, "ipv6-VRF:")) {
+            f->in_default = vpp_sv_starts(line, "ipv4-VRF:0,") || vpp_sv_starts(line, "ipv6-VRF:0,");
+        } else if (f->in_default && vpp_sv_field(&rest, &field) &&
+                   parse_route_query(field, &entry) == 0 && route_within(&f->q, &entry)) {
+            f->printing = 1;
+            f->matched++;
+        }
+    }
+    if (f->printing)
+        kcontext_printf(f->context, "%.*s\n", (int)line.len, line.p);
     return 0;
 }
 
-/* Add IP route */
-int vpp_add_ip_route(kcontext_t *context) {
+static int fib_filter_chunk(const char *data, size_t len, void *arg) {
+    int rv = vpp_lines_feed(arg, data, len);
+    fflush(stdout);             /* As print_chunk() */
+    return rv;
+}
+
+/* Show every route of the default table inside a prefix. VPP has no such
+ * lookup, so its dump is streamed through a filter holding one line. */
+int vpp_show_ip_route_longer(kcontext_t *context) {
+    const char *prefix = get_param(context, "prefix");
+    fib_filter_t f = { context, { 0, { 0 }, 0 }, 1, 0, 0 };
+    vpp_lines_t lines;
+    int rv;
+    
+    if (!prefix || parse_route_query(vpp_sv(prefix, strlen(prefix)), &f.q) < 0) {
+        kcontext_printf(context, "Error: Invalid address or prefix: %s\n", prefix ? prefix : "");
+        return -1;
+    }
+    vpp_lines_init(&lines, fib_filter_line, &f);
+    rv = vpp_exec_cli_stream(f.q.af == AF_INET6 ? "show ip6 fib" : "show ip fib",
+                             fib_filter_chunk, &lines);
+    vpp_lines_flush(&lines);
+    if (rv == VPP_CLI_ERR_IO) {
+        kcontext_printf(context, "\nError: Connection to VPP lost\n");
+        return -1;
+    } else if (rv != 0) {
+        kcontext_printf(context, "Error: Cannot reach VPP (is it running?)\n");
+        return -1;
+    }
+    if (!f.matched)
+        kcontext_printf(context, "No routes within %s\n", prefix);
+    return 0;
+}
+
+/*
+ * Routes of the default table per prefix length, from VPP's own summary
+ *   ipv4-VRF:0, fib_index:0, flow hash:[...] ...
+ *       Prefix length         Count
+ *             0                 1
+ * so the table itself never has to be transferred.
+ */
+static void print_fib_summary(kcontext_t *context, const char *family, const char *out) {
+    vpp_sv_t text = vpp_sv(out, out ? strlen(out) : 0), line;
+    uint64_t total = 0;
+    int in_default = 0, header = 0;
+    
+    while (vpp_sv_line(&text, &line)) {
+        vpp_sv_t rest = line, len_field, count_field, extra;
+        uint32_t len, count;
+        
+        if (vpp_sv_starts(line, "ipv4-VRF:") || vpp_sv_starts(line, "ipv6-VRF:")) {
+            in_default = vpp_sv_starts(line, "ipv4-VRF:0,") || vpp_sv_starts(line, "ipv6-VRF:0,");
+            continue;
+        }
+        if (!in_default || !vpp_sv_field(&rest, &len_field) || !vpp_sv_field(&rest, &count_field) ||
+            vpp_sv_field(&rest, &extra) || vpp_sv_u32(len_field, &len) < 0 ||
+            vpp_sv_u32(count_field, &count) < 0 || len_field.len != strspn(len_field.p, "0123456789"))
+            continue;
+        if (!header) {
+            kcontext_printf(context, "%s routes in the default table\n", family);
+            kcontext_printf(context, "  %-14s %12s\n", "Prefix length", "Routes");
+            header = 1;
+        }
+        kcontext_printf(context, "  /%-13u %12u\n", len, count);
+        total += count;
+    }
+    if (header)
+        kcontext_printf(context, "  %-14s %12llu\n\n", "Total", (unsigned long long)total);
+    else
+        kcontext_printf(context, "%s routes in the default table: none\n\n", family);
+}
+
+int vpp_show_ip_route_summary(kcontext_t *context) {
+    vpp_cli_batch_t batch[2] = {
+        { .cmd = "show ip fib summary" },
+        { .cmd = "show ip6 fib summary" },
+    };
+    
+    if (vpp_cli_batch(batch, 2) != 0) {
+        kcontext_printf(context, "Error: Cannot reach VPP (is it running?)\n");
+        vpp_cli_batch_free(batch, 2);
+        return -1;
+    }
+    print_fib_summary(context, "IPv4", batch[0].out);
+    print_fib_summary(context, "IPv6", batch[1].out);
+    vpp_cli_batch_free(batch, 2);
+    return 0;
+}
+
+/* ip route <network> next-hop <gateway> [interface <name>], and the no
+ * form; the interface is what makes a link-local next hop usable */
+static int change_ip_route(kcontext_t *context, int is_add) {
     const char *network = get_param(context, "network");
     const char *gateway = get_param(context, "gateway");
-    char cmd[256];
+    const char *iface = get_param(context, "interface");
+    const char *verb = is_add ? "add" : "del";
+    uint32_t sw_if_index = ~0u;
+    vpp_route_t route;
+    char args[256], cmd[300];
+    int rv = 0;
     
     if (!network || !gateway) {
         kcontext_printf(context, "Error: Missing parameters\n");
         return -1;
     }
     
-    /* Network is already in CIDR format (x.x.x.x/y) */
-    snprintf(cmd, sizeof(cmd), "ip route add %s via %s\n", network, gateway);
-    const char *result = vpp_exec_cli(cmd);
-    if (strstr(result, "unknown input") != NULL) {
-        kcontext_printf(context, "Error: Route command failed\n");
+    /* Network must be in CIDR format (x.x.x.x/y) */
+    if (!strchr(network, '/')) {
+        kcontext_printf(context, "Error: Missing prefix length: %s\n", network);
         return -1;
-    } else if (strlen(result) > 0) {
-        kcontext_printf(context, "%s", result);
-    } else {
-        kcontext_printf(context, "Route added: %s via %s\n", network, gateway);
     }
+    if (vpp_route_init(&route, 0, network, gateway, iface, 1) < 0) {
+        kcontext_printf(context, "Error: Invalid route: %s via %s\n", network, gateway);
+        return -1;
+    }
+    vpp_route_format(&route, args, sizeof(args));
+    
+    if (candidate_mode)
+        return stage(context, VPP_CFG_ROUTE, NULL, "ip route %s %s", verb, args);
+    
+    if (iface)
+        rv = vpp_api_iface_lookup(iface, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_route_add_del(network, gateway, sw_if_index, is_add);
+    if (rv == VPP_API_FALLBACK) {
+        snprintf(cmd, sizeof(cmd), "ip route %s %s\n", verb, args);
+        const char *result = vpp_exec_cli(cmd);
+        if (strstr(result, "unknown input") != NULL) {
+            kcontext_printf(context, "Error: Route command failed\n");
+            return -1;
+        } else if (strlen(result) > 0) {
+            kcontext_printf(context, "%s", result);
+            return 0;
+        }
+    } else if (rv != 0) {
+        return api_error(context, rv);
+    }
+    
+    /* Running-config shows the routes recorded here */
+    if (vpp_routes_record(&route, 1, is_add) < 0)
+        kcontext_printf(context, "Warning: Cannot update %s: %s\n", VPP_ROUTES_FILE, strerror(errno));
+    kcontext_printf(context, "Route %s: %s\n", is_add ? "added" : "deleted", args);
     return 0;
 }
 
+/* Add IP route */
+int vpp_add_ip_route(kcontext_t *context) {
+    return change_ip_route(context, 1);
+}
+
 /* Delete IP route */
 int vpp_del_ip_route(kcontext_t *context) {
-    const char *network = get_param(context, "network");
-    const char *mask = get_param(context, "mask");
-    const char *gateway = get_param(context, "gateway");
+    return change_ip_route(context, 0);
+}
+
+/* Route files are pushed this many routes at a time */
+#define ROUTE_CHUNK 4096
+/* Errors beyond this many are only counted */
+#define ROUTE_ERRORS_SHOWN 50
+
+typedef struct {
+    kcontext_t *context;
+    const char *path;
+    int is_add;
+    vpp_api_route_t *routes;
+    unsigned int *lines;        /* File line of each route */
+    size_t count;
+    size_t done;
+    size_t failed;
+    int use_cli;                /* VPP has no API for routes */
+    vpp_route_t *taken;         /* Routes VPP took, recorded at the end */
+    size_t taken_count;
+    size_t taken_cap;
+    int taken_lost;             /* Some could not be kept for the record */
+} route_import_t;
+
+static void route_error(route_import_t *imp, unsigned int line, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+static void route_error(route_import_t *imp, unsigned int line, const char *fmt, ...) {
+    char msg[256];
+    va_list ap;
+    
+    if (imp->failed++ >= ROUTE_ERRORS_SHOWN)
+        return;
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    kcontext_printf(imp->context, "Error: %s line %u: %s\n", imp->path, line, msg);
+}
+
+/* "<prefix> [via] <next-hop> [table <id>] [weight <1-255>]" */
+static int parse_route_line(vpp_sv_t line, vpp_api_route_t *r, const char **why) {
+    vpp_sv_t f, value;
+    uint32_t n;
+    
+    memset(r, 0, sizeof(*r));
+    r->weight = 1;
+    if (!vpp_sv_field(&line, &f) || !memchr(f.p, '/', f.len) ||
+        vpp_sv_copy(f, r->prefix, sizeof(r->prefix)) != f.len) {
+        *why = "expected <prefix>/<length>";
+        return -1;
+    }
+    if (!vpp_sv_field(&line, &f) || (vpp_sv_eq(f, "via") && !vpp_sv_field(&line, &f)))
+        f.len = 0;
+    if (!f.len || vpp_sv_copy(f, r->next_hop, sizeof(r->next_hop)) != f.len) {
+        *why = "expected a next hop";
+        return -1;
+    }
+    while (vpp_sv_field(&line, &f)) {
+        if (!vpp_sv_field(&line, &value) || vpp_sv_u32(value, &n) < 0) {
+            *why = "expected a number";
+            return -1;
+        }
+        if (vpp_sv_eq(f, "table")) {
+            r->table_id = n;
+        } else if (vpp_sv_eq(f, "weight") && n >= 1 && n <= 255) {
+            r->weight = (uint8_t)n;
+        } else {
+            *why = vpp_sv_eq(f, "weight") ? "weight must be 1-255" : "unexpected keyword";
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void route_cmd(const route_import_t *imp, const vpp_api_route_t *r, char *buf, size_t size) {
+    int len = snprintf(buf, size, "ip route %s %s", imp->is_add ? "add" : "del", r->prefix);
+    if (r->table_id)
+        len += snprintf(buf + len, size - len, " table %u", r->table_id);
+    len += snprintf(buf + len, size - len, " via %s", r->next_hop);
+    if (r->weight != 1)
+        snprintf(buf + len, size - len, " weight %u", r->weight);
+}
+
+/* Keep the routes of this chunk that VPP took, to record them at the end */
+static void route_take(route_import_t *imp) {
+    if (imp->taken_count + imp->count > imp->taken_cap) {
+        size_t cap = imp->taken_cap ? imp->taken_cap : ROUTE_CHUNK;
+        while (cap < imp->taken_count + imp->count)
+            cap *= 2;
+        vpp_route_t *p = realloc(imp->taken, cap * sizeof(*p));
+        if (!p) {
+            imp->taken_lost = 1;
+            return;
+        }
+        imp->taken = p;
+        imp->taken_cap = cap;
+    }
+    for (size_t i = 0; i < imp->count; i++) {
+        const vpp_api_route_t *r = &imp->routes[i];
+        if (r->rv == 0 && vpp_route_init(&imp->taken[imp->taken_count], r->table_id, r->prefix,
+                                         r->next_hop, NULL, r->weight) == 0)
+            imp->taken_count++;
+    }
+}
+
+/* Record the routes VPP took, for running-config. Once per import: each
+ * update rewrites the whole record. */
+static void route_record(route_import_t *imp) {
+    if (vpp_routes_record(imp->taken, imp->taken_count, imp->is_add) < 0)
+        kcontext_printf(imp->context, "Warning: Cannot update %s: %s\n", VPP_ROUTES_FILE,
+                        strerror(errno));
+    else if (imp->taken_lost)
+        kcontext_printf(imp->context, "Warning: Cannot update %s: %s\n", VPP_ROUTES_FILE,
+                        strerror(ENOMEM));
+}
+
+/* Push the routes collected so far, through the API or pipelined CLI */
+static int route_flush(route_import_t *imp) {
+    int rv = 0;
+    
+    if (!imp->count)
+        return 0;
+    if (!imp->use_cli) {
+        rv = vpp_api_route_batch(imp->routes, imp->count, imp->is_add);
+        if (rv == VPP_API_FALLBACK)
+            imp->use_cli = 1;
+    }
+    if (imp->use_cli) {
+        vpp_cli_batch_t *batch = calloc(imp->count, sizeof(*batch));
+        char *cmds = malloc(imp->count * 160);
+        
+        if (!batch || !cmds) {
+            free(batch);
+            free(cmds);
+            kcontext_printf(imp->context, "Error: Out of memory\n");
+            return -1;
+        }
+        for (size_t i = 0; i < imp->count; i++) {
+            route_cmd(imp, &imp->routes[i], cmds + i * 160, 160);
+            batch[i].cmd = cmds + i * 160;
+        }
+        rv = vpp_cli_batch(batch, imp->count);
+        for (size_t i = 0; i < imp->count; i++) {
+            const char *out = batch[i].out;
+            size_t len = out ? strlen(out) : 0;
+            while (len > 0 && isspace((unsigned char)out[len - 1]))
+                len--;
+            if (rv != 0 || !out)
+                imp->routes[i].rv = VPP_API_ERR_IO;
+            else if (len) {
+                route_error(imp, imp->lines[i], "%s: %.*s", batch[i].cmd, (int)len, out);
+                imp->routes[i].rv = -1;     /* Rejected, without a retval */
+            } else {
+                imp->routes[i].rv = 0;
+            }
+            if (rv == 0 && out && !len)
+                imp->done++;
+        }
+        vpp_cli_batch_free(batch, imp->count);
+        free(batch);
+        free(cmds);
+        rv = rv != 0 ? VPP_API_ERR_IO : 0;
+    } else {
+        for (size_t i = 0; i < imp->count; i++) {
+            if (imp->routes[i].rv == 0)
+                imp->done++;
+            else if (rv == 0)
+                route_error(imp, imp->lines[i], "%s via %s: %s", imp->routes[i].prefix,
+                            imp->routes[i].next_hop, vpp_api_strerror(imp->routes[i].rv));
+        }
+    }
+    route_take(imp);
+    if (rv != 0) {
+        kcontext_printf(imp->context, "Error: Connection to VPP lost at %s line %u\n",
+                        imp->path, imp->lines[0]);
+        return -1;
+    }
+    imp->count = 0;
+    return 0;
+}
+
+/*
+ * Add or delete every route listed in a file, one per line as
+ *   <prefix> [via] <next-hop> [table <id>] [weight <1-255>]
+ * Blank lines and lines starting with '#' are skipped.
+ */
+static int import_routes(kcontext_t *context, int is_add) {
+    const char *path = get_param(context, "file");
+    route_import_t imp = { context, path, is_add, NULL, NULL, 0, 0, 0, 0, NULL, 0, 0, 0 };
+    struct timespec started, finished;
+    unsigned int lineno = 0;
+    char *buf = NULL;
+    size_t buf_size = 0;
+    ssize_t n;
+    int rv = -1;
+    FILE *fp;
+    
+    if (!path) {
+        kcontext_printf(context, "Error: Missing file name\n");
+        return -1;
+    }
+    fp = fopen(path, "r");
+    if (!fp) {
+        kcontext_printf(context, "Error: Cannot read %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    imp.routes = malloc(ROUTE_CHUNK * sizeof(*imp.routes));
+    imp.lines = malloc(ROUTE_CHUNK * sizeof(*imp.lines));
+    if (!imp.routes || !imp.lines) {
+        kcontext_printf(context, "Error: Out of memory\n");
+        goto out;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    while ((n = getline(&buf, &buf_size, fp)) >= 0) {
+        while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == '\r'))
+            n--;
+        vpp_sv_t line = vpp_sv(buf, (size_t)n), rest = line, first;
+        const char *why;
+        char cmd[160];
+        
+        lineno++;
+        if (!vpp_sv_field(&rest, &first) || first.p[0] == '#')
+            continue;
+        if (parse_route_line(line, &imp.routes[imp.count], &why) < 0) {
+            route_error(&imp, lineno, "%s", why);
+            continue;
+        }
+        if (candidate_mode) {
+            route_cmd(&imp, &imp.routes[imp.count], cmd, sizeof(cmd));
+            if (stage(context, VPP_CFG_ROUTE, NULL, "%s", cmd) < 0)
+                goto out;
+            imp.done++;
+            continue;
+        }
+        imp.lines[imp.count++] = lineno;
+        if (imp.count == ROUTE_CHUNK && route_flush(&imp) < 0)
+            goto out;
+    }
+    if (route_flush(&imp) < 0)
+        goto out;
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    
+    double secs = (double)(finished.tv_sec - started.tv_sec) +
+                  (double)(finished.tv_nsec - started.tv_nsec) / 1e9;
+    if (imp.failed > ROUTE_ERRORS_SHOWN)
+        kcontext_printf(context, "... %zu more error(s) not shown\n", imp.failed - ROUTE_ERRORS_SHOWN);
+    if (candidate_mode)
+        kcontext_printf(context, "Staged %zu route(s)", imp.done);
+    else
+        kcontext_printf(context, "%s %zu route(s) in %.3f s (%.0f routes/s)",
+                        is_add ? "Imported" : "Deleted", imp.done, secs,
+                        secs > 0 ? (double)imp.done / secs : 0.0);
+    if (imp.failed)
+        kcontext_printf(context, ", %zu failed", imp.failed);
+    kcontext_printf(context, "\n");
+    rv = imp.failed ? -1 : 0;
+out:
+    /* Also after an error: VPP keeps what it took before it */
+    route_record(&imp);
+    fclose(fp);
+    free(buf);
+    free(imp.routes);
+    free(imp.lines);
+    free(imp.taken);
+    return rv;
+}
+
+int vpp_import_ip_routes(kcontext_t *context) {
+    return import_routes(context, 1);
+}
+
+int vpp_delete_ip_routes(kcontext_t *context) {
+    return import_routes(context, 0);
+}
+
+/* Show hardware info */
+int vpp_show_hardware(kcontext_t *context) {
+    return vpp_show_cli(context, "show hardware-interfaces");
+}
+
+/* Ping */
+int vpp_ping(kcontext_t *context) {
+    const char *target = get_param(context, "target");
     char cmd[256];
     
-    if (!network || !gateway) {
-        kcontext_printf(context, "Error: Missing parameters\n");
+    if (!target) {
+        kcontext_printf(context, "Error: Target IP required\n");
         return -1;
     }
     
-    int prefix = 24;
-    if (mask) {
-        if (strcmp(mask, "255.255.255.0") == 0) prefix = 24;
-        else if (strcmp(mask, "255.255.0.0") == 0) prefix = 16;
-        else if (strcmp(mask, "255.0.0.0") == 0) prefix = 8;
+    snprintf(cmd, sizeof(cmd), "ping %s repeat 5", target);
+    return vpp_show_cli(context, cmd);
+}
+
+/* Write memory (save config) - saves VPP running config to file */
+#define CONFIG_FILE "/etc/vpp/klish-startup.conf"
+#define CHECKPOINT_DIR "/etc/vpp/klish-checkpoints"
+
+/* Parse a configuration as write-memory saves it into @ops; errors go to
+ * @context unless it is NULL */
+static int read_config(kcontext_t *context, const char *path, vpp_cfg_ops_t *ops) {
+    unsigned int lineno = 0;
+    int bad = 0;
+    char *text;
+    long size;
+    FILE *fp;
+    
+    fp = fopen(path, "r");
+    if (!fp) {
+        if (context)
+            kcontext_printf(context, "Error: Cannot read %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+    text = size >= 0 ? vpp_arena_alloc(&cmd_arena, (size_t)size + 1) : NULL;
+    if (!text || fread(text, 1, (size_t)size, fp) != (size_t)size) {
+        if (context)
+            kcontext_printf(context, "Error: Cannot read %s\n", path);
+        fclose(fp);
+        return -1;
     }
+    fclose(fp);
     
-    snprintf(cmd, sizeof(cmd), "ip route del %s/%d via %s\n", network, prefix, gateway);
-    const char *result = vpp_exec_cli(cmd);
-    if (strstr(result, "unknown input") != NULL) {
-        kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
-        kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
+    vpp_sv_t rest = vpp_sv(text, (size_t)size), line;
+    while (vpp_sv_line(&rest, &line)) {
+        lineno++;
+        if (vpp_cfg_parse_line(ops, line, lineno) < 0) {
+            if (context)
+                kcontext_printf(context, "Error: %s line %u: unrecognized command: %.*s\n",
+                                path, lineno, (int)line.len, line.p);
+            bad++;
+        }
+    }
+    return bad ? -1 : 0;
+}
+
+typedef struct {
+    const vpp_cfg_ops_t *ops;
+    const size_t *order;
+} config_text_t;
+
+static int print_config(FILE *fp, void *arg) {
+    const config_text_t *text = arg;
+    int section = -1;
+    
+    fprintf(fp, "# VPP Klish Configuration - Auto-generated\n");
+    fprintf(fp, "# Generated at startup\n");
+    
+    /* Sections in the order load-startup-config applies them */
+    for (size_t i = 0; i < text->ops->count; i++) {
+        const vpp_cfg_op_t *op = &text->ops->ops[text->order[i]];
+        if (op->section != section) {
+            section = op->section;
+            fprintf(fp, "\n# %s\n", vpp_cfg_section_name(section));
+        }
+        fprintf(fp, "%s\n", op->cmd);
+    }
+    return 0;
+}
+
+static int write_config(kcontext_t *context, const char *path,
+                        const vpp_cfg_ops_t *ops, const size_t *order) {
+    config_text_t text = { ops, order };
+    
+    if (vpp_save_file(path, 0, print_config, &text) < 0) {
+        kcontext_printf(context, "Error: Cannot write to %s: %s\n", path, strerror(errno));
         return -1;
-    } else if (strlen(result) > 0) {
-        kcontext_printf(context, "%s", result);
-    } else {
-        kcontext_printf(context, "Route deleted: %s/%d via %s\n", network, prefix, gateway);
     }
     return 0;
 }
 
-/* Show hardware info */
-int vpp_show_hardware(kcontext_t *context) {
-    const char *result = vpp_exec_cli("show hardware-interfaces\n");
-    kcontext_printf(context, "%s", result);
+/* Checkpoints are saved configurations named by the operator */
+static int checkpoint_path(kcontext_t *context, const char *name, char *path, size_t size) {
+    if (!name || !*name || strspn(name, "abcdefghijklmnopqrstuvwxyz"
+                                        "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-") != strlen(name)) {
+        kcontext_printf(context, "Error: Checkpoint names use letters, digits, '_' and '-'\n");
+        return -1;
+    }
+    snprintf(path, size, "%s/%s.conf", CHECKPOINT_DIR, name);
     return 0;
 }
 
-/* Ping */
-int vpp_ping(kcontext_t *context) {
-    const char *target = get_param(context, "target");
-    char cmd[256];
-    
-    if (!target) {
-        kcontext_printf(context, "Error: Target IP required\n");
+/* Collect the running configuration and save it as generation @gen,
+ * unless the file already says the same; @msg receives the outcome. Needs
+ * no session, so a background saver runs it too. */
+static int save_running(uint32_t gen, char *msg, size_t size) {
+    vpp_cfg_ops_t ops = { NULL, 0, 0 }, saved = { NULL, 0, 0 };
+    vpp_cfg_diff_t diff = { NULL, 0 };
+    int changed[VPP_CFG_SECTIONS] = { 0 };
+    const vpp_rc_t *rc;
+    size_t *order = NULL;
+    int rv = -1;
+    
+    /* The whole snapshot is taken before anything is written */
+    rc = vpp_rc_collect(1);
+    if (!rc) {
+        snprintf(msg, size, "Error: Cannot reach VPP (is it running?)");
         return -1;
     }
+    if (vpp_rc_ops(rc, &ops) < 0 ||
+        !(order = malloc((ops.count ? ops.count : 1) * sizeof(*order)))) {
+        snprintf(msg, size, "Error: Out of memory");
+        goto out;
+    }
+    vpp_cfg_order(&ops, order);
     
-    snprintf(cmd, sizeof(cmd), "ping %s repeat 5\n", target);
-    const char *result = vpp_exec_cli(cmd);
-    kcontext_printf(context, "%s", result);
-    return 0;
+    /* Leave the file alone when it already says the same */
+    if (read_config(NULL, CONFIG_FILE, &saved) == 0 &&
+        vpp_cfg_diff(&saved, &ops, &diff) == 0 && diff.count == 0) {
+        snprintf(msg, size, "Configuration unchanged in %s", CONFIG_FILE);
+        rv = 0;
+        goto out;
+    }
+    
+    config_text_t text = { &ops, order };
+    rv = vpp_save_file(CONFIG_FILE, gen, print_config, &text);
+    if (rv < 0) {
+        snprintf(msg, size, "Error: Cannot write to %s: %s", CONFIG_FILE, strerror(errno));
+        goto out;
+    } else if (rv == VPP_SAVE_SUPERSEDED) {
+        snprintf(msg, size, "Not saved: a newer save is already in %s", CONFIG_FILE);
+        rv = 0;
+        goto out;
+    }
+    
+    size_t len = (size_t)snprintf(msg, size, "Configuration saved to %s", CONFIG_FILE);
+    for (size_t i = 0; i < diff.count; i++) {
+        const vpp_cfg_delta_t *d = &diff.items[i];
+        changed[(d->to ? d->to : d->from)->section]++;
+    }
+    for (int s = 0, first = 1; s < VPP_CFG_SECTIONS && len < size; s++) {
+        if (!changed[s])
+            continue;
+        len += (size_t)snprintf(msg + len, size - len, "%s %s (%d)", first ? "\nChanged:" : "",
+                                vpp_cfg_section_name(s), changed[s]);
+        first = 0;
+    }
+out:
+    vpp_cfg_diff_free(&diff);
+    vpp_cfg_clear(&saved);
+    vpp_cfg_clear(&ops);
+    free(order);
+    return rv;
 }
 
-/* Write memory (save config) - saves VPP running config to file */
-#define CONFIG_FILE "/etc/vpp/klish-startup.conf"
-
 int vpp_write_memory(kcontext_t *context) {
-    FILE *fp;
+    char msg[160];
+    uint32_t gen;
+    int rv;
     
     kcontext_printf(context, "Building configuration...\n");
+    gen = vpp_save_begin();
+    rv = save_running(gen, msg, sizeof(msg));
+    vpp_save_end(gen, rv, msg);
+    kcontext_printf(context, rv == 0 ? "[OK]\n%s\n" : "%s\n", msg);
+    return rv;
+}
+
+/* The saver runs detached with its own connections to VPP, so the
+ * session can go on using its own meanwhile */
+static void background_save(uint32_t gen) {
+    char msg[160];
+    int rv;
+    
+    signal(SIGINT, SIG_IGN);
+    signal(SIGHUP, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+    vpp_api_disconnect();
+    vpp_cli_disconnect();
+    vpp_save_worker(gen, getpid());
+    rv = save_running(gen, msg, sizeof(msg));
+    vpp_save_end(gen, rv, msg);
+    _exit(rv == 0 ? 0 : 1);
+}
+
+int vpp_write_memory_background(kcontext_t *context) {
+    uint32_t gen;
+    pid_t child;
     
-    fp = fopen(CONFIG_FILE, "w");
-    if (!fp) {
-        kcontext_printf(context, "Error: Cannot write to %s: %s\n", CONFIG_FILE, strerror(errno));
+    /* Without the shared status nobody would hear how it went */
+    if (!vpp_save_shared())
+        return vpp_write_memory(context);
+    
+    gen = vpp_save_begin();
+    child = fork();
+    if (child < 0) {
+        vpp_save_end(gen, -1, "Error: Cannot start background save");
+        kcontext_printf(context, "Error: Cannot start background save: %s\n", strerror(errno));
         return -1;
     }
-    
-    fprintf(fp, "# VPP Klish Configuration - Auto-generated\n");
-    fprintf(fp, "# Generated at startup\n\n");
-    
-    /* First: Create loopback interfaces */
-    fprintf(fp, "# Loopback interfaces\n");
-    const char *iface_list = vpp_exec_cli("show interface");
-    char iface_buf[BUFFER_SIZE];
-    strncpy(iface_buf, iface_list, BUFFER_SIZE - 1);
-    iface_buf[BUFFER_SIZE - 1] = 0;
-    
-    int loop_count = 0;
-    char *iline = strtok(iface_buf, "\n");
-    while (iline) {
-        if (iline[0] != ' ' && strncmp(iline, "loop", 4) == 0) {
-            char name[64];
-            if (sscanf(iline, "%63s", name) == 1) {
-                /* Extract instance number from loop name (e.g., loop100 -> 100) */
-                int instance = 0;
-                if (sscanf(name, "loop%d", &instance) == 1) {
-                    fprintf(fp, "create loopback interface instance %d\n", instance);
-                } else {
-                    fprintf(fp, "create loopback interface\n");
-                }
-                loop_count++;
-            }
-        }
-        iline = strtok(NULL, "\n");
-    }
-    
-    /* Second: Create bond interfaces with correct mode and load-balance */
-    fprintf(fp, "\n# Bond interfaces\n");
-    const char *bond_details_info = vpp_exec_cli("show bond details\n");
-    char bond_det_info[BUFFER_SIZE];
-    strncpy(bond_det_info, bond_details_info, BUFFER_SIZE - 1);
-    bond_det_info[BUFFER_SIZE - 1] = 0;
-    
-    /* Parse each bond interface */
-    char *save_ptr = NULL;
-    char *det_line = strtok_r(bond_det_info, "\n", &save_ptr);
-    char curr_mode[32] = "lacp";
-    char curr_lb[16] = "l34";
-    
-    while (det_line) {
-        if (strncmp(det_line, "BondEthernet", 12) == 0) {
-            /* New bond interface - if we had a previous one with mode/lb, write it */
-        } else if (strstr(det_line, "mode:")) {
-            sscanf(det_line, "  mode: %31s", curr_mode);
-        } else if (strstr(det_line, "load balance:")) {
-            sscanf(det_line, "  load balance: %15s", curr_lb);
-            /* Write the create command for this bond */
-            fprintf(fp, "create bond mode %s load-balance %s\n", curr_mode, curr_lb);
-        }
-        det_line = strtok_r(NULL, "\n", &save_ptr);
-    }
-    
-    /* Save bond members */
-    fprintf(fp, "\n# Bond members\n");
-    const char *bond_details = vpp_exec_cli("show bond details");
-    char bond_det_buf[BUFFER_SIZE];
-    strncpy(bond_det_buf, bond_details, BUFFER_SIZE - 1);
-    bond_det_buf[BUFFER_SIZE - 1] = 0;
-    
-    char current_bond[64] = {0};
-    char *dline = strtok(bond_det_buf, "\n");
-    while (dline) {
-        if (strncmp(dline, "BondEthernet", 12) == 0) {
-            sscanf(dline, "%63s", current_bond);
-        } else if (strlen(dline) > 4 && dline[0] == ' ' && dline[1] == ' ' &&
-                   dline[2] == ' ' && dline[3] == ' ' &&
-                   (strncmp(dline + 4, "Hundred", 7) == 0 ||
-                    strncmp(dline + 4, "Ten", 3) == 0 ||
-                    strncmp(dline + 4, "Forty", 5) == 0 ||
-                    strncmp(dline + 4, "Gigabit", 7) == 0 ||
-                    strncmp(dline + 4, "Ethernet", 8) == 0)) {
-            char member[64] = {0};
-            sscanf(dline + 4, "%63s", member);
-            if (current_bond[0] && member[0]) {
-                fprintf(fp, "bond add %s %s\n", current_bond, member);
-            }
-        }
-        dline = strtok(NULL, "\n");
-    }
-
-    
-    /* Third: Create VLAN subinterfaces */
-    fprintf(fp, "\n# VLAN subinterfaces\n");
-    const char *sub_list = vpp_exec_cli("show interface");
-    char sub_buf[BUFFER_SIZE];
-    strncpy(sub_buf, sub_list, BUFFER_SIZE - 1);
-    sub_buf[BUFFER_SIZE - 1] = 0;
-    
-    char *sline = strtok(sub_buf, "\n");
-    while (sline) {
-        if (sline[0] != ' ') {
-            char name[64] = {0};
-            if (sscanf(sline, "%63s", name) == 1) {
-                /* Check if it's a subinterface (contains dot) and not tap */
-                char *dot = strchr(name, '.');
-                if (dot && strncmp(name, "tap", 3) != 0) {
-                    char parent[64] = {0};
-                    int vlan_id = 0;
-                    size_t plen = dot - name;
-                    if (plen >= sizeof(parent)) plen = sizeof(parent) - 1;
-                    strncpy(parent, name, plen);
-                    vlan_id = atoi(dot + 1);
-                    if (vlan_id > 0 && vlan_id < 4096) {
-                        fprintf(fp, "create sub %s %d\n", parent, vlan_id);
-                    }
-                }
-            }
-        }
-        sline = strtok(NULL, "\n");
+    if (child == 0) {
+        /* Detach, so the save outlives this session */
+        setsid();
+        if (fork() == 0)
+            background_save(gen);
+        _exit(0);
     }
-    
-    fprintf(fp, "\n# Interface configuration\n");
-    
-    /* Get and save interface addresses */
-    const char *addrs = vpp_exec_cli("show interface addr");
-    char addr_buf[BUFFER_SIZE];
-    strncpy(addr_buf, addrs, BUFFER_SIZE - 1);
-    addr_buf[BUFFER_SIZE - 1] = 0;
-    
-    char *line = strtok(addr_buf, "\n");
-    char current_iface[64] = {0};
-    int skip_iface = 0;
-    while (line) {
-        if (line[0] != ' ' && strchr(line, '(')) {
-            /* Interface line: "loop0 (up):" */
-            sscanf(line, "%63s", current_iface);
-            
-            /* Skip tap interfaces (auto-created by LCP) and system interfaces */
-            skip_iface = (strncmp(current_iface, "tap", 3) == 0 ||
-                         strcmp(current_iface, "local0") == 0 ||
-                         strcmp(current_iface, "drops") == 0 ||
-                         strcmp(current_iface, "ip6") == 0);
-            
-            /* Save state only for non-skipped interfaces that are up */
-            if (!skip_iface && strstr(line, "(up)") && current_iface[0]) {
-                fprintf(fp, "set interface state %s up\n", current_iface);
-            }
-        } else if (strstr(line, "L3 ") && current_iface[0] && !skip_iface) {
-            /* IP line: "  L3 192.168.1.1/24" - only for non-skipped interfaces */
-            char *ip_start = strstr(line, "L3 ");
-            if (ip_start) {
-                ip_start += 3;
-                char ip[48] = {0};
-                sscanf(ip_start, "%47s", ip);
-                fprintf(fp, "set interface ip address %s %s\n", current_iface, ip);
-            }
-        }
-        line = strtok(NULL, "\n");
+    waitpid(child, NULL, 0);
+    kcontext_printf(context, "Saving configuration in the background (generation %u)\n", gen);
+    return 0;
+}
+
+static void format_time(uint64_t ms, char *buf, size_t size) {
+    time_t t = (time_t)(ms / 1000);
+    struct tm tm;
+    strftime(buf, size, "%Y-%m-%d %H:%M:%S", localtime_r(&t, &tm));
+}
+
+int vpp_show_write_memory_status(kcontext_t *context) {
+    vpp_save_status_t st;
+    char when[32];
+    
+    vpp_save_status(&st);
+    if (st.requested == 0) {
+        kcontext_printf(context, "No configuration saved since klishd started\n");
+        return 0;
+    }
+    kcontext_printf(context, "Generation            : %u requested, %u written\n",
+                    st.requested, st.committed);
+    if (st.last < st.requested) {
+        format_time(st.started_ms, when, sizeof(when));
+        if (st.worker && (kill(st.worker, 0) == 0 || errno == EPERM))
+            kcontext_printf(context, "In progress           : generation %u, pid %d, started %s (%.1f s)\n",
+                            st.requested, (int)st.worker, when,
+                            (double)(vpp_save_now_ms() - st.started_ms) / 1000.0);
+        else
+            kcontext_printf(context, "Abandoned             : generation %u, started %s\n",
+                            st.requested, when);
+    }
+    if (st.last) {
+        format_time(st.last_finished_ms, when, sizeof(when));
+        kcontext_printf(context, "Last finished         : generation %u at %s", st.last, when);
+        if (st.last_started_ms)
+            kcontext_printf(context, " (%.2f s)",
+                            (double)(st.last_finished_ms - st.last_started_ms) / 1000.0);
+        kcontext_printf(context, "\nResult                : %s%s\n",
+                        st.last_rv == 0 ? "" : "failed: ", st.last_msg);
     }
+    return 0;
+}
+
+/* Save the running configuration under a name, for rollback */
+int vpp_checkpoint(kcontext_t *context) {
+    const char *name = get_param(context, "name");
+    vpp_cfg_ops_t ops = { NULL, 0, 0 };
+    const vpp_rc_t *rc;
+    size_t *order;
+    char path[256];
+    int rv;
     
-    fprintf(fp, "\n");
+    if (checkpoint_path(context, name, path, sizeof(path)) < 0)
+        return -1;
+    if (mkdir(CHECKPOINT_DIR, 0755) < 0 && errno != EEXIST) {
+        kcontext_printf(context, "Error: Cannot create %s: %s\n", CHECKPOINT_DIR, strerror(errno));
+        return -1;
+    }
+    if (running_ops(context, 1, &ops, &rc, &order) < 0)
+        return -1;
+    rv = write_config(context, path, &ops, order);
+    if (rv == 0)
+        kcontext_printf(context, "Checkpoint %s saved (%zu command(s))\n", name, ops.count);
+    free(order);
+    vpp_cfg_clear(&ops);
+    return rv;
+}
+
+int vpp_show_checkpoints(kcontext_t *context) {
+    DIR *dir = opendir(CHECKPOINT_DIR);
+    struct dirent *de;
     
-    /* Get and save LCP configs */
-    const char *lcp = vpp_exec_cli("show lcp");
-    char lcp_buf[BUFFER_SIZE];
-    strncpy(lcp_buf, lcp, BUFFER_SIZE - 1);
-    lcp_buf[BUFFER_SIZE - 1] = 0;
+    if (!dir) {
+        kcontext_printf(context, "No checkpoints\n");
+        return 0;
+    }
+    kcontext_printf(context, "%-24s %s\n", "Checkpoint", "Saved");
+    while ((de = readdir(dir)) != NULL) {
+        size_t len = strlen(de->d_name);
+        char path[512], when[32];
+        struct stat st;
+        
+        if (len <= 5 || strcmp(de->d_name + len - 5, ".conf") != 0)
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", CHECKPOINT_DIR, de->d_name);
+        if (stat(path, &st) < 0)
+            continue;
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&st.st_mtime));
+        kcontext_printf(context, "%-24.*s %s\n", (int)(len - 5), de->d_name, when);
+    }
+    closedir(dir);
+    return 0;
+}
+
+/* Show what the running configuration changes relative to the saved one,
+ * or to a checkpoint */
+int vpp_show_configuration_diff(kcontext_t *context) {
+    const char *name = get_param(context, "checkpoint");
+    vpp_cfg_ops_t ops = { NULL, 0, 0 }, saved = { NULL, 0, 0 };
+    vpp_cfg_diff_t diff = { NULL, 0 };
+    const char *path = CONFIG_FILE;
+    char buf[256];
+    const vpp_rc_t *rc;
+    size_t *order = NULL;
+    int section = -1, rv = -1;
     
-    line = strtok(lcp_buf, "\n");
-    while (line) {
-        /* Parse: "itf-pair: [0] BondEthernet0 tap4096 bond0 2 type tap netns dataplane" */
-        if (strstr(line, "itf-pair:")) {
-            int idx;
-            char vpp_if[64], tap_if[64], host_if[32];
-            if (sscanf(line, "itf-pair: [%d] %63s %63s %31s", &idx, vpp_if, tap_if, host_if) >= 4) {
-                fprintf(fp, "lcp create %s host-if %s\n", vpp_if, host_if);
-            }
+    if (name) {
+        if (checkpoint_path(context, name, buf, sizeof(buf)) < 0)
+            return -1;
+        path = buf;
+    }
+    if (read_config(context, path, &saved) < 0)
+        goto out;
+    if (running_ops(context, 0, &ops, &rc, &order) < 0)
+        goto out;
+    if (vpp_cfg_diff(&saved, &ops, &diff) < 0) {
+        kcontext_printf(context, "Error: Out of memory\n");
+        goto out;
+    }
+    
+    if (diff.count == 0) {
+        kcontext_printf(context, "No differences from %s\n", path);
+        rv = 0;
+        goto out;
+    }
+    kcontext_printf(context, "--- %s\n+++ running-config\n", path);
+    for (size_t i = 0; i < diff.count; i++) {
+        const vpp_cfg_delta_t *d = &diff.items[i];
+        int s = (d->to ? d->to : d->from)->section;
+        if (s != section) {
+            section = s;
+            kcontext_printf(context, "! %s\n", vpp_cfg_section_name(s));
         }
-        line = strtok(NULL, "\n");
-    }
+        if (d->from)
+            kcontext_printf(context, "- %s\n", d->from->cmd);
+        if (d->to)
+            kcontext_printf(context, "+ %s\n", d->to->cmd);
+    }
+    kcontext_printf(context, "%zu difference(s)\n", diff.count);
+    rv = 0;
+out:
+    vpp_cfg_diff_free(&diff);
+    vpp_cfg_clear(&saved);
+    vpp_cfg_clear(&ops);
+    free(order);
+    return rv;
+}
+
+/* Make the running configuration match the one saved in @path, changing
+ * only what differs */
+static int replace_config(kcontext_t *context, const char *path) {
+    vpp_cfg_ops_t target = { NULL, 0, 0 }, running = { NULL, 0, 0 };
+    vpp_cfg_ops_t undo = { NULL, 0, 0 }, redo = { NULL, 0, 0 };
+    struct timespec started, done;
+    const vpp_rc_t *rc;
+    size_t *order = NULL;
+    int rv = -1, failed;
+    
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    if (read_config(context, path, &target) < 0) {
+        kcontext_printf(context, "Replace aborted: nothing was applied\n");
+        goto out;
+    }
+    if (running_ops(context, 1, &running, &rc, &order) < 0)
+        goto out;
+    if (vpp_cfg_delta(&running, &target, &undo, &redo) < 0) {
+        kcontext_printf(context, "Error: Out of memory\n");
+        goto out;
+    }
+    if (undo.count == 0 && redo.count == 0) {
+        kcontext_printf(context, "Running configuration already matches %s\n", path);
+        rv = 0;
+        goto out;
+    }
+    
+    kcontext_printf(context, "Applying %s: %zu to remove, %zu to add or change\n",
+                    path, undo.count, redo.count);
+    failed = vpp_cfg_push(&undo, NULL, print_op_error, context);
+    if (failed >= 0) {
+        int more = vpp_cfg_push(&redo, NULL, print_op_error, context);
+        failed = more < 0 ? more : failed + more;
+    }
+    vpp_ift_invalidate();
+    if (failed < 0) {
+        kcontext_printf(context, "Error: Connection to VPP lost during replace\n");
+        goto out;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &done);
+    kcontext_printf(context, "%s in %.3f s", failed ? "Replaced with errors" : "Replaced",
+                    (double)(done.tv_sec - started.tv_sec) +
+                    (double)(done.tv_nsec - started.tv_nsec) / 1e9);
+    if (failed)
+        kcontext_printf(context, "; %d of %zu change(s) failed", failed, undo.count + redo.count);
+    kcontext_printf(context, "\n");
+    rv = failed ? -1 : 0;
+out:
+    vpp_cfg_clear(&target);
+    vpp_cfg_clear(&running);
+    vpp_cfg_clear(&undo);
+    vpp_cfg_clear(&redo);
+    free(order);
+    return rv;
+}
+
+/* Roll the running configuration back to a checkpoint */
+int vpp_rollback(kcontext_t *context) {
+    char path[256];
     
-    fclose(fp);
-    kcontext_printf(context, "[OK]\n");
-    kcontext_printf(context, "Configuration saved to %s\n", CONFIG_FILE);
-    return 0;
+    if (checkpoint_path(context, get_param(context, "name"), path, sizeof(path)) < 0)
+        return -1;
+    return replace_config(context, path);
+}
+
+/* Make the running configuration what write-memory last saved */
+int vpp_configure_replace(kcontext_t *context) {
+    return replace_config(context, CONFIG_FILE);
+}
+
+/* Restore the saved configuration onto what VPP has now. Whatever VPP
+ * already has is skipped; the rest is pushed in dependency order, one
+ * pipelined batch per section. */
+int vpp_load_startup_config(kcontext_t *context) {
+    vpp_cfg_ops_t ops = { NULL, 0, 0 };
+    vpp_cfg_stats_t stats[VPP_CFG_SECTIONS];
+    struct timespec started, done;
+    const vpp_ift_t *t;
+    int rv = -1;
+    size_t skipped;
+    
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    if (read_config(context, CONFIG_FILE, &ops) < 0) {
+        kcontext_printf(context, "Load aborted: nothing was applied\n");
+        goto out;
+    }
+    
+    vpp_ift_invalidate();
+    t = vpp_ift_get(VPP_IFT_FULL);
+    if (!t) {
+        kcontext_printf(context, "Error: Cannot reach VPP (is it running?)\n");
+        goto out;
+    }
+    skipped = vpp_cfg_prune(&ops, t);
+    if (vpp_cfg_validate(&ops, t, print_op_error, context) != 0) {
+        kcontext_printf(context, "Load aborted: nothing was applied\n");
+        goto out;
+    }
+    
+    kcontext_printf(context, "Loading %s: %zu change(s), %zu already in effect\n",
+                    CONFIG_FILE, ops.count, skipped);
+    rv = vpp_cfg_push(&ops, stats, print_op_error, context);
+    vpp_ift_invalidate();
+    if (rv < 0) {
+        kcontext_printf(context, "Error: Connection to VPP lost during load\n");
+        rv = -1;
+        goto out;
+    }
+    
+    kcontext_printf(context, "%-16s %8s %8s %10s\n", "Section", "Applied", "Failed", "Time (ms)");
+    for (int s = 0; s < VPP_CFG_SECTIONS; s++) {
+        if (stats[s].ops == 0)
+            continue;
+        kcontext_printf(context, "%-16s %8zu %8zu %10.1f\n", vpp_cfg_section_name(s),
+                        stats[s].ops - stats[s].failed, stats[s].failed, stats[s].usec / 1000.0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &done);
+    kcontext_printf(context, "%s in %.3f s\n", rv ? "Loaded with errors" : "Loaded",
+                    (double)(done.tv_sec - started.tv_sec) +
+                    (double)(done.tv_nsec - started.tv_nsec) / 1e9);
+    rv = rv ? -1 : 0;
+out:
+    vpp_cfg_clear(&ops);
+    return rv;
 }
 
 /* Create LCP (Linux Control Plane) interface */
@@ -1277,8 +2710,21 @@ int vpp_lcp_create(kcontext_t *context) {
         return -1;
     }
     
+    uint32_t sw_if_index;
+    int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_lcp_add_del(sw_if_index, hostif, 1);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "LCP created: %s -> %s\n", iface, hostif);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     snprintf(cmd, sizeof(cmd), "lcp create %s host-if %s\n", iface, hostif);
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strstr(result, "unknown input") != NULL) {
         kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
         kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
@@ -1301,8 +2747,21 @@ int vpp_lcp_delete(kcontext_t *context) {
         return -1;
     }
     
+    uint32_t sw_if_index;
+    int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_lcp_add_del(sw_if_index, NULL, 0);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "LCP deleted: %s\n", iface);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     snprintf(cmd, sizeof(cmd), "lcp delete %s\n", iface);
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strstr(result, "unknown input") != NULL) {
         kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
         kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
@@ -1317,9 +2776,7 @@ int vpp_lcp_delete(kcontext_t *context) {
 
 /* Show LCP interfaces */
 int vpp_show_lcp(kcontext_t *context) {
-    const char *result = vpp_exec_cli("show lcp\n");
-    kcontext_printf(context, "%s", result);
-    return 0;
+    return vpp_show_cli(context, "show lcp");
 }
 
 /* Create VLAN subinterface */
@@ -1336,6 +2793,7 @@ int vpp_create_subinterface(kcontext_t *context) {
     
     snprintf(cmd, sizeof(cmd), "create sub %s %s dot1q %s exact-match\n", iface, subid, vlanid);
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strstr(result, "unknown input") != NULL) {
         kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
         kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
@@ -1358,8 +2816,21 @@ int vpp_delete_subinterface(kcontext_t *context) {
         return -1;
     }
     
+    uint32_t sw_if_index;
+    int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_delete_subif(sw_if_index);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "Subinterface deleted: %s\n", iface);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     snprintf(cmd, sizeof(cmd), "delete sub %s", iface);
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strstr(result, "unknown input") != NULL) {
         kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
         kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
@@ -1388,8 +2859,21 @@ int vpp_delete_loopback(kcontext_t *context) {
         return -1;
     }
     
+    uint32_t sw_if_index;
+    int rv = vpp_api_iface_lookup(iface, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_delete_loopback(sw_if_index);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "Loopback deleted: %s\n", iface);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     snprintf(cmd, sizeof(cmd), "delete loopback interface intfc %s", iface);
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strstr(result, "unknown input") != NULL) {
         kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
         kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
@@ -1412,7 +2896,38 @@ int vpp_no_interface(kcontext_t *context) {
         return -1;
     }
     
+    if (candidate_mode) {
+        if (strncmp(iface, "loop", 4) == 0)
+            return stage(context, VPP_CFG_DELETE, iface, "delete loopback interface intfc %s", iface);
+        if (strchr(iface, '.') != NULL)
+            return stage(context, VPP_CFG_DELETE, iface, "delete sub %s", iface);
+        if (strncmp(iface, "BondEthernet", 12) == 0)
+            return stage(context, VPP_CFG_DELETE, iface, "delete bond %s", iface);
+        kcontext_printf(context, "Error: Cannot delete %s - only loopback, bond, and VLAN can be deleted\n", iface);
+        return -1;
+    }
+    
     /* Determine interface type and delete accordingly */
+    uint32_t sw_if_index;
+    int rv = VPP_API_FALLBACK;
+    if (strncmp(iface, "loop", 4) == 0 || strchr(iface, '.') != NULL ||
+        strncmp(iface, "BondEthernet", 12) == 0) {
+        rv = vpp_api_iface_lookup(iface, &sw_if_index);
+        if (rv == 0 && strncmp(iface, "loop", 4) == 0)
+            rv = vpp_api_delete_loopback(sw_if_index);
+        else if (rv == 0 && strchr(iface, '.') != NULL)
+            rv = vpp_api_delete_subif(sw_if_index);
+        else if (rv == 0)
+            rv = vpp_api_bond_delete(sw_if_index);
+        vpp_ift_invalidate();
+    }
+    if (rv == 0) {
+        kcontext_printf(context, "Interface deleted: %s\n", iface);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     if (strncmp(iface, "loop", 4) == 0) {
         /* Loopback interface */
         snprintf(cmd, sizeof(cmd), "delete loopback interface intfc %s", iface);
@@ -1428,6 +2943,7 @@ int vpp_no_interface(kcontext_t *context) {
     }
     
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strstr(result, "unknown input") != NULL) {
         kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
         kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
@@ -1439,32 +2955,130 @@ int vpp_no_interface(kcontext_t *context) {
     }
     return 0;
 }
+/* Enter config mode; changes apply immediately unless some are staged */
+int vpp_configure(kcontext_t *context) {
+    if (candidate.count > 0) {
+        kcontext_printf(context, "%zu uncommitted change(s) pending; use commit or abort\n",
+                        candidate.count);
+        return 0;
+    }
+    candidate_mode = 0;
+    return 0;
+}
+
+/* Enter config mode, staging changes until commit */
+int vpp_configure_candidate(kcontext_t *context) {
+    candidate_mode = 1;
+    if (candidate.count > 0)
+        kcontext_printf(context, "%zu uncommitted change(s) pending\n", candidate.count);
+    return 0;
+}
+
+/* Show staged changes in the order commit applies them */
+int vpp_show_candidate(kcontext_t *context) {
+    size_t *order;
+    int section = -1;
+    
+    if (candidate.count == 0) {
+        kcontext_printf(context, "No uncommitted changes\n");
+        return 0;
+    }
+    order = malloc(candidate.count * sizeof(*order));
+    if (!order) {
+        kcontext_printf(context, "Error: Out of memory\n");
+        return -1;
+    }
+    vpp_cfg_order(&candidate, order);
+    for (size_t i = 0; i < candidate.count; i++) {
+        const vpp_cfg_op_t *op = &candidate.ops[order[i]];
+        if (op->section != section) {
+            section = op->section;
+            kcontext_printf(context, "! %s\n", vpp_cfg_section_name(section));
+        }
+        kcontext_printf(context, "%s\n", op->cmd);
+    }
+    free(order);
+    return 0;
+}
+
+/* Validate staged changes and push them to VPP in dependency order */
+int vpp_commit(kcontext_t *context) {
+    const vpp_ift_t *t;
+    size_t count = candidate.count;
+    int rv;
+    
+    if (count == 0) {
+        kcontext_printf(context, "No changes to commit\n");
+        return 0;
+    }
+    
+    t = vpp_ift_get(VPP_IFT_STATE);
+    if (!t) {
+        kcontext_printf(context, "Error: Cannot reach VPP (is it running?)\n");
+        return -1;
+    }
+    rv = vpp_cfg_validate(&candidate, t, print_op_error, context);
+    if (rv != 0) {
+        kcontext_printf(context, "Commit aborted: nothing was applied\n");
+        return -1;
+    }
+    
+    rv = vpp_cfg_push(&candidate, NULL, print_op_error, context);
+    vpp_ift_invalidate();
+    vpp_cfg_clear(&candidate);
+    if (rv < 0) {
+        kcontext_printf(context, "Error: Connection to VPP lost during commit\n");
+        return -1;
+    } else if (rv > 0) {
+        kcontext_printf(context, "Committed %zu of %zu change(s); %d failed\n",
+                        count - (size_t)rv, count, rv);
+        return -1;
+    }
+    kcontext_printf(context, "Committed %zu change(s)\n", count);
+    return 0;
+}
+
+/* Discard staged changes */
+int vpp_abort(kcontext_t *context) {
+    kcontext_printf(context, "Discarded %zu change(s)\n", candidate.count);
+    vpp_cfg_clear(&candidate);
+    return 0;
+}
+
 /* Tab completion for interface names */
 int vpp_complete_interface(kcontext_t *context) {
-    char iface_buf[BUFFER_SIZE];
-    
-    /* Get interface list from VPP */
-    const char *ifaces = vpp_exec_cli("show interface\n");
-    strncpy(iface_buf, ifaces, BUFFER_SIZE - 1);
-    iface_buf[BUFFER_SIZE - 1] = 0;
-    
-    /* Parse interface names and add to completion */
-    char *line = strtok(iface_buf, "\n");
-    while (line) {
-        /* Skip header and indented counter lines */
-        if (strstr(line, "Name") || line[0] == ' ' || strlen(line) < 3) {
-            line = strtok(NULL, "\n");
-            continue;
-        }
-        
-        /* Extract interface name (first word) */
-        char name[64] = {0};
-        if (sscanf(line, "%63s", name) == 1) {
-            /* Add to completion list */
+    const vpp_ift_t *t = vpp_ift_get(VPP_IFT_STATE);
+    const char *typed = kcontext_candidate_value(context);
+    char stem[64];
+    size_t first, count, common, end;
+    
+    if (!t)
+        return 0;
+    if (!typed)
+        typed = "";
+    count = vpp_ift_prefix(t, typed, strlen(typed), &first);
+    if (count <= COMPLETE_MAX) {
+        for (size_t i = first; i < first + count; i++)
+            kcontext_printf(context, "%s\n", vpp_ift_by_name(t, i)->name);
+        return 0;
+    }
+    
+    /* Too many to list: offer one character past their longest common
+     * prefix, like walking down a trie, so each Tab narrows the range */
+    common = vpp_ift_common_prefix(t, first, count);
+    memcpy(stem, vpp_ift_by_name(t, first)->name, common);
+    end = first + count;
+    while (first < end) {
+        const char *name = vpp_ift_by_name(t, first)->name;
+        if (!name[common]) {
             kcontext_printf(context, "%s\n", name);
+            first++;
+            continue;
         }
-        
-        line = strtok(NULL, "\n");
+        stem[common] = name[common];
+        count = vpp_ift_prefix(t, stem, common + 1, &first);
+        kcontext_printf(context, "%.*s\n", (int)(common + 1), stem);
+        first += count;
     }
     
     return 0;
@@ -1475,46 +3089,91 @@ int vpp_complete_interface(kcontext_t *context) {
 
 /* Show memory main-heap */
 int vpp_show_memory_heap(kcontext_t *context) {
-    const char *result = vpp_exec_cli("show memory main-heap\n");
-    kcontext_printf(context, "%s", result);
-    return 0;
+    return vpp_show_cli(context, "show memory main-heap");
 }
 
 /* Show memory map */
 int vpp_show_memory_map(kcontext_t *context) {
-    const char *result = vpp_exec_cli("show memory map\n");
-    kcontext_printf(context, "%s", result);
-    return 0;
+    return vpp_show_cli(context, "show memory map");
 }
 
 /* Show buffers */
 int vpp_show_buffers(kcontext_t *context) {
-    const char *result = vpp_exec_cli("show buffers\n");
-    kcontext_printf(context, "%s", result);
-    return 0;
+    return vpp_show_cli(context, "show buffers");
 }
 
 /* Show trace */
 int vpp_show_trace(kcontext_t *context) {
-    const char *result = vpp_exec_cli("show trace\n");
-    kcontext_printf(context, "%s", result);
-    return 0;
+    return vpp_show_cli(context, "show trace");
 }
 
 /* Show error */
 int vpp_show_error(kcontext_t *context) {
-    const char *result = vpp_exec_cli("show error\n");
-    kcontext_printf(context, "%s", result);
-    return 0;
+    return vpp_show_cli(context, "show error");
 }
 
 /* Show PCI devices */
 int vpp_show_pci(kcontext_t *context) {
-    const char *result = vpp_exec_cli("show pci\n");
-    kcontext_printf(context, "%s", result);
+    return vpp_show_cli(context, "show pci");
+}
+
+/* Output modifiers. klish runs them after "|" with the output of the
+ * command before on stdin, which is filtered as it is read. */
+static int filter_out(const char *data, size_t len, void *arg) {
+    kcontext_printf((kcontext_t *)arg, "%.*s", (int)len, data);
+    return 0;
+}
+
+static int run_filter(kcontext_t *context, int kind) {
+    const char *pattern = get_param(context, "pattern");
+    vpp_filter_t *f = malloc(sizeof(*f));
+    char buf[65536], err[128];
+    ssize_t n;
+    
+    if (!f) {
+        kcontext_printf(context, "Error: Out of memory\n");
+        return -1;
+    }
+    if (vpp_filter_init(f, kind, pattern, filter_out, context, err, sizeof(err)) < 0) {
+        kcontext_printf(context, "Error: Invalid pattern: %s\n", err);
+        free(f);
+        return -1;
+    }
+    while ((n = read(STDIN_FILENO, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (vpp_filter_feed(f, buf, (size_t)n))
+            break;
+    }
+    vpp_filter_finish(f);
+    vpp_filter_free(f);
+    free(f);
     return 0;
 }
 
+int vpp_filter_include(kcontext_t *context) {
+    return run_filter(context, VPP_FILTER_INCLUDE);
+}
+
+int vpp_filter_exclude(kcontext_t *context) {
+    return run_filter(context, VPP_FILTER_EXCLUDE);
+}
+
+int vpp_filter_begin(kcontext_t *context) {
+    return run_filter(context, VPP_FILTER_BEGIN);
+}
+
+int vpp_filter_section(kcontext_t *context) {
+    return run_filter(context, VPP_FILTER_SECTION);
+}
+
+int vpp_filter_count(kcontext_t *context) {
+    return run_filter(context, VPP_FILTER_COUNT);
+}
+
 
 /* Add member to current bond interface */
 int vpp_bond_add_member(kcontext_t *context) {
@@ -1538,6 +3197,28 @@ int vpp_bond_add_member(kcontext_t *context) {
         return -1;
     }
     
+    if (candidate_mode) {
+        if (!bond_interface_exists(bond) && !vpp_cfg_creates(&candidate, bond)) {
+            char mode[32] = "lacp";
+            char lb[16] = "l34";
+            int id = -1;
+            get_pending_bond_config(bond, mode, sizeof(mode), lb, sizeof(lb));
+            if (!mode[0]) strcpy(mode, "lacp");
+            if (!lb[0]) strcpy(lb, "l34");
+            if (sscanf(bond, "BondEthernet%d", &id) != 1) {
+                kcontext_printf(context, "Error: %s is not named BondEthernet<id>\n", bond);
+                return -1;
+            }
+            if (stage(context, VPP_CFG_CREATE, bond, "create bond mode %s load-balance %s id %d",
+                      mode, lb, id) < 0)
+                return -1;
+        }
+        return stage(context, VPP_CFG_MEMBER, member, "bond add %s %s", bond, member);
+    }
+    /* Whether the bond exists is read from a fresh table; the changes
+     * below bump the generation again once made */
+    vpp_ift_invalidate();
+    
     /* If bond doesn't exist, create it with pending config or defaults */
     if (!bond_interface_exists(bond)) {
         char mode[32] = "lacp";
@@ -1546,23 +3227,52 @@ int vpp_bond_add_member(kcontext_t *context) {
         if (!mode[0]) strcpy(mode, "lacp");
         if (!lb[0]) strcpy(lb, "l34");
         
-        snprintf(cmd, sizeof(cmd), "create bond mode %s load-balance %s\n", mode, lb);
-        const char *result = vpp_exec_cli(cmd);
-        if (strstr(result, "BondEthernet")) {
+        /* Ask for the instance named by the user, e.g. BondEthernet0 -> id 0 */
+        int id = -1;
+        sscanf(bond, "BondEthernet%d", &id);
+        int rv = vpp_api_bond_create(id, mode, lb, NULL);
+        vpp_ift_invalidate();
+        if (rv == 0) {
             kcontext_printf(context, "Created %s (mode: %s, load-balance: %s)\n", bond, mode, lb);
             clear_pending_bond_config(bond);
-        } else if (strstr(result, "unknown input") != NULL) {
-        kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
-        kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
-        return -1;
-    } else if (strlen(result) > 0) {
-            kcontext_printf(context, "Error creating bond: %s", result);
+        } else if (rv != VPP_API_FALLBACK) {
+            kcontext_printf(context, "Error creating bond: %s\n", vpp_api_strerror(rv));
+            return -1;
+        } else {
+            snprintf(cmd, sizeof(cmd), "create bond mode %s load-balance %s\n", mode, lb);
+            const char *result = vpp_exec_cli(cmd);
+            vpp_ift_invalidate();
+            if (strstr(result, "BondEthernet")) {
+                kcontext_printf(context, "Created %s (mode: %s, load-balance: %s)\n", bond, mode, lb);
+                clear_pending_bond_config(bond);
+            } else if (strstr(result, "unknown input") != NULL) {
+            kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
+            kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
             return -1;
+        } else if (strlen(result) > 0) {
+                kcontext_printf(context, "Error creating bond: %s", result);
+                return -1;
+            }
         }
     }
     
+    uint32_t bond_index, member_index;
+    int rv = vpp_api_iface_lookup(bond, &bond_index);
+    if (rv == 0)
+        rv = vpp_api_iface_lookup(member, &member_index);
+    if (rv == 0)
+        rv = vpp_api_bond_add_member(bond_index, member_index);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "Added %s to %s\n", member, bond);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     snprintf(cmd, sizeof(cmd), "bond add %s %s\n", bond, member);
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strstr(result, "unknown input") != NULL) {
         kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
         kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
@@ -1586,8 +3296,24 @@ int vpp_bond_del_member(kcontext_t *context) {
         return -1;
     }
     
+    if (candidate_mode)
+        return stage(context, VPP_CFG_MEMBER, member, "bond del %s", member);
+    
+    uint32_t sw_if_index;
+    int rv = vpp_api_iface_lookup(member, &sw_if_index);
+    if (rv == 0)
+        rv = vpp_api_bond_detach_member(sw_if_index);
+    vpp_ift_invalidate();
+    if (rv == 0) {
+        kcontext_printf(context, "Removed %s from bond\n", member);
+        return 0;
+    } else if (rv != VPP_API_FALLBACK) {
+        return api_error(context, rv);
+    }
+    
     snprintf(cmd, sizeof(cmd), "bond del %s\n", member);
     const char *result = vpp_exec_cli(cmd);
+    vpp_ift_invalidate();
     if (strstr(result, "unknown input") != NULL) {
         kcontext_printf(context, "Error: LCP plugin not available in VPP\n");
         kcontext_printf(context, "Install linux-cp plugin: apt install vpp-plugin-devtools\n");
@@ -1602,9 +3328,7 @@ int vpp_bond_del_member(kcontext_t *context) {
 
 /* Show bond details */
 int vpp_show_bond(kcontext_t *context) {
-    const char *result = vpp_exec_cli("show bond details\n");
-    kcontext_printf(context, "%s", result);
-    return 0;
+    return vpp_show_cli(context, "show bond details");
 }
 
 
@@ -1695,99 +3419,134 @@ int vpp_bond_set_load_balance(kcontext_t *context) {
 }
 
 
-/* Show system banner with device info */
+/* System resources */
+
+static void format_gib(char *buf, size_t size, uint64_t kb) {
+    snprintf(buf, size, "%.1fGi", kb / 1024.0 / 1024.0);
+}
+
+/* "3.2% now, 2.9% 1m, 3.0% 5m" for one group of cores */
+static void format_load(char *buf, size_t size, const vpp_sysinfo_t *si,
+                        const vpp_sysinfo_load_t *load) {
+    if (!si->span_ms[VPP_SYSINFO_NOW]) {
+        snprintf(buf, size, "N/A");
+        return;
+    }
+    snprintf(buf, size, "%.1f%% now, %.1f%% 1m, %.1f%% 5m (%u core%s)",
+             load->busy[VPP_SYSINFO_NOW], load->busy[VPP_SYSINFO_1MIN],
+             load->busy[VPP_SYSINFO_5MIN], load->cpus, load->cpus == 1 ? "" : "s");
+}
+
+static void window_label(char *buf, size_t size, unsigned int ms) {
+    if (ms && ms % 60000 == 0)
+        snprintf(buf, size, "%um", ms / 60000);
+    else if (ms && ms % 1000 == 0)
+        snprintf(buf, size, "%us", ms / 1000);
+    else
+        snprintf(buf, size, "%ums", ms);
+}
+
+static void print_load_row(kcontext_t *context, const char *label, const char *role,
+                           const char *thread, const double *busy, int valid) {
+    kcontext_printf(context, "%-16s %-8s %-12s", label, role, thread);
+    for (int w = 0; w < VPP_SYSINFO_WINDOWS; w++) {
+        if (valid)
+            kcontext_printf(context, " %7.1f%%", busy[w]);
+        else
+            kcontext_printf(context, " %8s", "-");
+    }
+    kcontext_printf(context, "\n");
+}
+
+/* show system resources: memory, hugepages and CPU load per core */
+int vpp_show_system_resources(kcontext_t *context) {
+    static vpp_sysinfo_cpus_t cpus;
+    vpp_sysinfo_t si;
+    char used[32], total[32], avail[32], label[VPP_SYSINFO_WINDOWS][16];
+    const unsigned int windows[VPP_SYSINFO_WINDOWS] = VPP_SYSINFO_WINDOW_MS;
+
+    vpp_sysinfo_get_cpus(&si, &cpus);
+    if (!si.sampled_ms) {
+        kcontext_printf(context, "Error: No system resource samples yet\n");
+        return -1;
+    }
+
+    format_gib(used, sizeof(used), si.mem_total_kb - si.mem_avail_kb);
+    format_gib(total, sizeof(total), si.mem_total_kb);
+    format_gib(avail, sizeof(avail), si.mem_avail_kb);
+    kcontext_printf(context, "Memory    : %s used / %s total, %s available\n", used, total, avail);
+    if (si.huge_total) {
+        format_gib(used, sizeof(used), (si.huge_total - si.huge_free) * si.huge_size_kb);
+        format_gib(total, sizeof(total), si.huge_total * si.huge_size_kb);
+        kcontext_printf(context, "Hugepages : %s used / %s total (%llu of %llu pages of %llu kB free)\n",
+                        used, total, (unsigned long long)si.huge_free,
+                        (unsigned long long)si.huge_total, (unsigned long long)si.huge_size_kb);
+    } else {
+        kcontext_printf(context, "Hugepages : none reserved\n");
+    }
+
+    for (int w = 0; w < VPP_SYSINFO_WINDOWS; w++)
+        window_label(label[w], sizeof(label[w]), w == VPP_SYSINFO_NOW ? si.interval_ms : windows[w]);
+    kcontext_printf(context, "\nCPU load, sampled every %s", label[VPP_SYSINFO_NOW]);
+    if (si.span_ms[VPP_SYSINFO_5MIN] + si.interval_ms / 2 < windows[VPP_SYSINFO_5MIN])
+        kcontext_printf(context, " (%us of history so far)", si.span_ms[VPP_SYSINFO_5MIN] / 1000);
+    kcontext_printf(context, "\n\n%-16s %-8s %-12s", "CPU", "Role", "VPP thread");
+    for (int w = 0; w < VPP_SYSINFO_WINDOWS; w++)
+        kcontext_printf(context, " %8s", label[w]);
+    kcontext_printf(context, "\n");
+
+    int valid = si.span_ms[VPP_SYSINFO_NOW] != 0;
+    char count[32];
+    snprintf(count, sizeof(count), "control (%u)", si.control.cpus);
+    print_load_row(context, count, "", "", si.control.busy, valid && si.control.cpus);
+    snprintf(count, sizeof(count), "workers (%u)", si.workers.cpus);
+    print_load_row(context, count, "", "", si.workers.busy, valid && si.workers.cpus);
+    for (unsigned int i = 0; i < cpus.count; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "cpu%u", cpus.cpu[i].id);
+        print_load_row(context, name, cpus.cpu[i].worker ? "worker" : "control",
+                       cpus.cpu[i].thread, cpus.cpu[i].busy, valid);
+    }
+    if (!si.workers.cpus)
+        kcontext_printf(context, "\nNo VPP worker threads found; all cores count as control plane.\n");
+    return 0;
+}
 
 /* Show system banner with device info */
 int vpp_show_banner(kcontext_t *context) {
-    char hostname[64] = {0};
-    char distro_name[64] = "Unknown Linux";
-    char kernel_ver[64] = "Unknown";
+    vpp_sysinfo_t si;
     char mem_used[32] = "N/A";
     char mem_total[32] = "N/A";
-    float cpu_usage = 0.0;
-    FILE *f;
-    
-    /* Get hostname */
-    gethostname(hostname, sizeof(hostname) - 1);
-    
-    /* Get Distro from /etc/os-release */
-    f = fopen("/etc/os-release", "r");
-    if (f) {
-        char line[256];
-        while (fgets(line, sizeof(line), f)) {
-            if (strncmp(line, "PRETTY_NAME=", 12) == 0) {
-                char *start = strchr(line, '"');
-                if (start) {
-                    start++;
-                    char *end = strchr(start, '"');
-                    if (end) *end = 0;
-                    strncpy(distro_name, start, sizeof(distro_name) - 1);
-                } else {
-                    /* PRETTY_NAME=Debian... (no quotes) */
-                     char *nl = strchr(line, '\n');
-                     if (nl) *nl = 0;
-                     strncpy(distro_name, line + 12, sizeof(distro_name) - 1);
-                }
-                break;
-            }
-        }
-        fclose(f);
-    }
+    char cpu_usage[96];
+    char worker_usage[96];
 
-    /* Get Kernel info using uname */
-    struct utsname uts;
-    if (uname(&uts) == 0) {
-        strncpy(kernel_ver, uts.release, sizeof(kernel_ver) - 1);
-    }
-    
-    /* Get memory info */
-    f = fopen("/proc/meminfo", "r");
-    if (f) {
-        unsigned long mem_total_kb = 0, mem_avail_kb = 0;
-        char line[256];
-        while (fgets(line, sizeof(line), f)) {
-            if (strncmp(line, "MemTotal:", 9) == 0) {
-                sscanf(line, "MemTotal: %lu", &mem_total_kb);
-            } else if (strncmp(line, "MemAvailable:", 13) == 0) {
-                sscanf(line, "MemAvailable: %lu", &mem_avail_kb);
-            }
-        }
-        fclose(f);
-        
-        if (mem_total_kb > 0) {
-            unsigned long mem_used_kb = mem_total_kb - mem_avail_kb;
-            snprintf(mem_used, sizeof(mem_used), "%.1fGi", mem_used_kb / 1024.0 / 1024.0);
-            snprintf(mem_total, sizeof(mem_total), "%.1fGi", mem_total_kb / 1024.0 / 1024.0);
-        }
-    }
-    
-    /* Get CPU usage from /proc/stat */
-    f = fopen("/proc/stat", "r");
-    if (f) {
-        char line[256];
-        if (fgets(line, sizeof(line), f)) {
-            unsigned long user, nice, system, idle, iowait, irq, softirq;
-            if (sscanf(line, "cpu %lu %lu %lu %lu %lu %lu %lu", 
-                       &user, &nice, &system, &idle, &iowait, &irq, &softirq) == 7) {
-                unsigned long total = user + nice + system + idle + iowait + irq + softirq;
-                unsigned long busy = user + nice + system + irq + softirq;
-                if (total > 0) {
-                    cpu_usage = (float)busy / total * 100.0;
-                }
-            }
-        }
-        fclose(f);
+    /* Sampled in the background; nothing is read from /proc here */
+    vpp_sysinfo_get(&si);
+    if (si.mem_total_kb > 0) {
+        format_gib(mem_used, sizeof(mem_used), si.mem_total_kb - si.mem_avail_kb);
+        format_gib(mem_total, sizeof(mem_total), si.mem_total_kb);
     }
+    /* VPP workers poll at 100% by design, so they are shown apart */
+    format_load(cpu_usage, sizeof(cpu_usage), &si, &si.control);
+    format_load(worker_usage, sizeof(worker_usage), &si, &si.workers);
     
     kcontext_printf(context, "\n");
     kcontext_printf(context, "========================================================================\n");
     kcontext_printf(context, "------------------------INFORMASI ROUTER--------------------------------\n");
     kcontext_printf(context, "========================================================================\n");
-    kcontext_printf(context, "Device Name             : %s\n", hostname);
-    kcontext_printf(context, "Distro                  : %s\n", distro_name);
-    kcontext_printf(context, "Kernel                  : %s\n", kernel_ver);
+    kcontext_printf(context, "Device Name             : %s\n", si.hostname);
+    kcontext_printf(context, "Distro                  : %s\n", si.distro);
+    kcontext_printf(context, "Kernel                  : %s\n", si.kernel);
     kcontext_printf(context, "Memory Usage            : %s used / %s total\n", mem_used, mem_total);
-    kcontext_printf(context, "CPU Usage               : %.1f%%\n", cpu_usage);
+    kcontext_printf(context, "CPU Usage               : %s\n", cpu_usage);
+    if (si.workers.cpus)
+        kcontext_printf(context, "VPP Worker Cores        : %s\n", worker_usage);
+    if (si.huge_total) {
+        char huge_used[32], huge_total[32];
+        format_gib(huge_used, sizeof(huge_used), (si.huge_total - si.huge_free) * si.huge_size_kb);
+        format_gib(huge_total, sizeof(huge_total), si.huge_total * si.huge_size_kb);
+        kcontext_printf(context, "Hugepages               : %s used / %s total\n", huge_used, huge_total);
+    }
     kcontext_printf(context, "========================================================================\n");
     kcontext_printf(context, "========================================================================\n");
     kcontext_printf(context, "\n");
@@ -1804,20 +3563,25 @@ int vpp_show_banner(kcontext_t *context) {
     return 0;
 }
 int vpp_prompt(kcontext_t *context) {
-    char flag_file[128];
-    snprintf(flag_file, sizeof(flag_file), "/tmp/klish_sess_%d.banner", (int)getppid());
-
-    if (access(flag_file, F_OK) != 0) {
+    /* The prompt is shown once the previous command is over */
+    vpp_arena_reset(&cmd_arena);
+    
+    if (vpp_session_first_prompt())
         vpp_show_banner(context);
-        FILE *fp = fopen(flag_file, "w");
-        if (fp) fclose(fp);
-    }
 
-    char hostname[64] = {0};
-    gethostname(hostname, sizeof(hostname) - 1);
-    kcontext_printf(context, "%s# ", hostname);
+    /* Drawn from the cached hostname, without a system call */
+    kcontext_printf(context, "%s# ", vpp_sysinfo_hostname());
     return 0;
 }
+/* Most handlers run synchronously in the klishd session process, so the
+ * VPP API connection and session state one command sets up are there for
+ * the next. klish only passes their output on once they return. */
+#define VPP_SYM(fn) ksym_new_ext(#fn, fn, KSYM_USERDEFINED_PERMANENT, KSYM_SYNC)
+/* Filters read their input from a pipe, and pass-through shows, ping and
+ * monitors stream their output as VPP produces it, so klish forks them.
+ * They keep no session state; each opens its own connection to VPP. */
+#define VPP_STREAM_SYM(fn) ksym_new_ext(#fn, fn, KSYM_USERDEFINED_PERMANENT, KSYM_UNSYNC)
+
 int kplugin_vpp_init(kcontext_t *context) {
     kplugin_t *plugin = NULL;
 
@@ -1827,54 +3591,121 @@ int kplugin_vpp_init(kcontext_t *context) {
     if (!plugin)
         return -1;
 
+    /* Optional settings from the PLUGIN tag, e.g. "InterfaceCacheTTL=500" */
+    int shared_cache = 1;
+    unsigned int sampler_interval = 0;
+    if (kplugin_conf(plugin)) {
+        faux_ini_t *ini = faux_ini_new();
+        faux_ini_parse_str(ini, kplugin_conf(plugin));
+        const char *ttl = faux_ini_find(ini, "InterfaceCacheTTL");
+        if (ttl)
+            vpp_ift_set_ttl((unsigned int)strtoul(ttl, NULL, 10));
+        const char *shared = faux_ini_find(ini, "InterfaceCacheShared");
+        if (shared && (strcmp(shared, "0") == 0 || strcasecmp(shared, "no") == 0))
+            shared_cache = 0;
+        const char *interval = faux_ini_find(ini, "SamplerInterval");
+        if (interval)
+            sampler_interval = (unsigned int)strtoul(interval, NULL, 10);
+        faux_ini_free(ini);
+    }
+    
+    /* Sessions fork from here and inherit the shared interface table */
+    if (shared_cache && vpp_ift_share_init() < 0)
+        fprintf(stderr, "Warning: Shared interface cache unavailable: %s\n", strerror(errno));
+
+    if (vpp_save_init() < 0)
+        fprintf(stderr, "Warning: Background write-memory unavailable: %s\n", strerror(errno));
+
+    if (vpp_sysinfo_init(sampler_interval) < 0)
+        fprintf(stderr, "Warning: System information sampler unavailable: %s\n", strerror(errno));
+
     /* Register symbols */
-    kplugin_add_syms(plugin, ksym_new("vpp_show_interfaces", vpp_show_interfaces));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_interface_detail", vpp_show_interface_detail));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_ip_interface_brief", vpp_show_ip_interface_brief));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_running_config", vpp_show_running_config));
-    kplugin_add_syms(plugin, ksym_new("vpp_config_interface_ip", vpp_config_interface_ip));
-    kplugin_add_syms(plugin, ksym_new("vpp_no_interface_ip", vpp_no_interface_ip));
-    kplugin_add_syms(plugin, ksym_new("vpp_config_interface_ipv6", vpp_config_interface_ipv6));
-    kplugin_add_syms(plugin, ksym_new("vpp_no_interface_ipv6", vpp_no_interface_ipv6));
-    kplugin_add_syms(plugin, ksym_new("vpp_interface_up", vpp_interface_up));
-    kplugin_add_syms(plugin, ksym_new("vpp_interface_down", vpp_interface_down));
-    kplugin_add_syms(plugin, ksym_new("vpp_enter_interface", vpp_enter_interface));
-    kplugin_add_syms(plugin, ksym_new("vpp_exit_interface", vpp_exit_interface));
-    kplugin_add_syms(plugin, ksym_new("vpp_set_mtu", vpp_set_mtu));
-    kplugin_add_syms(plugin, ksym_new("vpp_lcp_create_current", vpp_lcp_create_current));
-    kplugin_add_syms(plugin, ksym_new("vpp_lcp_delete_current", vpp_lcp_delete_current));
-    kplugin_add_syms(plugin, ksym_new("vpp_create_loopback", vpp_create_loopback));
-    kplugin_add_syms(plugin, ksym_new("vpp_create_tap", vpp_create_tap));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_version", vpp_show_version));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_ip_route", vpp_show_ip_route));
-    kplugin_add_syms(plugin, ksym_new("vpp_add_ip_route", vpp_add_ip_route));
-    kplugin_add_syms(plugin, ksym_new("vpp_del_ip_route", vpp_del_ip_route));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_hardware", vpp_show_hardware));
-    kplugin_add_syms(plugin, ksym_new("vpp_ping", vpp_ping));
-    kplugin_add_syms(plugin, ksym_new("vpp_write_memory", vpp_write_memory));
-    kplugin_add_syms(plugin, ksym_new("vpp_lcp_create", vpp_lcp_create));
-    kplugin_add_syms(plugin, ksym_new("vpp_lcp_delete", vpp_lcp_delete));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_lcp", vpp_show_lcp));
-    kplugin_add_syms(plugin, ksym_new("vpp_create_subinterface", vpp_create_subinterface));
-    kplugin_add_syms(plugin, ksym_new("vpp_delete_subinterface", vpp_delete_subinterface));
-    kplugin_add_syms(plugin, ksym_new("vpp_delete_loopback", vpp_delete_loopback));
-    kplugin_add_syms(plugin, ksym_new("vpp_no_interface", vpp_no_interface));
-    kplugin_add_syms(plugin, ksym_new("vpp_complete_interface", vpp_complete_interface));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_memory_heap", vpp_show_memory_heap));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_memory_map", vpp_show_memory_map));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_buffers", vpp_show_buffers));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_trace", vpp_show_trace));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_error", vpp_show_error));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_pci", vpp_show_pci));
-    kplugin_add_syms(plugin, ksym_new("vpp_bond_add_member", vpp_bond_add_member));
-    kplugin_add_syms(plugin, ksym_new("vpp_bond_del_member", vpp_bond_del_member));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_bond", vpp_show_bond));
-    kplugin_add_syms(plugin, ksym_new("vpp_bond_set_mode", vpp_bond_set_mode));
-    kplugin_add_syms(plugin, ksym_new("vpp_bond_set_load_balance", vpp_bond_set_load_balance));
-    kplugin_add_syms(plugin, ksym_new("vpp_show_banner", vpp_show_banner));
-    kplugin_add_syms(plugin, ksym_new("vpp_prompt", vpp_prompt));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_show_interfaces));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_show_interface_detail));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_show_interfaces_counters));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_monitor_interface));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_show_top_interfaces));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_show_top_errors));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_show_interface_events));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_show_ip_interface_brief));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_show_running_config));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_config_interface_ip));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_no_interface_ip));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_config_interface_ipv6));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_no_interface_ipv6));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_interface_up));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_interface_down));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_enter_interface));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_exit_interface));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_enter_interface_range));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_range_ip_address));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_range_no_ip_address));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_range_mtu));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_range_up));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_range_down));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_range_lcp));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_range_no_lcp));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_set_mtu));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_lcp_create_current));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_lcp_delete_current));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_create_loopback));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_create_tap));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_show_version));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_show_ip_route));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_show_ip_route_longer));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_show_ip_route_summary));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_add_ip_route));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_del_ip_route));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_import_ip_routes));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_delete_ip_routes));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_show_hardware));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_ping));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_write_memory));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_write_memory_background));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_show_write_memory_status));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_lcp_create));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_lcp_delete));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_show_lcp));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_create_subinterface));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_delete_subinterface));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_delete_loopback));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_no_interface));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_complete_interface));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_show_memory_heap));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_show_memory_map));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_show_buffers));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_show_trace));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_show_error));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_show_pci));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_filter_include));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_filter_exclude));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_filter_begin));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_filter_section));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_filter_count));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_bond_add_member));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_bond_del_member));
+    kplugin_add_syms(plugin, VPP_STREAM_SYM(vpp_show_bond));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_bond_set_mode));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_bond_set_load_balance));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_show_banner));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_show_system_resources));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_prompt));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_configure));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_configure_candidate));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_show_candidate));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_commit));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_abort));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_load_startup_config));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_show_configuration_diff));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_checkpoint));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_show_checkpoints));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_rollback));
+    kplugin_add_syms(plugin, VPP_SYM(vpp_configure_replace));
 
     /* Check if VPP is running */
+    if (access(VPP_API_SOCKET, F_OK) != 0) {
+        fprintf(stderr, "Warning: VPP API socket not found. Falling back to vppctl.\n");
+    }
     if (access(VPP_CLI_SOCKET, F_OK) != 0) {
         fprintf(stderr, "Warning: VPP CLI socket not found. VPP may not be running.\n");
     }
@@ -1884,9 +3715,15 @@ int kplugin_vpp_init(kcontext_t *context) {
 /* Plugin finalization */  
 int kplugin_vpp_fini(kcontext_t *context) {
     (void)context;
-    if (vpp_cli_fd >= 0) {
-        close(vpp_cli_fd);
-        vpp_cli_fd = -1;
-    }
+    vpp_ift_free();
+    vpp_rc_free();
+    vpp_arena_free(&cmd_arena);
+    vpp_cfg_clear(&candidate);
+    vpp_range_clear(&range);
+    vpp_session_free();
+    vpp_stats_ifaces_free(&if_stats);
+    vpp_stats_disconnect();
+    vpp_cli_disconnect();
+    vpp_api_disconnect();
     return 0;
 }
@@ -0,0 +1,209 @@
+/*
+ * Interface ranges for the Klish plugin
+ * A range is a comma list of items, each "<base><first>[-<last>]". An item
+ * starting with a digit reuses the base before it, so "Bond0.100-199,300"
+ * is two items on the same parent.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "vpp_range.h"
+
+typedef struct {
+    char base[64];
+    uint32_t first;
+    uint32_t last;
+} range_item_t;
+
+#define RANGE_ITEMS_MAX 64
+
+static int parse_num(const char *s, size_t len, uint32_t *value) {
+    uint64_t v = 0;
+
+    if (!len || len > 9)
+        return -1;
+    for (size_t i = 0; i < len; i++) {
+        if (!isdigit((unsigned char)s[i]))
+            return -1;
+        v = v * 10 + (uint64_t)(s[i] - '0');
+    }
+    *value = (uint32_t)v;
+    return 0;
+}
+
+/* Split "<base><first>[-<last>]"; the base is kept from @prev if omitted */
+static int parse_item(const char *s, size_t len, const char *prev, range_item_t *it) {
+    const char *dash = NULL;
+    size_t head, digits = 0;
+
+    for (size_t i = len; i > 0; i--) {
+        if (s[i - 1] == '-') {
+            dash = s + i - 1;
+            break;
+        }
+        if (!isdigit((unsigned char)s[i - 1]))
+            break;
+    }
+    head = dash ? (size_t)(dash - s) : len;
+    while (digits < head && isdigit((unsigned char)s[head - digits - 1]))
+        digits++;
+    if (!digits || parse_num(s + head - digits, digits, &it->first) < 0)
+        return -1;
+    it->last = it->first;
+    if (dash && parse_num(dash + 1, len - head - 1, &it->last) < 0)
+        return -1;
+    if (it->last < it->first)
+        return -1;
+
+    if (head == digits) {
+        if (!prev[0])
+            return -1;
+        snprintf(it->base, sizeof(it->base), "%s", prev);
+    } else if (head - digits < sizeof(it->base)) {
+        snprintf(it->base, sizeof(it->base), "%.*s", (int)(head - digits), s);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/* Fill @range from @spec; on failure @err says why and @range is empty */
+int vpp_range_parse(vpp_range_t *range, const char *spec, char *err, size_t err_size) {
+    range_item_t items[RANGE_ITEMS_MAX];
+    size_t n = 0, total = 0;
+    const char *p = spec;
+
+    vpp_range_clear(range);
+    if (strlen(spec) >= sizeof(range->spec)) {
+        snprintf(err, err_size, "range too long");
+        return -1;
+    }
+    while (*p) {
+        size_t len = strcspn(p, ",");
+
+        while (len && isspace((unsigned char)*p)) {
+            p++;
+            len--;
+        }
+        while (len && isspace((unsigned char)p[len - 1]))
+            len--;
+        if (n == RANGE_ITEMS_MAX) {
+            snprintf(err, err_size, "more than %d items", RANGE_ITEMS_MAX);
+            return -1;
+        }
+        if (parse_item(p, len, n ? items[n - 1].base : "", &items[n]) < 0) {
+            snprintf(err, err_size, "bad item '%.*s'", (int)len, p);
+            return -1;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (strcmp(items[i].base, items[n].base) == 0 &&
+                items[i].first <= items[n].last && items[n].first <= items[i].last) {
+                snprintf(err, err_size, "'%.*s' overlaps an earlier item", (int)len, p);
+                return -1;
+            }
+        }
+        total += items[n].last - items[n].first + 1;
+        if (total > VPP_RANGE_MAX) {
+            snprintf(err, err_size, "more than %d interfaces", VPP_RANGE_MAX);
+            return -1;
+        }
+        n++;
+        p += strcspn(p, ",");
+        if (*p)
+            p++;
+    }
+    if (!total) {
+        snprintf(err, err_size, "empty range");
+        return -1;
+    }
+
+    range->members = malloc(total * sizeof(*range->members));
+    if (!range->members) {
+        snprintf(err, err_size, "out of memory");
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (uint32_t id = items[i].first; ; id++) {
+            vpp_range_member_t *m = &range->members[range->count++];
+            m->id = id;
+            if (snprintf(m->name, sizeof(m->name), "%s%u", items[i].base, id) >= (int)sizeof(m->name)) {
+                snprintf(err, err_size, "name too long: %s%u", items[i].base, id);
+                vpp_range_clear(range);
+                return -1;
+            }
+            if (id == items[i].last)
+                break;
+        }
+    }
+    snprintf(range->spec, sizeof(range->spec), "%s", spec);
+    return 0;
+}
+
+/*
+ * Fill in @tmpl for member @i. "{n}" is the member's number and "{i}" its
+ * position in the range, from 0; either may be followed by operators
+ * applied left to right, e.g. "{n/256}" or "{i*4+1}".
+ */
+int vpp_range_expand(const char *tmpl, const vpp_range_t *range, size_t i,
+                     char *buf, size_t size) {
+    size_t len = 0;
+
+    for (const char *p = tmpl; *p; ) {
+        char num[24];
+        const char *chunk = p;
+        size_t n = 1;
+
+        if (*p == '{') {
+            long long v;
+            char *end;
+
+            p++;
+            if (*p == 'n')
+                v = range->members[i].id;
+            else if (*p == 'i')
+                v = (long long)i;
+            else
+                return -1;
+            p++;
+            while (*p && *p != '}') {
+                char op = *p++;
+                long long k = strtoll(p, &end, 10);
+
+                if (end == p || *p == '-' || *p == '+')
+                    return -1;
+                p = end;
+                if (op == '+')
+                    v += k;
+                else if (op == '-')
+                    v -= k;
+                else if (op == '*')
+                    v *= k;
+                else if ((op == '/' || op == '%') && k != 0)
+                    v = op == '/' ? v / k : v % k;
+                else
+                    return -1;
+            }
+            if (*p != '}')
+                return -1;
+            p++;
+            n = (size_t)snprintf(num, sizeof(num), "%lld", v);
+            chunk = num;
+        } else {
+            p++;
+        }
+        if (len + n >= size)
+            return -1;
+        memcpy(buf + len, chunk, n);
+        len += n;
+    }
+    buf[len] = 0;
+    return 0;
+}
+
+void vpp_range_clear(vpp_range_t *range) {
+    free(range->members);
+    memset(range, 0, sizeof(*range));
+}
@@ -0,0 +1,32 @@
+/*
+ * Interface ranges for the Klish plugin
+ * "BondEthernet0.100-199,300,loop1-4" names many interfaces at once; a
+ * member is its base name plus a number. Values given to a range may
+ * carry templates filled in per member, e.g. "10.{n/256}.{n%256}.1/24".
+ */
+
+#ifndef VPP_RANGE_H
+#define VPP_RANGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define VPP_RANGE_MAX 8192      /* Members of one range */
+
+typedef struct {
+    char name[64];
+    uint32_t id;                /* Trailing number, e.g. the VLAN id */
+} vpp_range_member_t;
+
+typedef struct {
+    char spec[256];
+    vpp_range_member_t *members;
+    size_t count;
+} vpp_range_t;
+
+int vpp_range_parse(vpp_range_t *range, const char *spec, char *err, size_t err_size);
+int vpp_range_expand(const char *tmpl, const vpp_range_t *range, size_t i,
+                     char *buf, size_t size);
+void vpp_range_clear(vpp_range_t *range);
+
+#endif /* VPP_RANGE_H */
@@ -0,0 +1,321 @@
+/*
+ * Static routes configured through the Klish plugin
+ * The record is a file of "ip route add" commands, one path per line.
+ * A change reads it, applies itself and replaces it whole, holding a lock
+ * throughout so that sessions recording at once keep each other's routes.
+ * Readers take no lock: the file is only ever replaced by a rename.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/file.h>
+
+#include "vpp_routes.h"
+#include "vpp_save.h"
+
+#define ROUTE_LINE_MAX 256
+
+/* AF_INET or AF_INET6, -1 if @s is not an address */
+static int parse_addr(const char *s, uint8_t addr[16]) {
+    if (inet_pton(AF_INET, s, addr) == 1)
+        return AF_INET;
+    if (inet_pton(AF_INET6, s, addr) == 1)
+        return AF_INET6;
+    return -1;
+}
+
+/* Fill @r in VPP's notation, so that a route reads the same however it
+ * was typed; 0, or -1 if it is not a valid route */
+int vpp_route_init(vpp_route_t *r, uint32_t table_id, const char *prefix,
+                   const char *via, const char *iface, uint8_t weight) {
+    const char *slash = prefix ? strchr(prefix, '/') : NULL;
+    char buf[INET6_ADDRSTRLEN];
+    uint8_t addr[16];
+    char *end;
+    long len;
+    int af, bits;
+
+    memset(r, 0, sizeof(*r));
+    if (!slash || (size_t)(slash - prefix) >= sizeof(buf))
+        return -1;
+    snprintf(buf, sizeof(buf), "%.*s", (int)(slash - prefix), prefix);
+    af = parse_addr(buf, addr);
+    bits = af == AF_INET ? 32 : 128;
+    len = strtol(slash + 1, &end, 10);
+    if (af < 0 || *end || end == slash + 1 || len < 0 || len > bits)
+        return -1;
+    /* VPP keeps the network, not the address as typed */
+    for (int bit = (int)len; bit < bits; bit++)
+        addr[bit / 8] &= (uint8_t)~(0x80 >> (bit % 8));
+    inet_ntop(af, addr, buf, sizeof(buf));
+    snprintf(r->prefix, sizeof(r->prefix), "%s/%ld", buf, len);
+
+    if (via && via[0]) {
+        if (parse_addr(via, addr) != af)
+            return -1;
+        inet_ntop(af, addr, r->via, sizeof(r->via));
+    }
+    if (iface && strlen(iface) >= sizeof(r->iface))
+        return -1;
+    snprintf(r->iface, sizeof(r->iface), "%s", iface ? iface : "");
+    r->table_id = table_id;
+    r->weight = weight ? weight : 1;
+    return 0;
+}
+
+/*
+ * Read "ip route add|del <prefix> [table <id>] [via <next-hop> [<interface>]
+ * [weight <1-255>]]", the form running-config shows. "via <interface>"
+ * is an attached route; a deletion without a path removes every path.
+ */
+int vpp_route_parse(vpp_sv_t cmd, vpp_route_t *r, int *is_add) {
+    char prefix[64] = "", via[64] = "", iface[64] = "";
+    uint32_t table = 0, weight = 1, n;
+    uint8_t addr[16];
+    vpp_sv_t f, value;
+    int in_path = 0;
+
+    if (!vpp_sv_field(&cmd, &f) || !vpp_sv_eq(f, "ip") ||
+        !vpp_sv_field(&cmd, &f) || !vpp_sv_eq(f, "route") || !vpp_sv_field(&cmd, &f))
+        return -1;
+    if (vpp_sv_eq(f, "add"))
+        *is_add = 1;
+    else if (vpp_sv_eq(f, "del"))
+        *is_add = 0;
+    else
+        return -1;
+
+    while (vpp_sv_field(&cmd, &f)) {
+        if (vpp_sv_eq(f, "table") || vpp_sv_eq(f, "weight")) {
+            if (!vpp_sv_field(&cmd, &value) || vpp_sv_u32(value, &n) < 0)
+                return -1;
+            if (vpp_sv_eq(f, "table"))
+                table = n;
+            else if (n >= 1 && n <= 255 && in_path)
+                weight = n;
+            else
+                return -1;
+        } else if (vpp_sv_eq(f, "via") && !in_path) {
+            if (!vpp_sv_field(&cmd, &value) || vpp_sv_copy(value, via, sizeof(via)) != value.len)
+                return -1;
+            in_path = 1;
+        } else if (!in_path && !prefix[0]) {
+            if (vpp_sv_copy(f, prefix, sizeof(prefix)) != f.len)
+                return -1;
+        } else if (in_path && !iface[0]) {
+            if (vpp_sv_copy(f, iface, sizeof(iface)) != f.len)
+                return -1;
+        } else {
+            return -1;
+        }
+    }
+    if (via[0] && parse_addr(via, addr) < 0) {
+        if (iface[0])
+            return -1;
+        memcpy(iface, via, sizeof(iface));
+        via[0] = 0;
+    }
+    return vpp_route_init(r, table, prefix, via, iface, (uint8_t)weight);
+}
+
+/* Arguments of "ip route add" for @r */
+int vpp_route_format(const vpp_route_t *r, char *buf, size_t size) {
+    int len = snprintf(buf, size, "%s", r->prefix);
+
+    if (r->table_id)
+        len += snprintf(buf + len, size - len, " table %u", r->table_id);
+    if (r->via[0] || r->iface[0])
+        len += snprintf(buf + len, size - len, " via%s%s%s%s", r->via[0] ? " " : "", r->via,
+                        r->iface[0] ? " " : "", r->iface);
+    if (r->weight > 1)
+        len += snprintf(buf + len, size - len, " weight %u", r->weight);
+    return len;
+}
+
+/* Recorded routes, in the order they were first added */
+int vpp_routes_load(vpp_route_t **routes, size_t *count) {
+    FILE *fp = fopen(VPP_ROUTES_FILE, "r");
+    vpp_route_t *list = NULL;
+    size_t n = 0, cap = 0;
+    char line[ROUTE_LINE_MAX];
+    int is_add;
+
+    *routes = NULL;
+    *count = 0;
+    if (!fp)
+        return errno == ENOENT ? 0 : -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (n == cap) {
+            size_t new_cap = cap ? cap * 2 : 64;
+            vpp_route_t *p = realloc(list, new_cap * sizeof(*list));
+            if (!p) {
+                free(list);
+                fclose(fp);
+                return -1;
+            }
+            list = p;
+            cap = new_cap;
+        }
+        size_t len = strcspn(line, "\r\n");
+        if (vpp_route_parse(vpp_sv(line, len), &list[n], &is_add) == 0 && is_add)
+            n++;
+    }
+    fclose(fp);
+    *routes = list;
+    *count = n;
+    return 0;
+}
+
+/* FNV-1a over the table and the prefix, and over the path too if @path */
+static uint64_t route_hash(const vpp_route_t *r, int path) {
+    const char *parts[3] = { r->prefix, r->via, r->iface };
+    uint64_t h = 14695981039346656037ULL ^ r->table_id;
+
+    h *= 1099511628211ULL;
+    for (int i = 0; i < (path ? 3 : 1); i++) {
+        for (const char *p = parts[i]; ; p++) {
+            h ^= (unsigned char)*p;
+            h *= 1099511628211ULL;
+            if (!*p)
+                break;
+        }
+    }
+    return h;
+}
+
+/* Same route, whatever the path */
+static int same_key(const vpp_route_t *a, const vpp_route_t *b) {
+    return a->table_id == b->table_id && strcmp(a->prefix, b->prefix) == 0;
+}
+
+/* Same path of the same route; the weight is not part of it */
+static int same_path(const vpp_route_t *a, const vpp_route_t *b) {
+    return same_key(a, b) && strcmp(a->via, b->via) == 0 && strcmp(a->iface, b->iface) == 0;
+}
+
+typedef struct {
+    vpp_route_t *routes;
+    char *dead;
+    size_t count;
+    size_t mask;
+    size_t *path_slot;          /* Index + 1 of each path */
+    size_t *key_slot;           /* Index + 1 of the last path of each route */
+    size_t *next;               /* Index + 1 of the path before, same route */
+} record_t;
+
+static size_t *find_path(record_t *rec, const vpp_route_t *r) {
+    size_t h = (size_t)route_hash(r, 1) & rec->mask;
+
+    while (rec->path_slot[h] && !same_path(&rec->routes[rec->path_slot[h] - 1], r))
+        h = (h + 1) & rec->mask;
+    return &rec->path_slot[h];
+}
+
+static size_t *find_key(record_t *rec, const vpp_route_t *r) {
+    size_t h = (size_t)route_hash(r, 0) & rec->mask;
+
+    while (rec->key_slot[h] && !same_key(&rec->routes[rec->key_slot[h] - 1], r))
+        h = (h + 1) & rec->mask;
+    return &rec->key_slot[h];
+}
+
+/* Index the path at @i, a new one */
+static void index_path(record_t *rec, size_t i) {
+    size_t *key = find_key(rec, &rec->routes[i]);
+
+    *find_path(rec, &rec->routes[i]) = i + 1;
+    rec->next[i] = *key;
+    *key = i + 1;
+}
+
+static int write_record(FILE *fp, void *arg) {
+    const record_t *rec = arg;
+    char buf[ROUTE_LINE_MAX];
+
+    for (size_t i = 0; i < rec->count; i++) {
+        if (rec->dead[i])
+            continue;
+        vpp_route_format(&rec->routes[i], buf, sizeof(buf));
+        fprintf(fp, "ip route add %s\n", buf);
+    }
+    return 0;
+}
+
+/* Note that VPP took @routes (deleted them unless @is_add); 0, or -1 if
+ * the record could not be updated. Callers pass a whole change at once:
+ * each call rewrites the record. */
+int vpp_routes_record(const vpp_route_t *routes, size_t count, int is_add) {
+    record_t rec = { NULL, NULL, 0, 63, NULL, NULL, NULL };
+    int lock, changed = 0, rv = -1;
+
+    if (count == 0)
+        return 0;
+    lock = open(VPP_ROUTES_FILE ".lock", O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lock < 0)
+        return -1;
+    flock(lock, LOCK_EX);
+    if (vpp_routes_load(&rec.routes, &rec.count) < 0)
+        goto out;
+
+    /* Room for every route to be new, and tables at most half full */
+    size_t room = rec.count + count;
+    vpp_route_t *grown = realloc(rec.routes, room * sizeof(*rec.routes));
+    if (grown)
+        rec.routes = grown;
+    while (rec.mask + 1 < 2 * room)
+        rec.mask = rec.mask * 2 + 1;
+    rec.path_slot = calloc(rec.mask + 1, sizeof(*rec.path_slot));
+    rec.key_slot = calloc(rec.mask + 1, sizeof(*rec.key_slot));
+    rec.next = malloc(room * sizeof(*rec.next));
+    rec.dead = calloc(room, 1);
+    if (!grown || !rec.path_slot || !rec.key_slot || !rec.next || !rec.dead)
+        goto out;
+    for (size_t i = 0; i < rec.count; i++)
+        index_path(&rec, i);
+
+    for (size_t i = 0; i < count; i++) {
+        const vpp_route_t *r = &routes[i];
+
+        if (!is_add && !r->via[0] && !r->iface[0]) {
+            /* Every path of the route */
+            for (size_t j = *find_key(&rec, r); j; j = rec.next[j - 1]) {
+                if (!rec.dead[j - 1])
+                    rec.dead[j - 1] = changed = 1;
+            }
+            continue;
+        }
+        size_t *slot = find_path(&rec, r);
+        if (*slot) {
+            size_t j = *slot - 1;
+            if (is_add && (rec.dead[j] || rec.routes[j].weight != r->weight)) {
+                rec.routes[j] = *r;
+                rec.dead[j] = 0;
+                changed = 1;
+            } else if (!is_add && !rec.dead[j]) {
+                rec.dead[j] = changed = 1;
+            }
+        } else if (is_add) {
+            rec.routes[rec.count] = *r;
+            index_path(&rec, rec.count++);
+            changed = 1;
+        }
+    }
+
+    rv = changed ? vpp_save_file(VPP_ROUTES_FILE, 0, write_record, &rec) : 0;
+out:
+    flock(lock, LOCK_UN);
+    close(lock);
+    free(rec.routes);
+    free(rec.dead);
+    free(rec.path_slot);
+    free(rec.key_slot);
+    free(rec.next);
+    return rv;
+}
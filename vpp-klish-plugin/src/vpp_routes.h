@@ -0,0 +1,37 @@
+/*
+ * Static routes configured through the Klish plugin
+ * VPP's FIB does not tell a configured route from one a routing daemon
+ * installed through the Linux control plane, so the plugin keeps its own
+ * record of the routes it has programmed.
+ */
+
+#ifndef VPP_ROUTES_H
+#define VPP_ROUTES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "vpp_text.h"
+
+/* Under /run: the record outlives klishd but not VPP's host */
+#ifndef VPP_ROUTES_FILE
+#define VPP_ROUTES_FILE "/run/klish-vpp-routes"
+#endif
+
+/* One next-hop path of a route */
+typedef struct {
+    uint32_t table_id;
+    char prefix[64];            /* As VPP prints it, host bits cleared */
+    char via[48];               /* Next-hop address, empty for an attached route */
+    char iface[64];             /* Next-hop interface, empty if VPP resolves it */
+    uint8_t weight;
+} vpp_route_t;
+
+int vpp_route_init(vpp_route_t *r, uint32_t table_id, const char *prefix,
+                   const char *via, const char *iface, uint8_t weight);
+int vpp_route_parse(vpp_sv_t cmd, vpp_route_t *r, int *is_add);
+int vpp_route_format(const vpp_route_t *r, char *buf, size_t size);
+int vpp_routes_record(const vpp_route_t *routes, size_t count, int is_add);
+int vpp_routes_load(vpp_route_t **routes, size_t *count);
+
+#endif /* VPP_ROUTES_H */
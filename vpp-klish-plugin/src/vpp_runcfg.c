@@ -0,0 +1,289 @@
+/*
+ * Running configuration model for the Klish plugin
+ * Interfaces, addresses, bonds and LCP pairs come from the interface
+ * table. Routes are those the plugin recorded programming, in any table,
+ * that "show ip fib" and "show ip6 fib" still list; routes from routing
+ * daemons are not configuration. The dumps hold every route VPP has, so
+ * they are matched as they stream, one line at a time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vpp_cli.h"
+#include "vpp_runcfg.h"
+#include "vpp_text.h"
+
+static struct {
+    vpp_rc_t rc;
+    size_t cap;
+    size_t addr_cap;
+} run;
+
+static int grow(void **array, size_t *cap, size_t need, size_t size) {
+    if (need <= *cap)
+        return 0;
+    size_t n = *cap ? *cap : 64;
+    while (n < need)
+        n *= 2;
+    void *p = realloc(*array, n * size);
+    if (!p)
+        return -1;
+    *array = p;
+    *cap = n;
+    return 0;
+}
+
+/* Interfaces VPP and LCP create on their own are not configuration */
+static int is_system_iface(const char *name) {
+    return strncmp(name, "tap", 3) == 0 || strcmp(name, "local0") == 0;
+}
+
+/* Digits only, e.g. the instance of "loop100" */
+static int parse_id(const char *s, uint32_t *id) {
+    if (!*s || strspn(s, "0123456789") != strlen(s))
+        return 0;
+    return vpp_sv_u32(vpp_sv(s, strlen(s)), id) == 0;
+}
+
+static void rc_classify(vpp_rc_iface_t *r, const vpp_ift_iface_t *row) {
+    const char *dot = strchr(row->name, '.');
+    uint32_t id;
+
+    r->kind = VPP_RC_PHYSICAL;
+    if (dot) {
+        if (parse_id(dot + 1, &id) && id > 0 && id < 4096) {
+            r->kind = VPP_RC_SUBIF;
+            r->id = id;
+            snprintf(r->parent, sizeof(r->parent), "%.*s", (int)(dot - row->name), row->name);
+        }
+    } else if (strncmp(row->name, "loop", 4) == 0 && parse_id(row->name + 4, &id)) {
+        r->kind = VPP_RC_LOOPBACK;
+        r->id = id;
+    } else if (row->bond_mode[0] && strncmp(row->name, "BondEthernet", 12) == 0 &&
+               parse_id(row->name + 12, &id)) {
+        r->kind = VPP_RC_BOND;
+        r->id = id;
+        snprintf(r->bond_mode, sizeof(r->bond_mode), "%s", row->bond_mode);
+        snprintf(r->bond_lb, sizeof(r->bond_lb), "%s", row->bond_lb[0] ? row->bond_lb : "l34");
+    }
+}
+
+static int rc_load_ifaces(const vpp_ift_t *t) {
+    if (grow((void **)&run.rc.ifaces, &run.cap, t->count, sizeof(vpp_rc_iface_t)) < 0 ||
+        grow((void **)&run.rc.addrs, &run.addr_cap, t->addr_count, sizeof(vpp_ift_addr_t)) < 0)
+        return -1;
+
+    for (size_t i = 0; i < t->count; i++) {
+        const vpp_ift_iface_t *row = &t->ifaces[i];
+        vpp_rc_iface_t *r;
+
+        if (is_system_iface(row->name))
+            continue;
+        r = &run.rc.ifaces[run.rc.count++];
+        memset(r, 0, sizeof(*r));
+        memcpy(r->name, row->name, sizeof(r->name));
+        rc_classify(r, row);
+        memcpy(r->bond, row->bond, sizeof(r->bond));
+        memcpy(r->lcp_host, row->lcp_host, sizeof(r->lcp_host));
+        r->admin_up = row->admin_up;
+        r->mtu = row->mtu;
+        r->addr_first = run.rc.addr_count;
+        r->addr_count = row->addr_count;
+        memcpy(&run.rc.addrs[run.rc.addr_count], &t->addrs[row->addr_first],
+               row->addr_count * sizeof(vpp_ift_addr_t));
+        run.rc.addr_count += row->addr_count;
+    }
+    return 0;
+}
+
+/* Recorded routes by table and prefix, marked as the FIB lists them */
+typedef struct {
+    size_t *slot;               /* First route with the key, + 1 */
+    size_t mask;
+    char *present;              /* Set on the first route of each key found */
+    uint32_t table;             /* Of the lines being read, ~0 before any */
+} fib_match_t;
+
+static size_t *key_slot(fib_match_t *m, uint32_t table_id, const char *prefix) {
+    uint64_t h = 14695981039346656037ULL ^ table_id;
+
+    h *= 1099511628211ULL;
+    for (const char *p = prefix; *p; p++) {
+        h ^= (unsigned char)*p;
+        h *= 1099511628211ULL;
+    }
+    for (size_t i = (size_t)h & m->mask; ; i = (i + 1) & m->mask) {
+        const vpp_route_t *r = m->slot[i] ? &run.rc.routes[m->slot[i] - 1] : NULL;
+        if (!r || (r->table_id == table_id && strcmp(r->prefix, prefix) == 0))
+            return &m->slot[i];
+    }
+}
+
+/*
+ * Entries of "show ip fib" start with their prefix, e.g.
+ *   172.16.0.0/12
+ *     unicast-ip4-chain
+ *     [@0]: dpo-load-balance: [proto:ip4 index:24 buckets:2 uRPF:25 to:[0:0]]
+ * under a "ipv4-VRF:<table>, fib_index:..." line per table.
+ */
+static int rc_match_fib(vpp_sv_t line, void *arg) {
+    fib_match_t *m = arg;
+    vpp_sv_t f, rest;
+    vpp_route_t key;
+    char prefix[64];
+
+    if (!line.len || line.p[0] == ' ' || !vpp_sv_field(&line, &f))
+        return 0;
+    if (vpp_sv_starts(f, "ipv4-VRF:") || vpp_sv_starts(f, "ipv6-VRF:")) {
+        vpp_sv_t id = vpp_sv(f.p + 9, f.len - 9);
+        if (id.len && id.p[id.len - 1] == ',')
+            id.len--;
+        if (vpp_sv_u32(id, &m->table) < 0)
+            m->table = ~0u;
+    } else if (m->table != ~0u && vpp_sv_find(f, "/", &rest) &&
+               vpp_sv_copy(f, prefix, sizeof(prefix)) == f.len &&
+               vpp_route_init(&key, m->table, prefix, NULL, NULL, 1) == 0) {
+        /* Compared in the record's notation, whatever VPP's is */
+        size_t *slot = key_slot(m, m->table, key.prefix);
+        if (*slot)
+            m->present[*slot - 1] = 1;
+    }
+    return 0;
+}
+
+static int rc_match_chunk(const char *data, size_t len, void *arg) {
+    return vpp_lines_feed(arg, data, len);
+}
+
+/* Keep the recorded routes VPP still has; a VPP restart or vppctl may
+ * have removed some */
+static int rc_load_routes(void) {
+    static const char *const dumps[] = { "show ip fib", "show ip6 fib" };
+    fib_match_t m = { NULL, 63, NULL, ~0u };
+    vpp_lines_t lines;
+    size_t kept = 0;
+    int rv = -1;
+
+    free(run.rc.routes);
+    if (vpp_routes_load(&run.rc.routes, &run.rc.route_count) < 0)
+        return -1;
+    if (!run.rc.route_count)
+        return 0;
+
+    while (m.mask + 1 < 2 * run.rc.route_count)
+        m.mask = m.mask * 2 + 1;
+    m.slot = calloc(m.mask + 1, sizeof(*m.slot));
+    m.present = calloc(run.rc.route_count, 1);
+    if (!m.slot || !m.present)
+        goto out;
+    for (size_t i = 0; i < run.rc.route_count; i++) {
+        size_t *slot = key_slot(&m, run.rc.routes[i].table_id, run.rc.routes[i].prefix);
+        if (!*slot)
+            *slot = i + 1;
+    }
+
+    for (size_t i = 0; i < sizeof(dumps) / sizeof(dumps[0]); i++) {
+        m.table = ~0u;
+        vpp_lines_init(&lines, rc_match_fib, &m);
+        if (vpp_cli_stream(dumps[i], rc_match_chunk, &lines) != 0)
+            goto out;
+        vpp_lines_flush(&lines);
+    }
+    /* Spread each key's mark over its paths before the table moves */
+    for (size_t i = 0; i < run.rc.route_count; i++) {
+        const vpp_route_t *r = &run.rc.routes[i];
+        m.present[i] = m.present[*key_slot(&m, r->table_id, r->prefix) - 1];
+    }
+    for (size_t i = 0; i < run.rc.route_count; i++) {
+        if (m.present[i])
+            run.rc.routes[kept++] = run.rc.routes[i];
+    }
+    run.rc.route_count = kept;
+    rv = 0;
+out:
+    free(m.slot);
+    free(m.present);
+    return rv;
+}
+
+const vpp_rc_t *vpp_rc_collect(int fresh) {
+    const vpp_ift_t *t;
+
+    if (fresh)
+        vpp_ift_invalidate();
+    t = vpp_ift_get(VPP_IFT_FULL);
+    if (!t)
+        return NULL;
+
+    run.rc.count = run.rc.addr_count = 0;
+    if (rc_load_ifaces(t) < 0 || rc_load_routes() < 0)
+        return NULL;
+    return &run.rc;
+}
+
+/* The VPP commands that recreate @rc, tagged for vpp_cfg_push() */
+int vpp_rc_ops(const vpp_rc_t *rc, vpp_cfg_ops_t *ops) {
+    uint64_t *tables = NULL;        /* Family << 32 | id of each table added */
+    size_t ntables = 0, tables_cap = 0;
+    int rv = 0;
+
+    for (size_t i = 0; rv == 0 && i < rc->count; i++) {
+        const vpp_rc_iface_t *r = &rc->ifaces[i];
+
+        if (r->kind == VPP_RC_LOOPBACK)
+            rv |= vpp_cfg_add(ops, VPP_CFG_CREATE, r->name,
+                              "create loopback interface instance %u", r->id);
+        else if (r->kind == VPP_RC_BOND)
+            rv |= vpp_cfg_add(ops, VPP_CFG_CREATE, r->name,
+                              "create bond mode %s load-balance %s id %u",
+                              r->bond_mode, r->bond_lb, r->id);
+        else if (r->kind == VPP_RC_SUBIF)
+            rv |= vpp_cfg_add(ops, VPP_CFG_SUBIF, r->name, "create sub %s %u", r->parent, r->id);
+        if (r->bond[0])
+            rv |= vpp_cfg_add(ops, VPP_CFG_MEMBER, r->name, "bond add %s %s", r->bond, r->name);
+        if (r->mtu)
+            rv |= vpp_cfg_add(ops, VPP_CFG_MTU, r->name,
+                              "set interface mtu packet %u %s", r->mtu, r->name);
+        for (size_t j = 0; j < r->addr_count; j++)
+            rv |= vpp_cfg_add(ops, VPP_CFG_ADDRESS, r->name, "set interface ip address %s %s",
+                              r->name, rc->addrs[r->addr_first + j].prefix);
+        if (r->admin_up)
+            rv |= vpp_cfg_add(ops, VPP_CFG_STATE, r->name, "set interface state %s up", r->name);
+        if (r->lcp_host[0])
+            rv |= vpp_cfg_add(ops, VPP_CFG_LCP, r->name, "lcp create %s host-if %s",
+                              r->name, r->lcp_host);
+    }
+    for (size_t i = 0; rv == 0 && i < rc->route_count; i++) {
+        const vpp_route_t *r = &rc->routes[i];
+        int v6 = strchr(r->prefix, ':') != NULL;
+        uint64_t table = (uint64_t)v6 << 32 | r->table_id;
+        size_t j = 0;
+        char route[256];
+
+        /* Other tables must exist before routes go into them */
+        while (j < ntables && tables[j] != table)
+            j++;
+        if (r->table_id && j == ntables) {
+            if (grow((void **)&tables, &tables_cap, ntables + 1, sizeof(*tables)) < 0) {
+                rv = -1;
+                break;
+            }
+            tables[ntables++] = table;
+            rv |= vpp_cfg_add(ops, VPP_CFG_ROUTE, NULL, "%s table add %u",
+                              v6 ? "ip6" : "ip", r->table_id);
+        }
+        vpp_route_format(r, route, sizeof(route));
+        rv |= vpp_cfg_add(ops, VPP_CFG_ROUTE, NULL, "ip route add %s", route);
+    }
+    free(tables);
+    return rv;
+}
+
+void vpp_rc_free(void) {
+    free(run.rc.ifaces);
+    free(run.rc.addrs);
+    free(run.rc.routes);
+    memset(&run, 0, sizeof(run));
+}
@@ -0,0 +1,49 @@
+/*
+ * Running configuration model for the Klish plugin
+ * What VPP is configured with, collected once and typed, so that every
+ * command rendering it shows the same configuration.
+ */
+
+#ifndef VPP_RUNCFG_H
+#define VPP_RUNCFG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "vpp_config.h"
+#include "vpp_iftable.h"
+#include "vpp_routes.h"
+
+enum { VPP_RC_PHYSICAL, VPP_RC_LOOPBACK, VPP_RC_BOND, VPP_RC_SUBIF };
+
+typedef struct {
+    char name[64];
+    int kind;
+    uint32_t id;                /* Loopback instance, bond id or VLAN id */
+    char parent[64];            /* Set on subinterfaces only */
+    char bond_mode[32];         /* Set on bonds only */
+    char bond_lb[16];
+    char bond[64];              /* Bond this interface is a member of */
+    int admin_up;
+    uint32_t mtu;               /* L3 MTU */
+    size_t addr_first;          /* Range in vpp_rc_t.addrs */
+    size_t addr_count;
+    char lcp_host[32];
+} vpp_rc_iface_t;
+
+typedef struct {
+    vpp_rc_iface_t *ifaces;     /* In VPP's interface order */
+    size_t count;
+    vpp_ift_addr_t *addrs;
+    size_t addr_count;
+    vpp_route_t *routes;        /* Recorded routes VPP still has */
+    size_t route_count;
+} vpp_rc_t;
+
+/* Configuration as VPP has it now, or as of the interface cache unless
+ * @fresh; NULL if VPP could not be reached. Valid until the next call. */
+const vpp_rc_t *vpp_rc_collect(int fresh);
+int vpp_rc_ops(const vpp_rc_t *rc, vpp_cfg_ops_t *ops);
+void vpp_rc_free(void);
+
+#endif /* VPP_RUNCFG_H */
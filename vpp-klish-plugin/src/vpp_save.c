@@ -0,0 +1,186 @@
+/*
+ * Crash-safe configuration saves for the Klish plugin
+ * The status lives in memory mapped before klishd forks sessions, so
+ * every session and every background saver sees the same generations.
+ * It is only ever held for a few stores; renames are serialised by a
+ * lock on the destination directory instead, which the kernel drops if
+ * the saver dies.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "vpp_save.h"
+
+typedef struct {
+    int lock;
+    vpp_save_status_t st;
+} save_share_t;
+
+/* Process-local until vpp_save_init() maps the shared copy */
+static save_share_t local;
+static save_share_t *save = &local;
+
+uint64_t vpp_save_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void status_lock(void) {
+    while (__atomic_exchange_n(&save->lock, 1, __ATOMIC_ACQUIRE))
+        sched_yield();
+}
+
+static void status_unlock(void) {
+    __atomic_store_n(&save->lock, 0, __ATOMIC_RELEASE);
+}
+
+/* Map the shared status; done by klishd before sessions are forked */
+int vpp_save_init(void) {
+    void *p;
+
+    if (save != &local)
+        return 0;
+    p = mmap(NULL, sizeof(save_share_t), PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return -1;
+    memset(p, 0, sizeof(save_share_t));
+    save = p;
+    return 0;
+}
+
+/* Whether a saver in another process can report back */
+int vpp_save_shared(void) {
+    return save != &local;
+}
+
+uint32_t vpp_save_begin(void) {
+    uint32_t gen;
+
+    status_lock();
+    gen = ++save->st.requested;
+    save->st.worker = getpid();
+    save->st.started_ms = vpp_save_now_ms();
+    status_unlock();
+    return gen;
+}
+
+void vpp_save_worker(uint32_t gen, pid_t pid) {
+    status_lock();
+    if (save->st.requested == gen)
+        save->st.worker = pid;
+    status_unlock();
+}
+
+void vpp_save_end(uint32_t gen, int rv, const char *msg) {
+    status_lock();
+    if (save->st.requested == gen)
+        save->st.worker = 0;
+    if (gen > save->st.last) {
+        save->st.last = gen;
+        save->st.last_rv = rv;
+        save->st.last_started_ms = save->st.requested == gen ? save->st.started_ms : 0;
+        save->st.last_finished_ms = vpp_save_now_ms();
+        snprintf(save->st.last_msg, sizeof(save->st.last_msg), "%s", msg ? msg : "");
+    }
+    status_unlock();
+}
+
+void vpp_save_status(vpp_save_status_t *st) {
+    status_lock();
+    *st = save->st;
+    status_unlock();
+}
+
+static int open_dir(const char *path) {
+    char dir[256];
+    const char *slash = strrchr(path, '/');
+
+    if (!slash)
+        return open(".", O_RDONLY | O_DIRECTORY);
+    snprintf(dir, sizeof(dir), "%.*s", slash == path ? 1 : (int)(slash - path), path);
+    return open(dir, O_RDONLY | O_DIRECTORY);
+}
+
+/*
+ * Write @path through @fn without ever leaving it partly written. With a
+ * non-zero @gen, the file is only replaced if no later generation has
+ * been. Returns 0, VPP_SAVE_SUPERSEDED, or -1 with errno set.
+ */
+int vpp_save_file(const char *path, uint32_t gen, vpp_save_write_fn fn, void *arg) {
+    char tmp[256];
+    int fd, dirfd, err, rv = -1;
+    FILE *fp;
+
+    if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= (int)sizeof(tmp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    fd = mkstemp(tmp);
+    if (fd < 0)
+        return -1;
+    fchmod(fd, 0644);
+    fp = fdopen(fd, "w");
+    if (!fp) {
+        err = errno;
+        close(fd);
+        goto fail;
+    }
+    errno = 0;
+    if (fn(fp, arg) != 0 || fflush(fp) != 0 || ferror(fp) || fsync(fd) != 0) {
+        err = errno ? errno : EIO;
+        fclose(fp);
+        goto fail;
+    }
+    if (fclose(fp) != 0) {
+        err = errno;
+        goto fail;
+    }
+
+    dirfd = open_dir(path);
+    if (dirfd < 0) {
+        err = errno;
+        goto fail;
+    }
+    flock(dirfd, LOCK_EX);
+    if (gen && __atomic_load_n(&save->st.committed, __ATOMIC_ACQUIRE) > gen) {
+        rv = VPP_SAVE_SUPERSEDED;
+        err = 0;
+    } else if (rename(tmp, path) != 0) {
+        err = errno;
+    } else {
+        fsync(dirfd);
+        if (gen) {
+            status_lock();
+            if (gen > save->st.committed)
+                save->st.committed = gen;
+            status_unlock();
+        }
+        rv = 0;
+    }
+    flock(dirfd, LOCK_UN);
+    close(dirfd);
+    if (rv != 0)
+        unlink(tmp);
+    if (rv < 0)
+        errno = err;
+    return rv;
+
+fail:
+    unlink(tmp);
+    errno = err;
+    return -1;
+}
@@ -0,0 +1,42 @@
+/*
+ * Crash-safe configuration saves for the Klish plugin
+ * A file is written beside its destination, synced and renamed over it,
+ * so readers see either the old file or the new one. Saves of the
+ * startup configuration are numbered; an older one never replaces a
+ * newer one, whichever finishes first.
+ */
+
+#ifndef VPP_SAVE_H
+#define VPP_SAVE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define VPP_SAVE_SUPERSEDED 1   /* A newer generation is already in place */
+
+/* Writes the content; returns non-zero to abandon the save */
+typedef int (*vpp_save_write_fn)(FILE *fp, void *arg);
+
+typedef struct {
+    uint32_t requested;         /* Latest generation handed out */
+    uint32_t committed;         /* Latest generation renamed into place */
+    pid_t worker;               /* Saving the latest generation, 0 if none */
+    uint64_t started_ms;        /* When the latest generation was requested */
+    uint32_t last;              /* Latest generation that finished */
+    int last_rv;
+    uint64_t last_started_ms;
+    uint64_t last_finished_ms;
+    char last_msg[160];
+} vpp_save_status_t;
+
+int vpp_save_init(void);
+int vpp_save_shared(void);
+uint32_t vpp_save_begin(void);
+void vpp_save_worker(uint32_t gen, pid_t pid);
+void vpp_save_end(uint32_t gen, int rv, const char *msg);
+int vpp_save_file(const char *path, uint32_t gen, vpp_save_write_fn fn, void *arg);
+void vpp_save_status(vpp_save_status_t *st);
+uint64_t vpp_save_now_ms(void);
+
+#endif /* VPP_SAVE_H */
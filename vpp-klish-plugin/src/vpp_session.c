@@ -0,0 +1,94 @@
+/*
+ * Per-session state for the Klish plugin
+ * Mode and load-balance chosen for a bond that is not created yet are
+ * kept per bond until its first member creates it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vpp_session.h"
+
+typedef struct {
+    char name[64];
+    char mode[32];
+    char lb[16];
+} session_bond_t;
+
+static struct {
+    char iface[64];             /* Interface being configured, empty if none */
+    session_bond_t *bonds;
+    size_t bond_count;
+    size_t bond_cap;
+    int prompted;
+} sess;
+
+const char *vpp_session_iface(void) {
+    return sess.iface[0] ? sess.iface : NULL;
+}
+
+void vpp_session_set_iface(const char *iface) {
+    snprintf(sess.iface, sizeof(sess.iface), "%s", iface ? iface : "");
+}
+
+static session_bond_t *find_bond(const char *bond) {
+    for (size_t i = 0; i < sess.bond_count; i++) {
+        if (strcmp(sess.bonds[i].name, bond) == 0)
+            return &sess.bonds[i];
+    }
+    return NULL;
+}
+
+/* Pending settings of @bond; 0 if there are none */
+int vpp_session_bond(const char *bond, char *mode, size_t mode_size, char *lb, size_t lb_size) {
+    const session_bond_t *b = find_bond(bond);
+
+    if (!b)
+        return 0;
+    if (mode)
+        snprintf(mode, mode_size, "%s", b->mode);
+    if (lb)
+        snprintf(lb, lb_size, "%s", b->lb);
+    return 1;
+}
+
+int vpp_session_set_bond(const char *bond, const char *mode, const char *lb) {
+    session_bond_t *b = find_bond(bond);
+
+    if (!b) {
+        if (sess.bond_count == sess.bond_cap) {
+            size_t cap = sess.bond_cap ? sess.bond_cap * 2 : 4;
+            session_bond_t *p = realloc(sess.bonds, cap * sizeof(*p));
+            if (!p)
+                return -1;
+            sess.bonds = p;
+            sess.bond_cap = cap;
+        }
+        b = &sess.bonds[sess.bond_count++];
+        snprintf(b->name, sizeof(b->name), "%s", bond);
+    }
+    snprintf(b->mode, sizeof(b->mode), "%s", mode ? mode : "");
+    snprintf(b->lb, sizeof(b->lb), "%s", lb ? lb : "");
+    return 0;
+}
+
+void vpp_session_clear_bond(const char *bond) {
+    session_bond_t *b = find_bond(bond);
+
+    if (b)
+        *b = sess.bonds[--sess.bond_count];
+}
+
+/* Whether this is the session's first prompt, e.g. to greet with a banner */
+int vpp_session_first_prompt(void) {
+    if (sess.prompted)
+        return 0;
+    sess.prompted = 1;
+    return 1;
+}
+
+void vpp_session_free(void) {
+    free(sess.bonds);
+    memset(&sess, 0, sizeof(sess));
+}
@@ -0,0 +1,21 @@
+/*
+ * Per-session state for the Klish plugin
+ * klishd serves each client from a process of its own and runs the
+ * plugin's handlers synchronously in it, so state kept in memory here is
+ * private to the session and goes away with it.
+ */
+
+#ifndef VPP_SESSION_H
+#define VPP_SESSION_H
+
+#include <stddef.h>
+
+const char *vpp_session_iface(void);
+void vpp_session_set_iface(const char *iface);
+int vpp_session_bond(const char *bond, char *mode, size_t mode_size, char *lb, size_t lb_size);
+int vpp_session_set_bond(const char *bond, const char *mode, const char *lb);
+void vpp_session_clear_bond(const char *bond);
+int vpp_session_first_prompt(void);
+void vpp_session_free(void);
+
+#endif /* VPP_SESSION_H */
@@ -0,0 +1,478 @@
+/*
+ * VPP stats segment reader for the Klish plugin
+ * The segment starts with a header holding VPP's address of the mapping,
+ * an epoch and an in-progress flag, then a directory of named entries.
+ * Pointers in it are VPP's, so each is rebased onto the local mapping and
+ * checked against its size before use. A snapshot is only kept if the
+ * epoch did not move and no update was in progress while it was copied;
+ * otherwise it is taken again. Counter values themselves are updated in
+ * place by the workers and are read as they are.
+ *
+ * The layout is that of VPP 22.10 and later (segment version 2, no error
+ * index entries); older segments are refused.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "vpp_stats.h"
+
+#define STATS_VERSION 2
+#define STATS_NAME_MAX 128
+#define STATS_RETRIES 100           /* Snapshots spoilt by updates before giving up */
+#define STATS_SPIN 10000            /* Polls of the in-progress flag per attempt */
+#define STATS_CONNECT_TIMEOUT_MS 1000
+#define STATS_THREADS_MAX 1024      /* VPP main thread and workers */
+#define STATS_VEC_HDR 8             /* VPP vector header; the length is its first u32 */
+
+/* Directory entry types */
+enum {
+    STATS_ILLEGAL,
+    STATS_SCALAR,
+    STATS_SIMPLE,               /* Per thread, a vector of u64 */
+    STATS_COMBINED,             /* Per thread, a vector of packets/bytes */
+    STATS_NAMES,
+    STATS_EMPTY,
+    STATS_SYMLINK,
+};
+
+typedef struct {
+    uint64_t version;
+    uint64_t base;              /* Where VPP has the segment mapped */
+    uint64_t epoch;
+    uint64_t in_progress;
+    uint64_t directory;         /* Vector of stats_entry_t */
+} stats_header_t;
+
+typedef struct {
+    uint32_t type;
+    union {
+        uint64_t data;          /* Vector, in VPP's address space */
+        double value;
+    };
+    char name[STATS_NAME_MAX];
+} stats_entry_t;
+
+/* Interface counters and their place in vpp_stats_iface_t */
+static const struct {
+    const char *name;
+    int type;
+    size_t offset;
+} if_counters[] = {
+    { "/if/rx", STATS_COMBINED, offsetof(vpp_stats_iface_t, rx) },
+    { "/if/tx", STATS_COMBINED, offsetof(vpp_stats_iface_t, tx) },
+    { "/if/drops", STATS_SIMPLE, offsetof(vpp_stats_iface_t, drops) },
+    { "/if/rx-error", STATS_SIMPLE, offsetof(vpp_stats_iface_t, rx_errors) },
+    { "/if/tx-error", STATS_SIMPLE, offsetof(vpp_stats_iface_t, tx_errors) },
+    { "/if/rx-miss", STATS_SIMPLE, offsetof(vpp_stats_iface_t, rx_miss) },
+};
+#define IF_COUNTERS (sizeof(if_counters) / sizeof(if_counters[0]))
+
+static struct {
+    const char *base;           /* Local mapping, NULL if none */
+    size_t size;
+    const stats_header_t *hdr;
+    dev_t dev;                  /* Of the socket, to notice a VPP restart; */
+    ino_t ino;                  /* inode numbers are reused on tmpfs */
+    struct timespec ctime;
+    size_t names_hint;          /* Directory positions seen last time */
+    size_t hint[IF_COUNTERS];
+} st;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Local address of @len bytes at VPP's address @addr, NULL if outside */
+static const void *stats_ptr(uint64_t addr, size_t len) {
+    uint64_t off = addr - st.hdr->base;
+
+    if (!addr || addr < st.hdr->base || off > st.size || len > st.size - off)
+        return NULL;
+    return st.base + off;
+}
+
+/* Local address of the vector at VPP's address @addr and its length */
+static const void *stats_vec(uint64_t addr, size_t elt, size_t *len) {
+    const uint32_t *h;
+
+    *len = 0;
+    if (addr < STATS_VEC_HDR || !(h = stats_ptr(addr - STATS_VEC_HDR, STATS_VEC_HDR)))
+        return NULL;
+    *len = h[0];
+    return stats_ptr(addr, *len * elt);
+}
+
+static int recv_fd(int sock) {
+    char byte;
+    struct iovec iov = { &byte, 1 };
+    union {
+        struct cmsghdr h;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctl;
+    struct msghdr msg;
+    struct cmsghdr *cm;
+    int fd;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+    if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) < 0)
+        return -1;
+    cm = CMSG_FIRSTHDR(&msg);
+    if (!cm || cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS)
+        return -1;
+    memcpy(&fd, CMSG_DATA(cm), sizeof(fd));
+    return fd;
+}
+
+/* Map the segment VPP hands out on its stats socket */
+int vpp_stats_connect(void) {
+    struct sockaddr_un addr;
+    struct stat sb;
+    void *p;
+    int sock, fd;
+
+    if (st.base) {
+        /* VPP restarted if its socket is not the one we connected to */
+        if (stat(VPP_STATS_SOCKET, &sb) == 0 && sb.st_dev == st.dev && sb.st_ino == st.ino &&
+            sb.st_ctim.tv_sec == st.ctime.tv_sec && sb.st_ctim.tv_nsec == st.ctime.tv_nsec)
+            return 0;
+        vpp_stats_disconnect();
+    }
+    if (stat(VPP_STATS_SOCKET, &sb) < 0)
+        return -1;
+
+    sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (sock < 0)
+        return -1;
+    /* A hung VPP must not hang the session */
+    struct timeval tv = { STATS_CONNECT_TIMEOUT_MS / 1000, (STATS_CONNECT_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", VPP_STATS_SOCKET);
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    fd = recv_fd(sock);
+    close(sock);
+    if (fd < 0)
+        return -1;
+
+    struct stat fsb;
+    if (fstat(fd, &fsb) < 0 || (size_t)fsb.st_size < sizeof(stats_header_t)) {
+        close(fd);
+        return -1;
+    }
+    p = mmap(NULL, (size_t)fsb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return -1;
+
+    st.base = p;
+    st.size = (size_t)fsb.st_size;
+    st.hdr = p;
+    st.dev = sb.st_dev;
+    st.ino = sb.st_ino;
+    st.ctime = sb.st_ctim;
+    if (st.hdr->version != STATS_VERSION) {
+        vpp_stats_disconnect();
+        return -1;
+    }
+    return 0;
+}
+
+void vpp_stats_disconnect(void) {
+    if (st.base)
+        munmap((void *)st.base, st.size);
+    memset(&st, 0, sizeof(st));
+}
+
+/* Wait out an update; the epoch read is the one to check against */
+static int access_start(uint64_t *epoch) {
+    for (int i = 0; i < STATS_SPIN; i++) {
+        *epoch = __atomic_load_n(&st.hdr->epoch, __ATOMIC_ACQUIRE);
+        if (!__atomic_load_n(&st.hdr->in_progress, __ATOMIC_ACQUIRE))
+            return 0;
+        sched_yield();
+    }
+    return -1;
+}
+
+/* Whether nothing changed the directory since access_start() */
+static int access_end(uint64_t epoch) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&st.hdr->in_progress, __ATOMIC_ACQUIRE) == 0 &&
+        __atomic_load_n(&st.hdr->epoch, __ATOMIC_ACQUIRE) == epoch;
+}
+
+static const stats_entry_t *directory(size_t *count) {
+    return stats_vec(st.hdr->directory, sizeof(stats_entry_t), count);
+}
+
+/* Entry named @name, tried first where it was last time */
+static const stats_entry_t *find_entry(const stats_entry_t *dir, size_t count,
+                                       const char *name, size_t *hint) {
+    if (*hint < count && strncmp(dir[*hint].name, name, STATS_NAME_MAX) == 0)
+        return &dir[*hint];
+    for (size_t i = 0; i < count; i++) {
+        if (strncmp(dir[i].name, name, STATS_NAME_MAX) == 0) {
+            *hint = i;
+            return &dir[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Sum a per-thread counter vector into @count records of @stride bytes,
+ * starting at @dst: u64 values for a simple vector, packets and bytes for
+ * a combined one. Each record is written once, with all threads added up,
+ * so the snapshot is walked once per counter rather than once per thread.
+ */
+static int add_vector(const stats_entry_t *e, char *dst, size_t stride, size_t count) {
+    const void *v[STATS_THREADS_MAX];
+    size_t len[STATS_THREADS_MAX], threads;
+    size_t elt = e->type == STATS_SIMPLE ? sizeof(uint64_t) : sizeof(vpp_stats_pb_t);
+    const uint64_t *per_thread = stats_vec(e->data, sizeof(uint64_t), &threads);
+
+    if (!per_thread || threads > STATS_THREADS_MAX)
+        return -1;
+    for (size_t t = 0; t < threads; t++) {
+        if (!(v[t] = stats_vec(per_thread[t], elt, &len[t])))
+            return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (e->type == STATS_SIMPLE) {
+            uint64_t sum = 0;
+            for (size_t t = 0; t < threads; t++) {
+                if (i < len[t])
+                    sum += ((const uint64_t *)v[t])[i];
+            }
+            *(uint64_t *)(dst + i * stride) = sum;
+        } else {
+            vpp_stats_pb_t sum = { 0, 0 };
+            for (size_t t = 0; t < threads; t++) {
+                if (i < len[t]) {
+                    sum.packets += ((const vpp_stats_pb_t *)v[t])[i].packets;
+                    sum.bytes += ((const vpp_stats_pb_t *)v[t])[i].bytes;
+                }
+            }
+            *(vpp_stats_pb_t *)(dst + i * stride) = sum;
+        }
+    }
+    return 0;
+}
+
+/* Names are only copied again after the directory changed */
+static int load_ifaces(vpp_stats_ifaces_t *s, uint64_t epoch) {
+    size_t count, n;
+    const stats_entry_t *dir = directory(&count), *e;
+    const uint64_t *names;
+    const size_t counters = offsetof(vpp_stats_iface_t, rx);
+
+    if (!dir)
+        return -1;
+    e = find_entry(dir, count, "/if/names", &st.names_hint);
+    if (!e || e->type != STATS_NAMES || !(names = stats_vec(e->data, sizeof(uint64_t), &n)))
+        return -1;
+
+    if (n > s->cap) {
+        vpp_stats_iface_t *p = realloc(s->ifaces, n * sizeof(*p));
+        if (!p)
+            return -1;
+        s->ifaces = p;
+        s->cap = n;
+    }
+    if (!s->taken_ns || s->epoch != epoch || s->count != n) {
+        s->taken_ns = 0;        /* Names unusable until a snapshot succeeds */
+        s->count = n;
+        for (size_t i = 0; i < n; i++) {
+            size_t len = 0;
+            const char *name = names[i] ? stats_vec(names[i], 1, &len) : NULL;
+            len = name ? strnlen(name, len) : 0;
+            if (len >= sizeof(s->ifaces[i].name))
+                len = sizeof(s->ifaces[i].name) - 1;
+            memcpy(s->ifaces[i].name, name ? name : "", len);
+            s->ifaces[i].name[len] = 0;
+        }
+    }
+    for (size_t i = 0; i < n; i++)
+        memset((char *)&s->ifaces[i] + counters, 0, sizeof(vpp_stats_iface_t) - counters);
+
+    for (size_t c = 0; c < IF_COUNTERS; c++) {
+        e = find_entry(dir, count, if_counters[c].name, &st.hint[c]);
+        if (!e || e->type != (uint32_t)if_counters[c].type)
+            continue;   /* Not every VPP has every counter */
+        if (add_vector(e, (char *)s->ifaces + if_counters[c].offset, sizeof(vpp_stats_iface_t), n) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* Interface counters by sw_if_index, from one consistent view */
+int vpp_stats_ifaces(vpp_stats_ifaces_t *s) {
+    if (vpp_stats_connect() < 0)
+        return -1;
+    for (int attempt = 0; attempt < STATS_RETRIES; attempt++) {
+        uint64_t epoch;
+
+        if (access_start(&epoch) < 0)
+            continue;
+        if (load_ifaces(s, epoch) == 0 && access_end(epoch)) {
+            s->epoch = epoch;
+            s->taken_ns = now_ns();
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* Counters of interface @index on each thread, without summing */
+static int load_threads(size_t index, vpp_stats_iface_t *t, size_t max, size_t *threads) {
+    size_t count;
+    const stats_entry_t *dir = directory(&count);
+
+    if (!dir)
+        return -1;
+    memset(t, 0, max * sizeof(*t));
+    *threads = 0;
+    for (size_t c = 0; c < IF_COUNTERS; c++) {
+        const stats_entry_t *e = find_entry(dir, count, if_counters[c].name, &st.hint[c]);
+        size_t elt, n, len;
+        const uint64_t *per_thread;
+
+        if (!e || e->type != (uint32_t)if_counters[c].type)
+            continue;
+        elt = e->type == STATS_SIMPLE ? sizeof(uint64_t) : sizeof(vpp_stats_pb_t);
+        if (!(per_thread = stats_vec(e->data, sizeof(uint64_t), &n)))
+            return -1;
+        if (n > max)
+            n = max;
+        for (size_t i = 0; i < n; i++) {
+            const char *v = stats_vec(per_thread[i], elt, &len);
+            if (!v)
+                return -1;
+            if (index < len)
+                memcpy((char *)&t[i] + if_counters[c].offset, v + index * elt, elt);
+        }
+        if (n > *threads)
+            *threads = n;
+    }
+    return 0;
+}
+
+/* Counters of interface @index kept by each VPP thread, the main thread
+ * first, into @t for up to @max threads. What a thread received is what
+ * the RX queues placed on it received. */
+int vpp_stats_iface_threads(size_t index, vpp_stats_iface_t *t, size_t max, size_t *threads) {
+    if (vpp_stats_connect() < 0)
+        return -1;
+    for (int attempt = 0; attempt < STATS_RETRIES; attempt++) {
+        uint64_t epoch;
+
+        if (access_start(&epoch) < 0)
+            continue;
+        if (load_threads(index, t, max, threads) == 0 && access_end(epoch))
+            return 0;
+    }
+    return -1;
+}
+
+void vpp_stats_ifaces_free(vpp_stats_ifaces_t *s) {
+    free(s->ifaces);
+    memset(s, 0, sizeof(*s));
+}
+
+/* Every index of every thread, packets for a combined vector; error
+ * counters have a single index */
+static uint64_t sum_vector(const stats_entry_t *e) {
+    size_t threads, n;
+    const uint64_t *per_thread = stats_vec(e->data, sizeof(uint64_t), &threads);
+    uint64_t sum = 0;
+
+    for (size_t t = 0; per_thread && t < threads; t++) {
+        if (e->type == STATS_SIMPLE) {
+            const uint64_t *v = stats_vec(per_thread[t], sizeof(uint64_t), &n);
+            for (size_t i = 0; v && i < n; i++)
+                sum += v[i];
+        } else {
+            const vpp_stats_pb_t *v = stats_vec(per_thread[t], sizeof(vpp_stats_pb_t), &n);
+            for (size_t i = 0; v && i < n; i++)
+                sum += v[i].packets;
+        }
+    }
+    return sum;
+}
+
+static int load_counters(const char *prefix, vpp_stats_counters_t *s) {
+    size_t count, plen = strlen(prefix);
+    const stats_entry_t *dir = directory(&count);
+
+    if (!dir)
+        return -1;
+    s->count = 0;
+    for (size_t i = 0; i < count; i++) {
+        const stats_entry_t *e = &dir[i];
+        vpp_stats_counter_t *c;
+
+        if (strncmp(e->name, prefix, plen) != 0 ||
+            (e->type != STATS_SCALAR && e->type != STATS_SIMPLE && e->type != STATS_COMBINED))
+            continue;
+        if (s->count == s->cap) {
+            size_t cap = s->cap ? s->cap * 2 : 256;
+            vpp_stats_counter_t *p = realloc(s->items, cap * sizeof(*p));
+            if (!p)
+                return -1;
+            s->items = p;
+            s->cap = cap;
+        }
+        c = &s->items[s->count];
+        size_t len = strnlen(e->name, sizeof(c->name) - 1);
+        memcpy(c->name, e->name, len);
+        c->name[len] = 0;
+        c->gauge = e->type == STATS_SCALAR ? e->value : 0;
+        c->value = e->type == STATS_SCALAR ? (e->value > 0 ? (uint64_t)e->value : 0) : sum_vector(e);
+        s->count++;
+    }
+    return 0;
+}
+
+/* Counters whose names start with @prefix, e.g. "/err/" or "/sys/" */
+int vpp_stats_counters(const char *prefix, vpp_stats_counters_t *s) {
+    if (vpp_stats_connect() < 0)
+        return -1;
+    for (int attempt = 0; attempt < STATS_RETRIES; attempt++) {
+        uint64_t epoch;
+
+        if (access_start(&epoch) < 0)
+            continue;
+        if (load_counters(prefix, s) == 0 && access_end(epoch)) {
+            s->taken_ns = now_ns();
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void vpp_stats_counters_free(vpp_stats_counters_t *s) {
+    free(s->items);
+    memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,62 @@
+/*
+ * VPP stats segment reader for the Klish plugin
+ * VPP publishes its counters in shared memory handed out on its stats
+ * socket. Mapping it read-only lets a session copy interface and error
+ * counters directly, without a request to VPP's main thread.
+ */
+
+#ifndef VPP_STATS_H
+#define VPP_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define VPP_STATS_SOCKET "/run/vpp/stats.sock"
+
+typedef struct {
+    uint64_t packets;
+    uint64_t bytes;
+} vpp_stats_pb_t;
+
+/* Counters of one interface, summed over VPP's threads */
+typedef struct {
+    char name[64];              /* Empty for an unused sw_if_index */
+    vpp_stats_pb_t rx;
+    vpp_stats_pb_t tx;
+    uint64_t drops;
+    uint64_t rx_errors;
+    uint64_t tx_errors;
+    uint64_t rx_miss;
+} vpp_stats_iface_t;
+
+typedef struct {
+    vpp_stats_iface_t *ifaces;  /* By sw_if_index */
+    size_t count;
+    size_t cap;
+    uint64_t epoch;             /* Of the segment the snapshot came from */
+    uint64_t taken_ns;          /* Monotonic */
+} vpp_stats_ifaces_t;
+
+/* Error counter, or gauge for /sys/ entries, summed over threads */
+typedef struct {
+    char name[128];
+    uint64_t value;
+    double gauge;               /* Unrounded value of a scalar entry */
+} vpp_stats_counter_t;
+
+typedef struct {
+    vpp_stats_counter_t *items;
+    size_t count;
+    size_t cap;
+    uint64_t taken_ns;
+} vpp_stats_counters_t;
+
+int vpp_stats_connect(void);
+void vpp_stats_disconnect(void);
+int vpp_stats_ifaces(vpp_stats_ifaces_t *s);
+void vpp_stats_ifaces_free(vpp_stats_ifaces_t *s);
+int vpp_stats_iface_threads(size_t index, vpp_stats_iface_t *t, size_t max, size_t *threads);
+int vpp_stats_counters(const char *prefix, vpp_stats_counters_t *s);
+void vpp_stats_counters_free(vpp_stats_counters_t *s);
+
+#endif /* VPP_STATS_H */
@@ -0,0 +1,542 @@
+/*
+ * System information for the Klish plugin
+ * Distribution and kernel are read once, when klishd loads the plugin.
+ * Hostname, memory and CPU load are sampled by one background process per
+ * klishd, which publishes them under a seqlock in memory mapped before
+ * sessions are forked. A session copies a snapshot only when it changed;
+ * if the sampler stops publishing, the session samples by itself.
+ *
+ * CPU times are kept as a ring of cumulative per-CPU counters covering
+ * the longest window, so every average is one subtraction between two
+ * rows. Cores are told apart by the VPP threads found running on them.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+
+#include "vpp_sysinfo.h"
+
+#define SYSINFO_STALE_INTERVALS 3   /* Missed samples before sessions step in */
+#define SYSINFO_SCAN_MS 10000       /* How often VPP's threads are looked up */
+#define SYSINFO_STAT_BYTES (1 << 17)    /* Enough for the cpu lines of /proc/stat */
+#define SYSINFO_COPY_TRIES 20       /* 1 ms waits for a write before sampling alone */
+
+static const unsigned int window_ms[VPP_SYSINFO_WINDOWS] = VPP_SYSINFO_WINDOW_MS;
+
+typedef struct {
+    uint32_t seq;               /* Seqlock, odd while a sample is written */
+    int32_t sampler;            /* PID; negated PID of its spawner meanwhile */
+    int32_t daemon;             /* klishd; the sampler exits with it */
+    /* Written under the seqlock */
+    vpp_sysinfo_t info;
+    vpp_sysinfo_cpus_t cpus;
+} share_t;
+
+typedef struct {
+    uint64_t busy;
+    uint64_t total;
+} cpu_time_t;
+
+static share_t *share;
+static vpp_sysinfo_t local;     /* This process's copy */
+static vpp_sysinfo_cpus_t local_cpus;
+static uint32_t copied_seq = 1;
+static uint32_t cpus_seq = 1;
+static unsigned int interval_ms = VPP_SYSINFO_DEFAULT_INTERVAL_MS;
+
+/* Recent samples, kept by whichever process samples */
+static struct {
+    cpu_time_t *ring;           /* One row of @count CPUs per slot */
+    uint64_t *at;               /* When each row was taken */
+    size_t slots;
+    size_t next;
+    size_t filled;
+    unsigned int count;
+    unsigned int id[VPP_SYSINFO_CPU_MAX];
+} hist;
+
+/* VPP's threads by the CPU they last ran on */
+static struct {
+    pid_t pid;                  /* vpp_main, 0 if not found */
+    uint64_t scanned_ms;
+    char thread[VPP_SYSINFO_CPU_MAX][16];
+} vpp;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    /* Served from the vDSO, without entering the kernel */
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void sleep_ms(unsigned int ms) {
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000 };
+    nanosleep(&ts, NULL);
+}
+
+static int pid_alive(pid_t pid) {
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+/* Read a small file whole; procfs files must be read in one go */
+static ssize_t read_file(const char *path, char *buf, size_t size) {
+    size_t len = 0;
+    ssize_t n;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+        return -1;
+    while (len < size - 1 && (n = read(fd, buf + len, size - 1 - len)) > 0)
+        len += (size_t)n;
+    close(fd);
+    buf[len] = 0;
+    return (ssize_t)len;
+}
+
+/* Value of the line starting with @key, e.g. "MemTotal:" */
+static const char *find_line(const char *text, const char *key) {
+    size_t klen = strlen(key);
+    const char *p = text;
+
+    while (p) {
+        if (strncmp(p, key, klen) == 0)
+            return p + klen;
+        p = strchr(p, '\n');
+        if (p)
+            p++;
+    }
+    return NULL;
+}
+
+static uint64_t find_u64(const char *text, const char *key) {
+    const char *v = find_line(text, key);
+    return v ? strtoull(v, NULL, 10) : 0;
+}
+
+static void sample_static(vpp_sysinfo_t *si) {
+    char buf[4096];
+    struct utsname uts;
+    const char *v;
+
+    snprintf(si->distro, sizeof(si->distro), "Unknown Linux");
+    if (read_file("/etc/os-release", buf, sizeof(buf)) > 0 &&
+        (v = find_line(buf, "PRETTY_NAME=")) != NULL) {
+        size_t len = strcspn(v, "\n");
+        if (len >= 2 && (v[0] == '"' || v[0] == '\'') && v[len - 1] == v[0]) {
+            v++;
+            len -= 2;
+        }
+        snprintf(si->distro, sizeof(si->distro), "%.*s", (int)len, v);
+    }
+    snprintf(si->kernel, sizeof(si->kernel), "Unknown");
+    if (uname(&uts) == 0) {
+        snprintf(si->kernel, sizeof(si->kernel), "%s", uts.release);
+        snprintf(si->hostname, sizeof(si->hostname), "%s", uts.nodename);
+    }
+}
+
+static int read_comm(const char *path, char *buf, size_t size) {
+    if (read_file(path, buf, size) <= 0)
+        return -1;
+    buf[strcspn(buf, "\n")] = 0;
+    return 0;
+}
+
+static pid_t find_vpp(void) {
+    DIR *d = opendir("/proc");
+    struct dirent *de;
+    pid_t pid = 0;
+
+    if (!d)
+        return 0;
+    while (!pid && (de = readdir(d)) != NULL) {
+        char path[300], comm[32];
+
+        if (!isdigit((unsigned char)de->d_name[0]))
+            continue;
+        snprintf(path, sizeof(path), "/proc/%s/comm", de->d_name);
+        if (read_comm(path, comm, sizeof(comm)) == 0 && strcmp(comm, "vpp_main") == 0)
+            pid = (pid_t)strtol(de->d_name, NULL, 10);
+    }
+    closedir(d);
+    return pid;
+}
+
+/* Note which CPU each VPP thread last ran on; workers are pinned */
+static void scan_vpp(uint64_t now) {
+    char path[300], comm[32];
+    DIR *d;
+    struct dirent *de;
+
+    if (vpp.scanned_ms && now - vpp.scanned_ms < SYSINFO_SCAN_MS)
+        return;
+    vpp.scanned_ms = now;
+    memset(vpp.thread, 0, sizeof(vpp.thread));
+
+    snprintf(path, sizeof(path), "/proc/%d/comm", (int)vpp.pid);
+    if (!vpp.pid || read_comm(path, comm, sizeof(comm)) < 0 || strcmp(comm, "vpp_main") != 0)
+        vpp.pid = find_vpp();
+    if (!vpp.pid)
+        return;
+
+    snprintf(path, sizeof(path), "/proc/%d/task", (int)vpp.pid);
+    d = opendir(path);
+    if (!d)
+        return;
+    while ((de = readdir(d)) != NULL) {
+        char stat[1024];
+        const char *p;
+        unsigned long cpu;
+
+        if (!isdigit((unsigned char)de->d_name[0]))
+            continue;
+        snprintf(path, sizeof(path), "/proc/%d/task/%s/comm", (int)vpp.pid, de->d_name);
+        if (read_comm(path, comm, sizeof(comm)) < 0 || strncmp(comm, "vpp_", 4) != 0)
+            continue;
+        snprintf(path, sizeof(path), "/proc/%d/task/%s/stat", (int)vpp.pid, de->d_name);
+        if (read_file(path, stat, sizeof(stat)) <= 0 || !(p = strrchr(stat, ')')))
+            continue;
+        /* "processor" is field 39; the name ends field 2 */
+        for (int field = 2; field < 39 && p; field++)
+            p = strchr(p + 1, ' ');
+        if (!p)
+            continue;
+        cpu = strtoul(p + 1, NULL, 10);
+        if (cpu >= VPP_SYSINFO_CPU_MAX)
+            continue;
+        /* A worker wins over the main thread sharing its core */
+        if (!vpp.thread[cpu][0] || strncmp(comm, "vpp_wk_", 7) == 0)
+            snprintf(vpp.thread[cpu], sizeof(vpp.thread[cpu]), "%.15s", comm);
+    }
+    closedir(d);
+}
+
+/* Append a row to the history; a change of CPUs starts it over */
+static void hist_add(const unsigned int *ids, const cpu_time_t *t, unsigned int n, uint64_t now) {
+    if (!hist.ring || n != hist.count || memcmp(ids, hist.id, n * sizeof(*ids)) != 0) {
+        size_t slots = window_ms[VPP_SYSINFO_WINDOWS - 1] / interval_ms + 2;
+        cpu_time_t *ring = malloc(slots * n * sizeof(*ring));
+        uint64_t *at = malloc(slots * sizeof(*at));
+
+        free(hist.ring);
+        free(hist.at);
+        memset(&hist, 0, sizeof(hist));
+        if (!ring || !at) {
+            free(ring);
+            free(at);
+            return;
+        }
+        hist.ring = ring;
+        hist.at = at;
+        hist.slots = slots;
+        hist.count = n;
+        memcpy(hist.id, ids, n * sizeof(*ids));
+    }
+    memcpy(hist.ring + hist.next * n, t, n * sizeof(*t));
+    hist.at[hist.next] = now;
+    hist.next = (hist.next + 1) % hist.slots;
+    if (hist.filled < hist.slots)
+        hist.filled++;
+}
+
+static double percent(uint64_t busy, uint64_t total) {
+    return total ? 100.0 * (double)busy / (double)total : 0.0;
+}
+
+/* Averages over each window, from the newest row and the one before it */
+static void hist_loads(vpp_sysinfo_t *si, vpp_sysinfo_cpus_t *cpus) {
+    size_t newest = (hist.next + hist.slots - 1) % hist.slots;
+
+    memset(&si->control, 0, sizeof(si->control));
+    memset(&si->workers, 0, sizeof(si->workers));
+    memset(si->span_ms, 0, sizeof(si->span_ms));
+    cpus->count = hist.count;
+    for (unsigned int i = 0; i < hist.count; i++) {
+        vpp_sysinfo_cpu_t *c = &cpus->cpu[i];
+
+        memset(c, 0, sizeof(*c));
+        c->id = hist.id[i];
+        if (c->id < VPP_SYSINFO_CPU_MAX)
+            snprintf(c->thread, sizeof(c->thread), "%s", vpp.thread[c->id]);
+        c->worker = strncmp(c->thread, "vpp_wk_", 7) == 0;
+        if (c->worker)
+            si->workers.cpus++;
+        else
+            si->control.cpus++;
+    }
+    if (hist.filled < 2)
+        return;
+
+    for (int w = 0; w < VPP_SYSINFO_WINDOWS; w++) {
+        size_t back = window_ms[w] ? (window_ms[w] + interval_ms / 2) / interval_ms : 1;
+        const cpu_time_t *now_row = hist.ring + newest * hist.count, *then_row;
+        uint64_t busy[2] = {0}, total[2] = {0};
+
+        if (back > hist.filled - 1)
+            back = hist.filled - 1;
+        size_t then = (newest + hist.slots - back) % hist.slots;
+        then_row = hist.ring + then * hist.count;
+        si->span_ms[w] = (unsigned int)(hist.at[newest] - hist.at[then]);
+
+        for (unsigned int i = 0; i < hist.count; i++) {
+            vpp_sysinfo_cpu_t *c = &cpus->cpu[i];
+            uint64_t db = 0, dt = 0;
+
+            /* Counters of a CPU brought back online start over */
+            if (now_row[i].total > then_row[i].total && now_row[i].busy >= then_row[i].busy) {
+                db = now_row[i].busy - then_row[i].busy;
+                dt = now_row[i].total - then_row[i].total;
+            }
+            c->busy[w] = percent(db, dt);
+            busy[c->worker] += db;
+            total[c->worker] += dt;
+        }
+        si->control.busy[w] = percent(busy[0], total[0]);
+        si->workers.busy[w] = percent(busy[1], total[1]);
+    }
+}
+
+static void sample_cpus(vpp_sysinfo_t *si, vpp_sysinfo_cpus_t *cpus, uint64_t now) {
+    static char buf[SYSINFO_STAT_BYTES];
+    static unsigned int ids[VPP_SYSINFO_CPU_MAX];
+    static cpu_time_t t[VPP_SYSINFO_CPU_MAX];
+    unsigned int n = 0;
+    const char *p = buf;
+
+    if (read_file("/proc/stat", buf, sizeof(buf)) <= 0)
+        return;
+    /* "cpu<id> user nice system idle iowait irq softirq steal ..." */
+    while (p && n < VPP_SYSINFO_CPU_MAX) {
+        if (strncmp(p, "cpu", 3) == 0 && isdigit((unsigned char)p[3])) {
+            uint64_t f[8] = {0}, total = 0;
+            char *end;
+
+            ids[n] = (unsigned int)strtoul(p + 3, &end, 10);
+            p = end;
+            for (int i = 0; i < 8; i++) {
+                f[i] = strtoull(p, &end, 10);
+                if (end == p)
+                    break;
+                p = end;
+                total += f[i];
+            }
+            t[n].total = total;
+            t[n].busy = total - f[3] - f[4];    /* Less idle and iowait */
+            n++;
+        } else if (n) {
+            break;      /* The cpu lines come together */
+        }
+        p = strchr(p, '\n');
+        if (p)
+            p++;
+    }
+    if (!n)
+        return;
+    scan_vpp(now);
+    hist_add(ids, t, n, now);
+    if (hist.ring)
+        hist_loads(si, cpus);
+}
+
+static void sample(vpp_sysinfo_t *si, vpp_sysinfo_cpus_t *cpus) {
+    char buf[4096];
+    struct utsname uts;
+    uint64_t now = now_ms();
+
+    /* The hostname can change at any time; it is re-read every sample */
+    if (uname(&uts) == 0)
+        snprintf(si->hostname, sizeof(si->hostname), "%s", uts.nodename);
+
+    if (read_file("/proc/meminfo", buf, sizeof(buf)) > 0) {
+        si->mem_total_kb = find_u64(buf, "MemTotal:");
+        si->mem_avail_kb = find_u64(buf, "MemAvailable:");
+        si->huge_total = find_u64(buf, "HugePages_Total:");
+        si->huge_free = find_u64(buf, "HugePages_Free:");
+        si->huge_size_kb = find_u64(buf, "Hugepagesize:");
+    }
+    sample_cpus(si, cpus, now);
+    si->interval_ms = interval_ms;
+    si->sampled_ms = now;
+}
+
+static void write_sample(const vpp_sysinfo_t *si, const vpp_sysinfo_cpus_t *cpus) {
+    share->info = *si;
+    share->cpus.count = cpus->count;
+    memcpy(share->cpus.cpu, cpus->cpu, cpus->count * sizeof(cpus->cpu[0]));
+}
+
+static void publish(const vpp_sysinfo_t *si, const vpp_sysinfo_cpus_t *cpus) {
+    uint32_t seq = share->seq;
+
+    __atomic_store_n(&share->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    write_sample(si, cpus);
+    __atomic_store_n(&share->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/* The sampler: the only process that reads /proc while it runs */
+static void sampler_run(void) {
+    int fd;
+
+    signal(SIGINT, SIG_IGN);
+    signal(SIGHUP, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+
+    for (fd = (int)sysconf(_SC_OPEN_MAX) - 1; fd >= 0; fd--)
+        close(fd);
+    fd = open("/dev/null", O_RDWR);
+    if (fd == 0) {
+        dup2(0, 1);
+        dup2(0, 2);
+    }
+    /* A sampler killed while publishing left the seqlock odd over a torn
+     * sample: finish its write with a sample of this one's own, so that
+     * every later write starts even */
+    uint32_t seq = share->seq;
+    if (seq & 1) {
+        sample(&local, &local_cpus);
+        write_sample(&local, &local_cpus);
+        __atomic_store_n(&share->seq, seq + 1, __ATOMIC_RELEASE);
+    } else {
+        local = share->info;
+    }
+    __atomic_store_n(&share->sampler, (int32_t)getpid(), __ATOMIC_RELEASE);
+
+    for (;;) {
+        if (!pid_alive(share->daemon))
+            _exit(0);
+        sample(&local, &local_cpus);
+        publish(&local, &local_cpus);
+        sleep_ms(interval_ms);
+    }
+}
+
+/* Start the sampler unless one runs; only one process gets to */
+static int sampler_spawn(pid_t daemon) {
+    int32_t cur = __atomic_load_n(&share->sampler, __ATOMIC_ACQUIRE);
+    pid_t child;
+
+    if (pid_alive(cur < 0 ? -cur : cur))
+        return 0;
+    if (!__atomic_compare_exchange_n(&share->sampler, &cur, -(int32_t)getpid(),
+                                     0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return 0;
+    if (!share->daemon)
+        share->daemon = (int32_t)daemon;
+
+    child = fork();
+    if (child < 0) {
+        __atomic_store_n(&share->sampler, 0, __ATOMIC_RELEASE);
+        return -1;
+    }
+    if (child == 0) {
+        /* Detach, so the sampler outlives whoever started it */
+        setsid();
+        if (fork() == 0)
+            sampler_run();
+        _exit(0);
+    }
+    waitpid(child, NULL, 0);
+    return 0;
+}
+
+/* Copy the current sample unless this process already has it; the
+ * per-CPU part only when asked for. Fails if a write does not finish, as
+ * when its sampler was killed. */
+static int share_copy(int with_cpus) {
+    for (unsigned int tries = 0; ; ) {
+        uint32_t seq = __atomic_load_n(&share->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            if (++tries > SYSINFO_COPY_TRIES)
+                return -1;
+            sleep_ms(1);
+            continue;
+        }
+        if (seq == copied_seq && (!with_cpus || seq == cpus_seq))
+            return 0;
+        vpp_sysinfo_t si = share->info;
+        if (with_cpus) {
+            unsigned int count = share->cpus.count;
+            if (count > VPP_SYSINFO_CPU_MAX)
+                continue;   /* Torn read */
+            local_cpus.count = count;
+            memcpy(local_cpus.cpu, share->cpus.cpu, count * sizeof(local_cpus.cpu[0]));
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&share->seq, __ATOMIC_RELAXED) != seq)
+            continue;
+        local = si;
+        copied_seq = seq;
+        if (with_cpus)
+            cpus_seq = seq;
+        return 0;
+    }
+}
+
+/* Bring the local copy up to date; no system calls while the sampler runs */
+static void refresh(int with_cpus) {
+    uint64_t stale = (uint64_t)interval_ms * SYSINFO_STALE_INTERVALS;
+
+    if (share) {
+        if (share_copy(with_cpus) == 0 && local.sampled_ms && now_ms() - local.sampled_ms < stale)
+            return;
+        sampler_spawn(getppid());
+        stale = interval_ms;
+    }
+    if (!local.sampled_ms || now_ms() - local.sampled_ms >= stale)
+        sample(&local, &local_cpus);
+}
+
+/* Read the fixed parts and start the sampler; done by klishd before
+ * sessions are forked. Without the shared mapping sessions sample alone. */
+int vpp_sysinfo_init(unsigned int interval) {
+    void *p;
+
+    if (interval)
+        interval_ms = interval;
+    if (!local.kernel[0])
+        sample_static(&local);
+    if (share)
+        return 0;
+    p = mmap(NULL, sizeof(share_t), PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return -1;
+    memset(p, 0, sizeof(share_t));
+    share = p;
+    share->info = local;
+    return sampler_spawn(getpid());
+}
+
+void vpp_sysinfo_get(vpp_sysinfo_t *si) {
+    refresh(0);
+    *si = local;
+}
+
+void vpp_sysinfo_get_cpus(vpp_sysinfo_t *si, vpp_sysinfo_cpus_t *cpus) {
+    refresh(1);
+    *si = local;
+    cpus->count = local_cpus.count;
+    memcpy(cpus->cpu, local_cpus.cpu, local_cpus.count * sizeof(cpus->cpu[0]));
+}
+
+/* For the prompt: a copy of the hostname that stays valid until the next call */
+const char *vpp_sysinfo_hostname(void) {
+    refresh(0);
+    return local.hostname;
+}
@@ -0,0 +1,60 @@
+/*
+ * System information for the Klish plugin
+ * Hostname, distribution and kernel for the prompt and the banner, with
+ * memory and CPU load, kept up to date by a background sampler so that
+ * drawing them costs no system calls. CPU load is measured over the last
+ * sample, the last minute and the last five minutes, separately for the
+ * cores running VPP workers, which poll at 100% by design, and the rest.
+ */
+
+#ifndef VPP_SYSINFO_H
+#define VPP_SYSINFO_H
+
+#include <stdint.h>
+
+#define VPP_SYSINFO_DEFAULT_INTERVAL_MS 1000
+#define VPP_SYSINFO_CPU_MAX 1024    /* CPUs followed one by one */
+
+/* Averaging windows: the last sample, one minute, five minutes */
+enum { VPP_SYSINFO_NOW, VPP_SYSINFO_1MIN, VPP_SYSINFO_5MIN, VPP_SYSINFO_WINDOWS };
+#define VPP_SYSINFO_WINDOW_MS { 0, 60000, 300000 }  /* 0: one sample interval */
+
+typedef struct {
+    unsigned int cpus;
+    double busy[VPP_SYSINFO_WINDOWS];   /* Percent */
+} vpp_sysinfo_load_t;
+
+typedef struct {
+    char hostname[65];          /* As long as uname() gives */
+    char distro[64];
+    char kernel[65];
+    uint64_t mem_total_kb;
+    uint64_t mem_avail_kb;
+    uint64_t huge_total;        /* Hugepages, in pages */
+    uint64_t huge_free;
+    uint64_t huge_size_kb;
+    vpp_sysinfo_load_t control; /* Cores left to the kernel and control plane */
+    vpp_sysinfo_load_t workers; /* Cores running VPP workers */
+    unsigned int span_ms[VPP_SYSINFO_WINDOWS];  /* Covered so far, 0 if nothing */
+    unsigned int interval_ms;
+    uint64_t sampled_ms;        /* Monotonic, 0 if never sampled */
+} vpp_sysinfo_t;
+
+typedef struct {
+    unsigned int id;            /* cpu<id> in /proc/stat */
+    char thread[16];            /* VPP thread last seen on it, empty if none */
+    int worker;
+    double busy[VPP_SYSINFO_WINDOWS];
+} vpp_sysinfo_cpu_t;
+
+typedef struct {
+    unsigned int count;
+    vpp_sysinfo_cpu_t cpu[VPP_SYSINFO_CPU_MAX];
+} vpp_sysinfo_cpus_t;
+
+int vpp_sysinfo_init(unsigned int interval_ms);
+void vpp_sysinfo_get(vpp_sysinfo_t *si);
+void vpp_sysinfo_get_cpus(vpp_sysinfo_t *si, vpp_sysinfo_cpus_t *cpus);
+const char *vpp_sysinfo_hostname(void);
+
+#endif /* VPP_SYSINFO_H */
@@ -0,0 +1,219 @@
+/*
+ * Per-command memory and in-place parsing of VPP output for the Klish plugin
+ * Output is kept in the buffer it was received into and walked through
+ * views, so parsing neither copies nor modifies it and may nest.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "vpp_text.h"
+
+#define ARENA_CHUNK 65536
+#define ARENA_ALIGN 16
+
+struct vpp_arena_chunk {
+    vpp_arena_chunk_t *prev;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+static size_t align_up(size_t n) {
+    return (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+void *vpp_arena_alloc(vpp_arena_t *a, size_t size) {
+    vpp_arena_chunk_t *c = a->head;
+    size_t need = align_up(size ? size : 1);
+
+    if (!c || c->size - c->used < need) {
+        size_t chunk = need > ARENA_CHUNK ? need : ARENA_CHUNK;
+        c = malloc(sizeof(*c) + chunk);
+        if (!c)
+            return NULL;
+        c->prev = a->head;
+        c->size = chunk;
+        c->used = 0;
+        a->head = c;
+    }
+    a->last = c->data + c->used;
+    c->used += need;
+    return a->last;
+}
+
+/* Resize @ptr, in place when it is the latest allocation and still fits */
+void *vpp_arena_grow(vpp_arena_t *a, void *ptr, size_t old_size, size_t new_size) {
+    vpp_arena_chunk_t *c = a->head;
+    void *p;
+
+    if (ptr && ptr == a->last) {
+        size_t start = (size_t)((char *)ptr - c->data);
+        if (align_up(new_size) <= c->size - start) {
+            c->used = start + align_up(new_size);
+            return ptr;
+        }
+    }
+    p = vpp_arena_alloc(a, new_size);
+    if (p && ptr)
+        memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    return p;
+}
+
+/* Release everything but the first chunk, which is kept for reuse */
+void vpp_arena_reset(vpp_arena_t *a) {
+    while (a->head && a->head->prev) {
+        vpp_arena_chunk_t *prev = a->head->prev;
+        free(a->head);
+        a->head = prev;
+    }
+    if (a->head)
+        a->head->used = 0;
+    a->last = NULL;
+}
+
+void vpp_arena_free(vpp_arena_t *a) {
+    vpp_arena_reset(a);
+    free(a->head);
+    a->head = NULL;
+}
+
+/* Split the next line off @text, without its "\n" or "\r\n" */
+int vpp_sv_line(vpp_sv_t *text, vpp_sv_t *line) {
+    const char *nl;
+
+    if (!text->len)
+        return 0;
+    nl = memchr(text->p, '\n', text->len);
+    line->p = text->p;
+    line->len = nl ? (size_t)(nl - text->p) : text->len;
+    text->p += line->len + (nl ? 1 : 0);
+    text->len -= line->len + (nl ? 1 : 0);
+    if (line->len && line->p[line->len - 1] == '\r')
+        line->len--;
+    return 1;
+}
+
+/* Split the next whitespace-separated field off @line */
+int vpp_sv_field(vpp_sv_t *line, vpp_sv_t *field) {
+    while (line->len && (*line->p == ' ' || *line->p == '\t')) {
+        line->p++;
+        line->len--;
+    }
+    if (!line->len)
+        return 0;
+    field->p = line->p;
+    field->len = 0;
+    while (line->len && *line->p != ' ' && *line->p != '\t') {
+        line->p++;
+        line->len--;
+        field->len++;
+    }
+    return 1;
+}
+
+int vpp_sv_eq(vpp_sv_t s, const char *lit) {
+    size_t n = strlen(lit);
+    return s.len == n && memcmp(s.p, lit, n) == 0;
+}
+
+int vpp_sv_starts(vpp_sv_t s, const char *lit) {
+    size_t n = strlen(lit);
+    return s.len >= n && memcmp(s.p, lit, n) == 0;
+}
+
+/* Find @lit in @s; @rest receives what follows it */
+int vpp_sv_find(vpp_sv_t s, const char *lit, vpp_sv_t *rest) {
+    size_t n = strlen(lit);
+
+    for (size_t i = 0; i + n <= s.len; i++) {
+        if (memcmp(s.p + i, lit, n) == 0) {
+            rest->p = s.p + i + n;
+            rest->len = s.len - i - n;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Leading decimal digits of @s, e.g. 9000 of "9000/0/0/0" */
+int vpp_sv_u32(vpp_sv_t s, uint32_t *value) {
+    uint64_t v = 0;
+    size_t i;
+
+    for (i = 0; i < s.len && s.p[i] >= '0' && s.p[i] <= '9'; i++) {
+        v = v * 10 + (uint64_t)(s.p[i] - '0');
+        if (v > UINT32_MAX)
+            return -1;
+    }
+    if (i == 0)
+        return -1;
+    *value = (uint32_t)v;
+    return 0;
+}
+
+/* NUL-terminated copy into @buf, truncated to fit */
+size_t vpp_sv_copy(vpp_sv_t s, char *buf, size_t size) {
+    size_t n = s.len < size - 1 ? s.len : size - 1;
+
+    memcpy(buf, s.p, n);
+    buf[n] = 0;
+    return n;
+}
+
+void vpp_lines_init(vpp_lines_t *l, vpp_line_fn fn, void *arg) {
+    l->len = 0;
+    l->fn = fn;
+    l->arg = arg;
+    l->stopped = 0;
+}
+
+static void lines_emit(vpp_lines_t *l, const char *p, size_t len) {
+    if (len && p[len - 1] == '\r')
+        len--;
+    if (!l->stopped && l->fn(vpp_sv(p, len), l->arg) != 0)
+        l->stopped = 1;
+}
+
+/* Pass every line completed by @data to the callback, without its line
+ * end; returns non-zero once the callback has asked to stop */
+int vpp_lines_feed(vpp_lines_t *l, const char *data, size_t len) {
+    while (len && !l->stopped) {
+        const char *nl = memchr(data, '\n', len);
+        size_t n = nl ? (size_t)(nl - data) : len;
+
+        if (l->len + n > sizeof(l->buf)) {
+            /* Flush a piece of an over-long line to make room */
+            size_t fit = sizeof(l->buf) - l->len;
+            memcpy(l->buf + l->len, data, fit);
+            lines_emit(l, l->buf, sizeof(l->buf));
+            l->len = 0;
+            data += fit;
+            len -= fit;
+            continue;
+        }
+        if (!nl) {
+            memcpy(l->buf + l->len, data, n);
+            l->len += n;
+            break;
+        }
+        if (l->len) {
+            memcpy(l->buf + l->len, data, n);
+            lines_emit(l, l->buf, l->len + n);
+            l->len = 0;
+        } else {
+            lines_emit(l, data, n);
+        }
+        data += n + 1;
+        len -= n + 1;
+    }
+    return l->stopped;
+}
+
+/* Pass on a last line that had no line end */
+int vpp_lines_flush(vpp_lines_t *l) {
+    if (l->len)
+        lines_emit(l, l->buf, l->len);
+    l->len = 0;
+    return l->stopped;
+}
@@ -0,0 +1,59 @@
+/*
+ * Per-command memory and in-place parsing of VPP output for the Klish plugin
+ */
+
+#ifndef VPP_TEXT_H
+#define VPP_TEXT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Bump allocator; everything is released at once by vpp_arena_reset() */
+typedef struct vpp_arena_chunk vpp_arena_chunk_t;
+
+typedef struct {
+    vpp_arena_chunk_t *head;    /* Chunk being allocated from */
+    void *last;                 /* Latest allocation, may still grow */
+} vpp_arena_t;
+
+void *vpp_arena_alloc(vpp_arena_t *a, size_t size);
+void *vpp_arena_grow(vpp_arena_t *a, void *ptr, size_t old_size, size_t new_size);
+void vpp_arena_reset(vpp_arena_t *a);
+void vpp_arena_free(vpp_arena_t *a);
+
+/* Read-only view into text owned by someone else, not NUL-terminated */
+typedef struct {
+    const char *p;
+    size_t len;
+} vpp_sv_t;
+
+static inline vpp_sv_t vpp_sv(const char *s, size_t len) {
+    vpp_sv_t sv = { s ? s : "", s ? len : 0 };
+    return sv;
+}
+
+int vpp_sv_line(vpp_sv_t *text, vpp_sv_t *line);
+int vpp_sv_field(vpp_sv_t *line, vpp_sv_t *field);
+int vpp_sv_eq(vpp_sv_t s, const char *lit);
+int vpp_sv_starts(vpp_sv_t s, const char *lit);
+int vpp_sv_find(vpp_sv_t s, const char *lit, vpp_sv_t *rest);
+int vpp_sv_u32(vpp_sv_t s, uint32_t *value);
+size_t vpp_sv_copy(vpp_sv_t s, char *buf, size_t size);
+
+/* Whole lines out of streamed output, with only a partial line held */
+typedef int (*vpp_line_fn)(vpp_sv_t line, void *arg);
+
+typedef struct {
+    char buf[1024];             /* Longer lines are passed on in pieces */
+    size_t len;
+    vpp_line_fn fn;
+    void *arg;
+    int stopped;
+} vpp_lines_t;
+
+void vpp_lines_init(vpp_lines_t *l, vpp_line_fn fn, void *arg);
+int vpp_lines_feed(vpp_lines_t *l, const char *data, size_t len);
+int vpp_lines_flush(vpp_lines_t *l);
+
+#endif /* VPP_TEXT_H */